@@ -3,11 +3,14 @@
 from __future__ import annotations
 
 import json
-from typing import Any, Dict, Iterable
+from typing import Any, Callable, Dict, Iterable, Optional
 
+from .deadline import ToolTimeoutError, call_with_deadline, tool_timeout_from_env
 from .llm_client import LLMClient
 from .log import get_logger
+from .prefetch import Prefetcher
 from .prompts import SYSTEM_PROMPT
+from .toolsets import REQUEST_TOOLS_NAME, ToolSelector, estimate_schema_tokens
 
 logger = get_logger(__name__)
 
@@ -21,11 +24,23 @@ class ReverseEngineeringAgent:
         tools_spec: Iterable[Dict[str, Any]],
         tool_map: Dict[str, Any],
         max_iterations: int = 20,
+        select_tools: bool = True,
+        prefetch: bool = True,
+        warmers: Optional[Dict[str, Callable[..., Any]]] = None,
+        tool_timeout: Optional[float] = None,
     ):
         self.llm = llm
         self.tools_spec = list(tools_spec)
         self.tool_map = tool_map
         self.max_iterations = max_iterations
+        # Expose a question-specific subset of compact schemas (see toolsets.py)
+        self.select_tools = select_tools
+        # Run likely next tool calls during inference (see prefetch.py); `warmers`
+        # stand in for tools whose results must not be computed ahead of time.
+        self.prefetch = prefetch
+        self.warmers = warmers
+        # Seconds a single tool call may run before it is cut short (see deadline.py).
+        self.tool_timeout = tool_timeout_from_env() if tool_timeout is None else tool_timeout
 
     def _format_args_short(self, args: Dict[str, Any]) -> str:
         """Format arguments for logging in a concise way."""
@@ -52,27 +67,101 @@ class ReverseEngineeringAgent:
 
         return ", ".join(parts)
 
-    def run(self, question: str, verbose: bool = False) -> str:
+    def _escalation(self, phase: str) -> Optional[str]:
+        escalation = getattr(self.llm, "escalation", None)
+        return escalation(phase) if escalation else None
+
+    def _unusable(self, message: Any, selector: Optional[ToolSelector]) -> Optional[str]:
+        """Why a completion cannot drive the loop (empty, bad tool call), or None."""
+
+        if not message.content and not message.tool_calls:
+            return "empty response"
+        for call in message.tool_calls or []:
+            name = call.function.name
+            if name not in self.tool_map and not (selector and name == REQUEST_TOOLS_NAME):
+                return f"unknown tool {name!r}"
+            try:
+                json.loads(call.function.arguments or "{}")
+            except json.JSONDecodeError:
+                return f"invalid arguments for {name}"
+        return None
+
+    def run(self, question: str, verbose: bool = False, context: Optional[str] = None) -> str:
+        """Answer `question`; `context` carries findings from earlier questions in a session."""
+
+        prefetcher = Prefetcher.from_env(self.tool_map, self.warmers) if self.prefetch else None
+        try:
+            return self._run(question, verbose, prefetcher, context)
+        finally:
+            if prefetcher:
+                prefetcher.close()
+                if verbose and prefetcher.stats["scheduled"]:
+                    logger.info(
+                        "Prefetch: %d scheduled, %d used, %d discarded",
+                        prefetcher.stats["scheduled"],
+                        prefetcher.stats["hits"],
+                        prefetcher.stats["discarded"],
+                    )
+
+    def _run(
+        self, question: str, verbose: bool, prefetcher: Optional[Prefetcher], context: Optional[str] = None
+    ) -> str:
+        content = question
+        if context:
+            # Kept out of the system prompt so its prefix stays cacheable across questions.
+            content = (
+                "Findings from earlier questions about this binary (verify before relying on them):\n"
+                f"{context}\n\nQuestion: {question}"
+            )
         messages = [
             {"role": "system", "content": SYSTEM_PROMPT},
-            {"role": "user", "content": question},
+            {"role": "user", "content": content},
         ]
+        selector = ToolSelector(self.tools_spec, question) if self.select_tools else None
+        phase = "explore"
 
         for iteration in range(self.max_iterations):
             if verbose:
                 logger.info("Agent iteration %s/%s", iteration + 1, self.max_iterations)
 
-            try:
-                response = self.llm.chat(
+            tools = selector.specs() if selector else self.tools_spec
+            if verbose and selector:
+                logger.info(
+                    "Exposing %d/%d tools (~%d schema tokens; full set ~%d)",
+                    len(selector.active),
+                    len(self.tools_spec),
+                    estimate_schema_tokens(tools),
+                    estimate_schema_tokens(self.tools_spec),
+                )
+
+            def explore() -> Any:
+                return self.llm.chat(
                     verbose=verbose,
+                    phase=phase,
                     messages=messages,
-                    tools=self.tools_spec,
+                    tools=tools,
                     tool_choice="auto",
                     temperature=0.1,
                 )
+
+            try:
+                response = explore()
+                failure = self._unusable(response.choices[0].message, selector)
             except Exception as exc:
-                logger.error("LLM call failed: %s", exc)
-                return f"LLM Error: {exc}"
+                response, failure = None, exc
+            fallback = self._escalation(phase) if failure else None
+            if fallback:
+                # The rest of the session stays on the stronger model.
+                logger.warning("%s model failed (%s); escalating to %s", phase, failure, fallback)
+                phase = fallback
+                try:
+                    response = explore()
+                except Exception as exc:
+                    logger.error("LLM call failed: %s", exc)
+                    return f"LLM Error: {exc}"
+            elif response is None:
+                logger.error("LLM call failed: %s", failure)
+                return f"LLM Error: {failure}"
 
             message = response.choices[0].message
             message_dict = {"role": message.role, "content": message.content}
@@ -91,8 +180,18 @@ class ReverseEngineeringAgent:
             messages.append(message_dict)
 
             if not message.tool_calls:
-                return message.content or "No response generated"
+                answer = message.content or "No response generated"
+                synthesis = self._escalation(phase)
+                if synthesis:
+                    # Exploration is done; the final answer comes from the synthesis model.
+                    try:
+                        final = self.llm.chat(verbose=verbose, phase=synthesis, messages=messages[:-1], temperature=0.1)
+                        answer = final.choices[0].message.content or answer
+                    except Exception as exc:
+                        logger.warning("Synthesis call failed (%s); using the exploration answer", exc)
+                return answer
 
+            executed = []
             for tool_call in message.tool_calls:
                 func_name = tool_call.function.name
                 handler = self.tool_map.get(func_name)
@@ -106,15 +205,33 @@ class ReverseEngineeringAgent:
                     args_str = self._format_args_short(args)
                     logger.info("Calling tool: %s(%s)", func_name, args_str)
 
-                if not handler:
+                if selector and func_name == REQUEST_TOOLS_NAME:
+                    result = selector.handle_request(args)
+                    if verbose:
+                        logger.info("Enabled tools: %s", ", ".join(result["enabled"]) or "none")
+                elif not handler:
                     result = {"error": f"Unknown tool: {func_name}"}
                     if verbose:
                         logger.info("Tool %s: ERROR (unknown tool)", func_name)
                 else:
+                    if selector:
+                        # The model may know a hidden tool from earlier context; keep it exposed.
+                        selector.expand([func_name])
                     try:
-                        result = handler(**args)
+                        result = prefetcher.take(func_name, args) if prefetcher else None
+                        if result is None:
+                            result = call_with_deadline(handler, args, self.tool_timeout)
+                        elif verbose:
+                            logger.info("Tool %s: prefetched", func_name)
                         if verbose:
                             logger.info("Tool %s: SUCCESS", func_name)
+                    except ToolTimeoutError as exc:
+                        logger.warning("Tool %s timed out", func_name)
+                        result = {
+                            "error": f"{exc}; narrow the query (smaller limit, more specific pattern) and retry",
+                            "truncated": True,
+                            "timed_out": True,
+                        }
                     except Exception as exc:  # pragma: no cover - depends on tool inputs
                         logger.exception("Tool %s failed", func_name)
                         result = {"error": str(exc)}
@@ -128,11 +245,19 @@ class ReverseEngineeringAgent:
                         "content": json.dumps(result),
                     }
                 )
+                executed.append((func_name, args, result))
+
+            if prefetcher:
+                # Predictions from the previous turn the model did not follow are stale.
+                prefetcher.discard_pending()
+                for func_name, args, result in executed:
+                    prefetcher.schedule(func_name, args, result)
 
         logger.warning("Max iterations reached; requesting summary from model")
         try:
             final_response = self.llm.chat(
                 verbose=verbose,
+                phase="synthesis",
                 messages=messages
                 + [
                     {
@@ -0,0 +1,185 @@
+"""Offline benchmark of the agent loop over recorded sessions.
+
+Usage:
+    python -m kernagent.bench ARCHIVE_DIR CASSETTE [CASSETTE ...] [--repeat N] [--json]
+    python -m kernagent.bench ARCHIVE_DIR --record OUT.jsonl --question "..."
+
+Replaying runs each cassette (see replay.py) through ReverseEngineeringAgent
+against the snapshot tools and reports wall time, tool latency and token
+totals, tagged with the current git commit so runs can be compared over time.
+Recording needs a live model configured as for the CLI.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import subprocess
+import threading
+import time
+from collections import defaultdict
+from pathlib import Path
+from typing import Any, Callable, Dict, List, Optional
+
+from .agent import ReverseEngineeringAgent
+from .log import get_logger, setup_logging
+from .prompts import TOOLS
+from .replay import RecordingLLM, ReplayLLM, load_cassette
+from .snapshot import SnapshotTools, build_prefetch_warmers, build_tool_map
+
+logger = get_logger(__name__)
+
+
+def _git_commit() -> Optional[str]:
+    try:
+        result = subprocess.run(
+            ["git", "rev-parse", "--short", "HEAD"],
+            cwd=Path(__file__).resolve().parent,
+            capture_output=True,
+            text=True,
+            timeout=5,
+        )
+    except (OSError, subprocess.SubprocessError):
+        return None
+    if result.returncode != 0:
+        return None
+    return result.stdout.strip() or None
+
+
+def _timed_tool_map(
+    tool_map: Dict[str, Callable[..., Any]],
+    timings: Dict[str, List[float]],
+    speculative: Dict[str, List[float]],
+):
+    def wrap(name: str, handler: Callable[..., Any]) -> Callable[..., Any]:
+        def timed(**kwargs: Any) -> Any:
+            start = time.perf_counter()
+            try:
+                return handler(**kwargs)
+            finally:
+                # Prefetch workers may start a prediction the model never asks for;
+                # whether they do is a race, so keep those out of the session's calls.
+                on_prefetch = threading.current_thread().name.startswith("prefetch")
+                (speculative if on_prefetch else timings)[name].append(time.perf_counter() - start)
+
+        return timed
+
+    return {name: wrap(name, handler) for name, handler in tool_map.items()}
+
+
+def replay_session(archive_dir: Path, cassette: Path) -> Dict[str, Any]:
+    """Replay one cassette against fresh snapshot tools and collect metrics."""
+
+    data = load_cassette(cassette)
+    llm = ReplayLLM(data)
+    timings: Dict[str, List[float]] = defaultdict(list)
+    speculative: Dict[str, List[float]] = defaultdict(list)
+
+    start = time.perf_counter()
+    snapshot = SnapshotTools(archive_dir)
+    tool_map = _timed_tool_map(build_tool_map(snapshot), timings, speculative)
+    agent = ReverseEngineeringAgent(llm, TOOLS, tool_map, warmers=build_prefetch_warmers(snapshot))
+    answer = agent.run(llm.question or "")
+    wall = time.perf_counter() - start
+
+    prompt_sizes = [request["prompt_tokens_est"] for request in llm.requests]
+    tool_total = sum(sum(values) for values in timings.values())
+    return {
+        "cassette": str(cassette),
+        "question": llm.question,
+        "wall_s": round(wall, 4),
+        "llm_calls": len(llm.requests),
+        "recorded_turns": len(llm.turns),
+        "complete": llm.exhausted and not answer.startswith("LLM Error"),
+        "tool_calls": sum(len(values) for values in timings.values()),
+        "tool_s": round(tool_total, 4),
+        "tools": {
+            name: {"calls": len(values), "total_s": round(sum(values), 4), "max_s": round(max(values), 4)}
+            for name, values in sorted(timings.items())
+        },
+        "prefetch_calls": sum(len(values) for values in speculative.values()),
+        "prompt_tokens_est": sum(prompt_sizes),
+        "max_prompt_tokens_est": max(prompt_sizes, default=0),
+        "completion_tokens": sum(request["completion_tokens"] for request in llm.requests),
+        "unexposed_tool_calls": sum(len(request["unexposed_tools"]) for request in llm.requests),
+    }
+
+
+def run_benchmark(archive_dir: Path, cassettes: List[Path], repeat: int = 1) -> Dict[str, Any]:
+    """Replay every cassette `repeat` times; per-session numbers are from the fastest run."""
+
+    sessions = []
+    for cassette in cassettes:
+        runs = [replay_session(archive_dir, cassette) for _ in range(max(1, repeat))]
+        sessions.append(min(runs, key=lambda run: run["wall_s"]))
+
+    return {
+        "commit": _git_commit(),
+        "archive": str(archive_dir),
+        "sessions": sessions,
+        "totals": {
+            key: round(sum(session[key] for session in sessions), 4)
+            for key in ("wall_s", "tool_s", "llm_calls", "tool_calls", "prompt_tokens_est", "completion_tokens")
+        },
+    }
+
+
+def record_session(archive_dir: Path, question: str, output: Path, verbose: bool = False) -> str:
+    """Run the agent against a live model and save the session as a cassette."""
+
+    from .config import load_settings
+    from .llm_client import LLMClient
+
+    llm = RecordingLLM(LLMClient(load_settings()), output)
+    snapshot = SnapshotTools(archive_dir)
+    agent = ReverseEngineeringAgent(llm, TOOLS, build_tool_map(snapshot), warmers=build_prefetch_warmers(snapshot))
+    return agent.run(question, verbose=verbose)
+
+
+def _print_report(report: Dict[str, Any]) -> None:
+    print(f"commit {report['commit'] or 'unknown'}  archive {report['archive']}")
+    for session in report["sessions"]:
+        status = "" if session["complete"] else "  (diverged)"
+        print(
+            f"- {Path(session['cassette']).name}: {session['wall_s']:.3f}s wall, "
+            f"{session['tool_s']:.3f}s in {session['tool_calls']} tool calls, "
+            f"{session['llm_calls']} LLM calls, ~{session['prompt_tokens_est']} prompt tokens "
+            f"(max {session['max_prompt_tokens_est']}){status}"
+        )
+    totals = report["totals"]
+    print(
+        f"total: {totals['wall_s']:.3f}s wall, {totals['tool_s']:.3f}s tools, "
+        f"~{int(totals['prompt_tokens_est'])} prompt / {int(totals['completion_tokens'])} completion tokens"
+    )
+
+
+def main(argv: Optional[List[str]] = None) -> None:
+    parser = argparse.ArgumentParser(prog="kernagent.bench", description="Replay recorded agent sessions.")
+    parser.add_argument("archive", type=Path, help="Snapshot archive directory.")
+    parser.add_argument("cassettes", type=Path, nargs="*", help="Recorded sessions (.jsonl) to replay.")
+    parser.add_argument("--repeat", type=int, default=1, help="Replays per session; the fastest is reported.")
+    parser.add_argument("--json", action="store_true", help="Print the report as JSON.")
+    parser.add_argument("--record", type=Path, help="Record a live session to this cassette path.")
+    parser.add_argument("--question", help="Question to ask when recording.")
+    parser.add_argument("-v", "--verbose", action="store_true", help="Enable verbose logging.")
+    args = parser.parse_args(argv)
+
+    setup_logging(False)
+
+    if args.record:
+        if not args.question:
+            parser.error("--record requires --question")
+        print(record_session(args.archive, args.question, args.record, verbose=args.verbose))
+        return
+
+    if not args.cassettes:
+        parser.error("no cassettes given")
+    report = run_benchmark(args.archive, args.cassettes, repeat=args.repeat)
+    if args.json:
+        print(json.dumps(report, indent=2))
+    else:
+        _print_report(report)
+
+
+if __name__ == "__main__":  # pragma: no cover
+    main()
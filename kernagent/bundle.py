@@ -0,0 +1,519 @@
+"""Archive, installer and directory inputs: unpack, deduplicate and snapshot every executable.
+
+Given a ZIP, tarball, single gz/bz2/xz file, MSI/CAB/7z installer or a
+directory, ``build_bundle`` enumerates the members, keeps those that start like
+an executable (PE, ELF, Mach-O), stores each distinct one once under ``<input>_bundle/members/``
+(``<dir>/kernagent_bundle/members/`` for a directory; identical copies are
+recorded as duplicates of the first), and snapshots the unique members
+concurrently, each in its own process since pyghidra runs one JVM per process.
+Nested archives (an MSI holding CABs, a ZIP inside a ZIP) are unpacked up to
+``MAX_DEPTH`` levels. Unpacking stops with ``BundleLimitError`` past
+KERNAGENT_BUNDLE_MAX_MB written or KERNAGENT_BUNDLE_MAX_MEMBERS entries read, so
+an archive bomb cannot fill the disk. ``manifest.json`` links the input to every
+member and its snapshot so later runs and tools can find them.
+"""
+
+from __future__ import annotations
+
+import bz2
+import gzip
+import hashlib
+import json
+import lzma
+import multiprocessing
+import os
+import re
+import shutil
+import subprocess
+import tarfile
+import tempfile
+import threading
+import zipfile
+from concurrent.futures import Executor, ProcessPoolExecutor, ThreadPoolExecutor
+from dataclasses import asdict, dataclass, field
+from pathlib import Path
+from typing import Any, BinaryIO, Callable, Dict, Iterator, List, Optional, Tuple
+
+from .log import get_logger
+from .snapshot import SnapshotError, build_snapshot
+
+logger = get_logger(__name__)
+
+MANIFEST_NAME = "manifest.json"
+MANIFEST_VERSION = 1
+MAX_DEPTH = 3
+HEAD_BYTES = 8
+# Each snapshot worker runs its own Ghidra JVM; more than a couple rarely fits in memory.
+DEFAULT_JOBS = 2
+DEFAULT_MAX_BYTES = 4096 * 2**20
+DEFAULT_MAX_MEMBERS = 10000
+_CHUNK = 1 << 20
+
+# Leading bytes of the container formats handled here.
+_ARCHIVE_MAGIC = (
+    (b"PK\x03\x04", "zip"),
+    (b"PK\x05\x06", "zip"),
+    (b"MSCF", "cab"),
+    (b"\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1", "msi"),
+    (b"7z\xbc\xaf\x27\x1c", "7z"),
+    (b"\x1f\x8b", "gz"),
+    (b"BZh", "bz2"),
+    (b"\xfd7zXZ\x00", "xz"),
+)
+# Single compressed streams: a tarball, or one compressed file (sample.exe.gz).
+_STREAM_OPENERS: Dict[str, Callable[[Path], BinaryIO]] = {"gz": gzip.open, "bz2": bz2.open, "xz": lzma.open}
+# Formats only the external 7-Zip tool can read.
+SEVEN_ZIP_KINDS = frozenset({"cab", "msi", "7z"})
+
+_MACHO_MAGIC = {b"\xfe\xed\xfa\xce", b"\xfe\xed\xfa\xcf", b"\xce\xfa\xed\xfe", b"\xcf\xfa\xed\xfe"}
+
+
+def executable_format(head: bytes) -> Optional[str]:
+    """"pe", "elf" or "macho" when `head` starts like an executable Ghidra can load."""
+
+    if head[:2] == b"MZ":
+        return "pe"
+    if head[:4] == b"\x7fELF":
+        return "elf"
+    if head[:4] in _MACHO_MAGIC:
+        return "macho"
+    return None
+
+
+def archive_kind(path: Path, head: Optional[bytes] = None) -> Optional[str]:
+    """Container format of `path` ("directory", "zip", "tar", "gz", "bz2", "xz", "cab", "msi", "7z") or None.
+
+    A compressed tarball is "tar"; "gz", "bz2" and "xz" are single compressed files.
+    """
+
+    if path.is_dir():
+        return "directory"
+    if head is None:
+        try:
+            with path.open("rb") as f:
+                head = f.read(HEAD_BYTES)
+        except OSError:
+            return None
+    for magic, kind in _ARCHIVE_MAGIC:
+        if head.startswith(magic):
+            if kind in _STREAM_OPENERS and _is_tarfile(path):
+                return "tar"
+            return kind
+    if executable_format(head) is None and _is_tarfile(path):
+        return "tar"
+    return None
+
+
+def _is_tarfile(path: Path) -> bool:
+    try:
+        return tarfile.is_tarfile(path)
+    except (OSError, EOFError, lzma.LZMAError):  # truncated or corrupt stream
+        return False
+
+
+def bundle_dir_for(input_path: Path) -> Path:
+    # Inside a directory input, so a container that only mounts the directory keeps the results.
+    if input_path.is_dir():
+        return input_path / "kernagent_bundle"
+    return input_path.parent / f"{input_path.name}_bundle"
+
+
+def jobs_from_env() -> int:
+    value = os.getenv("KERNAGENT_BUNDLE_JOBS", "").strip()
+    default = min(DEFAULT_JOBS, os.cpu_count() or 1)
+    try:
+        return max(1, int(value)) if value else default
+    except ValueError:
+        logger.warning("Ignoring invalid KERNAGENT_BUNDLE_JOBS=%s", value)
+        return default
+
+
+def limits_from_env() -> Tuple[int, int]:
+    """(bytes, entries) an unpack may write and read; 0 disables a limit."""
+
+    limits = []
+    for name, default, scale in (
+        ("KERNAGENT_BUNDLE_MAX_MB", DEFAULT_MAX_BYTES, 2**20),
+        ("KERNAGENT_BUNDLE_MAX_MEMBERS", DEFAULT_MAX_MEMBERS, 1),
+    ):
+        value = os.getenv(name, "").strip()
+        try:
+            limits.append(max(0, int(float(value) * scale)) if value else default)
+        except ValueError:
+            logger.warning("Ignoring invalid %s=%s", name, value)
+            limits.append(default)
+    return limits[0], limits[1]
+
+
+class BundleLimitError(SnapshotError):
+    """Unpacking exceeded KERNAGENT_BUNDLE_MAX_MB or KERNAGENT_BUNDLE_MAX_MEMBERS."""
+
+
+def _is_own_output(dirname: str, sibling_files: List[str]) -> bool:
+    if dirname == "kernagent_bundle":
+        return True
+    for suffix in ("_archive", "_bundle"):
+        if dirname.endswith(suffix):
+            stem = dirname[: -len(suffix)]
+            # build_snapshot names the archive after the binary's stem, bundles keep the full name.
+            if any(name == stem or Path(name).stem == stem for name in sibling_files):
+                return True
+    return False
+
+
+def _sha256_path(path: Path) -> str:
+    digest = hashlib.sha256()
+    with path.open("rb") as f:
+        for chunk in iter(lambda: f.read(_CHUNK), b""):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+@dataclass
+class Member:
+    path: str  # location inside the input, nested archives joined with "!"
+    sha256: str
+    size: int
+    format: str
+    file: str  # stored copy, relative to the bundle directory
+    duplicates: List[str] = field(default_factory=list)
+    snapshot: Optional[str] = None
+    state: str = "pending"
+    error: Optional[str] = None
+
+
+class _Unpacker:
+    """Collect distinct executable members of one input into `members_dir`."""
+
+    def __init__(self, bundle_dir: Path, jobs: int, max_bytes: int = 0, max_entries: int = 0):
+        self.bundle_dir = bundle_dir
+        self.members_dir = bundle_dir / "members"
+        self.jobs = jobs
+        self.max_bytes = max_bytes
+        self.max_entries = max_entries
+        self.members: Dict[str, Member] = {}
+        self.skipped = 0
+        self.written = 0
+        self.entries = 0
+        self._lock = threading.Lock()
+
+    def _charge(self, size: int) -> None:
+        with self._lock:
+            self.written += size
+            if self.max_bytes and self.written > self.max_bytes:
+                raise BundleLimitError(
+                    f"Unpacking wrote more than {self.max_bytes // 2**20} MB (KERNAGENT_BUNDLE_MAX_MB)"
+                )
+
+    def _copy(self, head: bytes, source: BinaryIO, out: BinaryIO, digest: Optional[Any] = None) -> int:
+        self._charge(len(head))
+        out.write(head)
+        size = len(head)
+        for chunk in iter(lambda: source.read(_CHUNK), b""):
+            self._charge(len(chunk))
+            if digest is not None:
+                digest.update(chunk)
+            out.write(chunk)
+            size += len(chunk)
+        return size
+
+    def _store(self, name: str, head: bytes, source: BinaryIO) -> None:
+        """Copy one executable stream into the bundle, or record it as a duplicate."""
+
+        fd, tmp_name = tempfile.mkstemp(dir=self.members_dir, prefix=".member-")
+        digest = hashlib.sha256(head)
+        try:
+            with os.fdopen(fd, "wb") as out:
+                size = self._copy(head, source, out, digest)
+        except BaseException:
+            os.unlink(tmp_name)
+            raise
+        sha256 = digest.hexdigest()
+        with self._lock:
+            existing = self.members.get(sha256)
+            if existing is not None:
+                existing.duplicates.append(name)
+                os.unlink(tmp_name)
+                return
+            target = self.members_dir / f"{sha256[:16]}_{Path(name.rsplit('!', 1)[-1]).name}"
+            os.replace(tmp_name, target)
+            self.members[sha256] = Member(
+                path=name,
+                sha256=sha256,
+                size=size,
+                format=executable_format(head) or "unknown",
+                file=str(target.relative_to(self.bundle_dir)),
+            )
+
+    def finish(self) -> List[Member]:
+        """Members sorted by path; each named after its first path in sorted order, whichever thread won."""
+
+        for member in self.members.values():
+            paths = sorted([member.path, *member.duplicates])
+            member.path, member.duplicates = paths[0], paths[1:]
+            target = self.members_dir / f"{member.sha256[:16]}_{Path(member.path.rsplit('!', 1)[-1]).name}"
+            current = self.bundle_dir / member.file
+            if current != target:
+                os.replace(current, target)
+                member.file = str(target.relative_to(self.bundle_dir))
+        return sorted(self.members.values(), key=lambda member: member.path)
+
+    def _consume(self, name: str, source: BinaryIO, depth: int) -> None:
+        with self._lock:
+            self.entries += 1
+            if self.max_entries and self.entries > self.max_entries:
+                raise BundleLimitError(
+                    f"Input holds more than {self.max_entries} files (KERNAGENT_BUNDLE_MAX_MEMBERS)"
+                )
+        head = source.read(HEAD_BYTES)
+        if executable_format(head):
+            self._store(name, head, source)
+            return
+        if depth < MAX_DEPTH and any(head.startswith(magic) for magic, _ in _ARCHIVE_MAGIC):
+            self._nested(name, head, source, depth)
+            return
+        with self._lock:
+            self.skipped += 1
+
+    def _nested(self, name: str, head: bytes, source: BinaryIO, depth: int) -> None:
+        with tempfile.TemporaryDirectory(dir=self.bundle_dir, prefix=".nested-") as tmp:
+            inner = Path(tmp) / Path(name.rsplit("!", 1)[-1]).name
+            with inner.open("wb") as out:
+                self._copy(head, source, out)
+            try:
+                self.unpack(inner, prefix=f"{name}!", depth=depth + 1)
+            except BundleLimitError:
+                raise
+            except (SnapshotError, tarfile.TarError, zipfile.BadZipFile) as exc:
+                # A .gz that is not a tarball, a CAB without 7z on PATH, ...
+                logger.warning("Not unpacking nested %s: %s", name, exc)
+                with self._lock:
+                    self.skipped += 1
+
+    def unpack(self, path: Path, prefix: str = "", depth: int = 0) -> None:
+        kind = archive_kind(path)
+        try:
+            if kind == "directory":
+                self._unpack_directory(path, prefix, depth)
+            elif kind == "zip":
+                self._unpack_zip(path, prefix, depth)
+            elif kind == "tar":
+                self._unpack_tar(path, prefix, depth)
+            elif kind in _STREAM_OPENERS:
+                self._unpack_stream(path, kind, prefix, depth)
+            elif kind in SEVEN_ZIP_KINDS:
+                self._unpack_7z(path, prefix, depth)
+            else:
+                raise SnapshotError(f"Not an archive or directory: {path}")
+        except (tarfile.TarError, zipfile.BadZipFile, EOFError, OSError, lzma.LZMAError) as exc:
+            raise SnapshotError(f"Cannot unpack {path.name}: {exc}") from exc
+
+    def _parallel(self, items: List[Tuple[str, Callable[[], BinaryIO]]], depth: int) -> None:
+        def consume(item: Tuple[str, Callable[[], BinaryIO]]) -> None:
+            name, opener = item
+            try:
+                with opener() as source:
+                    self._consume(name, source, depth)
+            except BundleLimitError:
+                raise
+            except (OSError, zipfile.BadZipFile, RuntimeError, tarfile.TarError) as exc:
+                logger.warning("Skipping unreadable member %s: %s", name, exc)
+                with self._lock:
+                    self.skipped += 1
+
+        with ThreadPoolExecutor(max_workers=self.jobs, thread_name_prefix="unpack") as executor:
+            list(executor.map(consume, items))
+
+    def _unpack_directory(self, root: Path, prefix: str, depth: int) -> None:
+        items = []
+        for dirpath, dirnames, filenames in os.walk(root):
+            # Never descend into our own output when the bundle lives inside the input:
+            # kernagent_bundle/, and <file>_archive/ or <file>_bundle/ next to <file>.
+            dirnames[:] = [d for d in dirnames if not _is_own_output(d, filenames)]
+            for filename in sorted(filenames):
+                path = Path(dirpath) / filename
+                if path.is_symlink() or not path.is_file():
+                    continue
+                name = prefix + path.relative_to(root).as_posix()
+                items.append((name, lambda path=path: path.open("rb")))
+        self._parallel(items, depth)
+
+    def _unpack_zip(self, path: Path, prefix: str, depth: int) -> None:
+        local = threading.local()
+        handles: List[zipfile.ZipFile] = []
+
+        def opener(info: zipfile.ZipInfo) -> Callable[[], BinaryIO]:
+            def open_member() -> BinaryIO:
+                # ZipFile objects are not safe to share between threads; one per worker.
+                if not hasattr(local, "zf"):
+                    local.zf = zipfile.ZipFile(path)
+                    with self._lock:
+                        handles.append(local.zf)
+                return local.zf.open(info)
+
+            return open_member
+
+        with zipfile.ZipFile(path) as zf:
+            infos = [info for info in zf.infolist() if not info.is_dir()]
+        try:
+            self._parallel([(prefix + info.filename, opener(info)) for info in infos], depth)
+        finally:
+            for handle in handles:
+                handle.close()
+
+    def _unpack_tar(self, path: Path, prefix: str, depth: int) -> None:
+        # Compressed tar streams can only be read front to back.
+        with tarfile.open(path) as tf:
+            for info in tf:
+                if not info.isfile():
+                    continue
+                source = tf.extractfile(info)
+                if source is not None:
+                    with source:
+                        self._consume(prefix + info.name, source, depth)
+
+    def _unpack_stream(self, path: Path, kind: str, prefix: str, depth: int) -> None:
+        # One compressed file: its member is the file name without the compression suffix.
+        name = path.stem if path.suffix.lower() in {".gz", ".bz2", ".xz"} else f"{path.name}.out"
+        with _STREAM_OPENERS[kind](path) as source:
+            self._consume(prefix + name, source, depth)
+
+    def _unpack_7z(self, path: Path, prefix: str, depth: int) -> None:
+        tool = shutil.which("7z") or shutil.which("7zz") or shutil.which("7za")
+        if not tool:
+            raise SnapshotError(f"Unpacking {path.name} needs 7-Zip (7z) on PATH")
+        # 7z extracts everything at once, so the listed sizes are charged up front.
+        listing = subprocess.run([tool, "l", "-slt", str(path)], capture_output=True, text=True, check=False)
+        self._charge(sum(int(size) for size in re.findall(r"^Size = (\d+)$", listing.stdout, re.MULTILINE)))
+        with tempfile.TemporaryDirectory(dir=self.bundle_dir, prefix=".7z-") as tmp:
+            result = subprocess.run(
+                [tool, "x", "-y", "-bd", f"-o{tmp}", str(path)], capture_output=True, text=True, check=False
+            )
+            if result.returncode not in (0, 1):  # 1 = warnings (e.g. unsupported MSI streams)
+                raise SnapshotError(f"7z failed on {path.name}: {result.stderr.strip() or result.stdout.strip()}")
+            self._unpack_directory(Path(tmp), prefix, depth)
+
+
+def _build_in_process(binary_path: Path, output_dir: Optional[Path] = None, verbose: bool = False) -> Path:
+    # Runs in a worker process: pyghidra starts one JVM per process, and threads would share it.
+    return build_snapshot(binary_path, output_dir, verbose=verbose)
+
+
+def _snapshot_members(
+    bundle_dir: Path, members: List[Member], jobs: int, build: Callable[..., Path], verbose: bool
+) -> None:
+    pending = [member for member in members if member.state != "done"]
+    if not pending:
+        return
+    if verbose:
+        logger.info("Snapshotting %d members with %d workers", len(pending), jobs)
+
+    executor: Executor
+    if build is build_snapshot:
+        workers = min(jobs, len(pending))
+        executor = ProcessPoolExecutor(max_workers=workers, mp_context=multiprocessing.get_context("spawn"))
+        build = _build_in_process
+    else:  # injected builders (tests, callers with their own isolation) run on threads
+        executor = ThreadPoolExecutor(max_workers=jobs, thread_name_prefix="bundle")
+
+    with executor:
+        futures = [(member, executor.submit(build, bundle_dir / member.file, None, verbose=verbose)) for member in pending]
+        for member, future in futures:
+            try:
+                archive = future.result()
+                member.snapshot = str(Path(archive).relative_to(bundle_dir))
+                member.state, member.error = "done", None
+            except Exception as exc:
+                logger.error("Snapshot of %s failed: %s", member.path, exc)
+                member.state, member.error = "failed", str(exc)
+
+
+def load_manifest(bundle_dir: Path) -> Optional[Dict[str, object]]:
+    try:
+        return json.loads((bundle_dir / MANIFEST_NAME).read_text(encoding="utf-8"))
+    except (OSError, ValueError):
+        return None
+
+
+def build_bundle(
+    input_path: Path,
+    jobs: Optional[int] = None,
+    verbose: bool = False,
+    build: Callable[..., Path] = build_snapshot,
+    snapshot: bool = True,
+) -> Path:
+    """Unpack `input_path`, snapshot its distinct executables and return the bundle directory.
+
+    An existing bundle for the same input is reused; members whose snapshot
+    failed earlier are retried. With `snapshot` False the members are only
+    unpacked and recorded as pending.
+    """
+
+    input_path = Path(input_path)
+    kind = archive_kind(input_path)
+    if kind is None:
+        raise SnapshotError(f"Not an archive or directory: {input_path}")
+    jobs = jobs_from_env() if jobs is None else max(1, jobs)
+    bundle_dir = bundle_dir_for(input_path)
+    source_sha = None if kind == "directory" else _sha256_path(input_path)
+
+    previous = load_manifest(bundle_dir) or {}
+    if previous and kind != "directory" and previous.get("sha256") == source_sha:
+        members = [Member(**entry) for entry in previous.get("members", [])]
+        skipped = int(previous.get("skipped", 0))
+    else:
+        (bundle_dir / "members").mkdir(parents=True, exist_ok=True)
+        unpacker = _Unpacker(bundle_dir, jobs, *limits_from_env())
+        unpacker.unpack(input_path)
+        members = unpacker.finish()
+        skipped = unpacker.skipped
+        if verbose:
+            logger.info(
+                "%s: %d unique executables (%d duplicates, %d other files)",
+                input_path.name,
+                len(members),
+                sum(len(member.duplicates) for member in members),
+                skipped,
+            )
+        # A directory may have changed since the last run; keep snapshots of members that did not.
+        done = {entry["sha256"]: entry for entry in previous.get("members", []) if entry.get("state") == "done"}
+        for member in members:
+            earlier = done.get(member.sha256)
+            if earlier and earlier.get("snapshot") and (bundle_dir / earlier["snapshot"]).is_dir():
+                member.snapshot, member.state = earlier["snapshot"], "done"
+
+    if snapshot:
+        _snapshot_members(bundle_dir, members, jobs, build, verbose)
+    manifest = {
+        "version": MANIFEST_VERSION,
+        "source": str(input_path),
+        "kind": kind,
+        "sha256": source_sha,
+        "skipped": skipped,
+        "members": [asdict(member) for member in members],
+    }
+    tmp = bundle_dir / f".{MANIFEST_NAME}.tmp"
+    tmp.write_text(json.dumps(manifest, indent=2), encoding="utf-8")
+    tmp.replace(bundle_dir / MANIFEST_NAME)
+    return bundle_dir
+
+
+def member_snapshots(bundle_dir: Path) -> Iterator[Tuple[str, Path]]:
+    """(member path, snapshot directory) for every member snapshotted successfully."""
+
+    manifest = load_manifest(bundle_dir) or {}
+    for entry in manifest.get("members", []):
+        if entry.get("state") == "done" and entry.get("snapshot"):
+            yield entry["path"], bundle_dir / entry["snapshot"]
+
+
+__all__ = [
+    "BundleLimitError",
+    "Member",
+    "archive_kind",
+    "build_bundle",
+    "bundle_dir_for",
+    "executable_format",
+    "load_manifest",
+    "member_snapshots",
+]
@@ -2,13 +2,15 @@
 
 from __future__ import annotations
 
+import hashlib
 import json
 import os
+import time
 from collections import Counter
 from dataclasses import dataclass
 from datetime import datetime, timezone
 from pathlib import Path
-from typing import Any, Dict, Iterable, List, Optional
+from typing import Any, Dict, Iterable, List, Optional, Set
 
 from .log import get_logger
 
@@ -18,6 +20,8 @@ CAPA_SUMMARY_VERSION = "capa_summary_v1"
 CAPA_MAX_LOCATIONS_PER_RULE = 5
 CAPA_MAX_RULES_IN_SUMMARY = 200
 EXCLUDED_RULE_NAMES = {"contain loop"}
+CAPA_BACKEND_VIV = "viv"
+CAPA_BACKEND_GHIDRA = "ghidra"
 
 try:  # pragma: no cover - optional dependency resolved at runtime
     import capa.main
@@ -52,11 +56,159 @@ class CapaRuleSummary:
     match_count: int
 
 
+@dataclass
+class GhidraCapaContext:
+    """Handles to an already-analyzed Ghidra program for capa's Ghidra backend."""
+
+    program: Any
+    flat_api: Any
+    monitor: Any
+
+
 def _env_flag(name: str) -> bool:
     value = os.getenv(name, "")
     return value.lower() in {"1", "true", "yes", "on"}
 
 
+def _env_number(name: str, cast):
+    value = os.getenv(name, "").strip()
+    if not value:
+        return None
+    try:
+        number = cast(value)
+    except ValueError:
+        logger.warning("Ignoring invalid %s=%s", name, value)
+        return None
+    return number if number > 0 else None
+
+
+def resolve_capa_time_budget() -> Optional[float]:
+    """Wall-clock budget in seconds for capa rule matching (CAPA_TIMEOUT)."""
+
+    return _env_number("CAPA_TIMEOUT", float)
+
+
+def resolve_capa_max_functions() -> Optional[int]:
+    """Maximum number of functions capa should analyze (CAPA_MAX_FUNCTIONS)."""
+
+    return _env_number("CAPA_MAX_FUNCTIONS", int)
+
+
+def select_capa_functions(functions: Iterable[Dict[str, Any]], limit: int) -> Set[int]:
+    """
+    Pick the `limit` most interesting functions for function-scoped capa runs.
+
+    Functions are ranked by cyclomatic complexity, then size; thunks and
+    external stubs are skipped since capa rarely matches on them.
+    """
+
+    candidates = []
+    for func in functions:
+        ea = func.get("ea") or ""
+        try:
+            address = int(ea, 16)
+        except ValueError:
+            continue
+        metrics = func.get("metrics") or {}
+        if (metrics.get("instruction_count") or 0) <= 1:
+            continue
+        candidates.append(
+            (
+                -(metrics.get("cyclomatic_complexity") or 0),
+                -(metrics.get("size_bytes") or 0),
+                address,
+            )
+        )
+
+    candidates.sort()
+    return {address for _complexity, _size, address in candidates[:limit]}
+
+
+class _CapaBudget:
+    """
+    Bound capa's per-function work by a deadline and/or a function subset.
+
+    Installed by overriding methods on the feature extractor instance, so
+    capa's own isinstance() dispatch still sees the original extractor.
+    Once the deadline passes, remaining functions yield no features and are
+    counted as skipped; the file scope is still evaluated.
+    """
+
+    def __init__(
+        self,
+        time_budget: Optional[float],
+        function_addresses: Optional[Set[int]],
+        deadline: Optional[float] = None,
+    ):
+        self.time_budget = time_budget
+        self.function_addresses = function_addresses
+        if deadline is None and time_budget:
+            deadline = time.monotonic() + time_budget
+        self.deadline = deadline
+        self.analyzed = 0
+        self.skipped = 0
+        self.timed_out = False
+
+    def expired(self) -> bool:
+        if self.deadline is None or self.timed_out:
+            return self.timed_out
+        if time.monotonic() >= self.deadline:
+            self.timed_out = True
+        return self.timed_out
+
+    def install(self, extractor) -> None:
+        get_functions = extractor.get_functions
+        get_basic_blocks = extractor.get_basic_blocks
+        extract_function_features = extractor.extract_function_features
+        allowed = self.function_addresses
+
+        def budgeted_get_functions():
+            for fh in get_functions():
+                if allowed is not None and int(fh.address) not in allowed:
+                    continue
+                yield fh
+
+        def budgeted_extract_function_features(fh):
+            if self.expired():
+                self.skipped += 1
+                return iter(())
+            self.analyzed += 1
+            return extract_function_features(fh)
+
+        def budgeted_get_basic_blocks(fh):
+            if self.expired():
+                return iter(())
+            return get_basic_blocks(fh)
+
+        extractor.get_functions = budgeted_get_functions
+        extractor.extract_function_features = budgeted_extract_function_features
+        extractor.get_basic_blocks = budgeted_get_basic_blocks
+
+    def describe(self) -> Dict[str, Any]:
+        return {
+            "partial": self.timed_out or self.function_addresses is not None,
+            "timed_out": self.timed_out,
+            "time_budget_s": self.time_budget,
+            "function_scope": "all" if self.function_addresses is None else "selected",
+            "functions_selected": (
+                len(self.function_addresses) if self.function_addresses is not None else None
+            ),
+            "functions_analyzed": self.analyzed,
+            "functions_skipped": self.skipped,
+        }
+
+
+def resolve_capa_backend() -> str:
+    """Return the configured capa backend (CAPA_BACKEND env, default vivisect)."""
+
+    value = os.getenv("CAPA_BACKEND", CAPA_BACKEND_VIV).strip().lower()
+    if value in {CAPA_BACKEND_VIV, CAPA_BACKEND_GHIDRA}:
+        return value
+
+    logger.warning("Unknown CAPA_BACKEND=%s; falling back to %s", value, CAPA_BACKEND_VIV)
+    return CAPA_BACKEND_VIV
+
+
 def _resolve_rules_path(explicit: Optional[Path]) -> Optional[Path]:
     """Resolve capa rules directory (env override > explicit argument)."""
 
@@ -232,7 +384,22 @@ def _aggregate_highlights(rules: Iterable[CapaRuleSummary]) -> Dict[str, Any]:
     }
 
 
-def _analyze_with_capa(binary_path: Path, rules_path: Optional[Path]):
+def _get_ghidra_extractor(ghidra_context: GhidraCapaContext):
+    """Build capa's Ghidra feature extractor over an already-open program."""
+
+    import capa.features.extractors.ghidra.context as ghidra_ctx
+    import capa.features.extractors.ghidra.extractor as ghidra_extractor
+
+    ghidra_ctx.set_context(ghidra_context.program, ghidra_context.flat_api, ghidra_context.monitor)
+    return ghidra_extractor.GhidraFeatureExtractor()
+
+
+def _analyze_with_capa(
+    binary_path: Path,
+    rules_path: Optional[Path],
+    ghidra_context: Optional[GhidraCapaContext] = None,
+    budget: Optional[_CapaBudget] = None,
+):
     """Run capa analysis and return the result document."""
 
     if _CAPA_IMPORT_ERROR is not None:
@@ -243,15 +410,23 @@ def _analyze_with_capa(binary_path: Path, rules_path: Optional[Path]):
     rule_dirs = [rules_path] if rules_path else []
     rules = capa.rules.get_rules(rule_dirs)
 
-    extractor = capa.loader.get_extractor(
-        binary_path,
-        FORMAT_AUTO,
-        OS_AUTO,
-        capa.main.BACKEND_VIV,
-        [],
-        False,
-        disable_progress=True,
-    )
+    if ghidra_context is not None:
+        # Reuse Ghidra's analysis instead of re-disassembling with vivisect;
+        # capa function addresses then line up with functions.jsonl.
+        extractor = _get_ghidra_extractor(ghidra_context)
+    else:
+        extractor = capa.loader.get_extractor(
+            binary_path,
+            FORMAT_AUTO,
+            OS_AUTO,
+            capa.main.BACKEND_VIV,
+            [],
+            False,
+            disable_progress=True,
+        )
+
+    if budget is not None:
+        budget.install(extractor)
 
     capabilities = capa.capabilities.common.find_capabilities(rules, extractor, disable_progress=True)
 
@@ -271,30 +446,130 @@ def _analyze_with_capa(binary_path: Path, rules_path: Optional[Path]):
     return doc, rules
 
 
-def build_capa_summary(binary_path: Path, output_dir: Path, rules_path: Path | None = None) -> Optional[Path]:
+def _rules_fingerprint(rules_path: Optional[Path]) -> str:
+    """Stable hash of the rule pack (relative paths + contents of every rule file)."""
+
+    if rules_path is None:
+        return "builtin"
+
+    digest = hashlib.sha256()
+    rule_files = [rules_path] if rules_path.is_file() else sorted(
+        path for path in rules_path.rglob("*") if path.is_file() and path.suffix in {".yml", ".yaml"}
+    )
+    for path in rule_files:
+        digest.update(str(path.relative_to(rules_path.parent)).encode("utf-8"))
+        digest.update(b"\0")
+        digest.update(path.read_bytes())
+        digest.update(b"\0")
+    return digest.hexdigest()
+
+
+def _file_sha256(path: Path) -> str:
+    digest = hashlib.sha256()
+    with path.open("rb") as fh:
+        for chunk in iter(lambda: fh.read(1024 * 1024), b""):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+def resolve_capa_cache_dir() -> Optional[Path]:
+    """Shared capa result store (CAPA_CACHE_DIR, default ~/.cache/kernagent/capa)."""
+
+    if _env_flag("CAPA_CACHE_DISABLE"):
+        return None
+
+    env_value = os.getenv("CAPA_CACHE_DIR")
+    if env_value:
+        return Path(env_value).expanduser()
+
+    cache_home = Path(os.environ.get("XDG_CACHE_HOME", Path.home() / ".cache"))
+    return cache_home / "kernagent" / "capa"
+
+
+def _capa_cache_path(
+    cache_dir: Path,
+    sample_sha256: str,
+    rules_path: Optional[Path],
+    backend: str,
+) -> Path:
     """
-    Execute flare-capa on `binary_path` and write a filtered JSON summary.
+    Cache entry for (sample SHA-256, capa version, rule pack hash, backend).
 
-    Returns:
-        Path to capa_summary.json if generated, else None.
+    The backends recover different features, so they do not share entries.
+    Function selection is not part of the key: results limited to selected
+    functions are partial and never stored, and a complete result answers any
+    selection.
     """
 
-    if _env_flag("CAPA_DISABLE"):
-        logger.info("CAPA_DISABLE is set; skipping capa analysis.")
-        return None
+    key = hashlib.sha256(
+        f"{CAPA_VERSION}\0{_rules_fingerprint(rules_path)}\0{CAPA_SUMMARY_VERSION}\0{backend}".encode("utf-8")
+    ).hexdigest()[:32]
+    return cache_dir / sample_sha256[:2] / sample_sha256 / f"{key}.json"
 
-    binary_path = Path(binary_path)
-    output_dir = Path(output_dir)
-    output_dir.mkdir(parents=True, exist_ok=True)
 
-    resolved_rules = _resolve_rules_path(rules_path)
-    output_path = output_dir / "capa_summary.json"
+def _read_capa_cache(path: Path) -> Optional[Dict[str, Any]]:
+    try:
+        with path.open("r", encoding="utf-8") as fh:
+            entry = json.load(fh)
+    except FileNotFoundError:
+        return None
+    except (OSError, ValueError) as exc:
+        logger.warning("Ignoring unreadable capa cache entry %s: %s", path, exc)
+        return None
+    return entry if isinstance(entry, dict) and "payload" in entry else None
 
+
+def _write_capa_cache(path: Path, payload: Dict[str, Any]) -> None:
+    try:
+        path.parent.mkdir(parents=True, exist_ok=True)
+        tmp_path = path.with_suffix(f".{os.getpid()}.tmp")
+        with tmp_path.open("w", encoding="utf-8") as fh:
+            json.dump({"payload": payload}, fh)
+        os.replace(tmp_path, path)
+    except OSError as exc:
+        logger.warning("Could not write capa cache entry %s: %s", path, exc)
+
+
+def _run_capa_payload(
+    binary_path: Path,
+    resolved_rules: Optional[Path],
+    ghidra_context: Optional[GhidraCapaContext],
+    time_budget: Optional[float],
+    selected: Optional[Set[int]],
+) -> Optional[Dict[str, Any]]:
+    """Run capa and build the summary payload (rules may be empty); None on failure."""
+
+    backend = CAPA_BACKEND_GHIDRA if ghidra_context is not None else CAPA_BACKEND_VIV
+    budget = _CapaBudget(time_budget, selected)
+    started = time.monotonic()
     try:
-        doc, rules = _analyze_with_capa(binary_path, resolved_rules)
+        doc, rules = _analyze_with_capa(binary_path, resolved_rules, ghidra_context, budget=budget)
     except Exception as exc:  # pragma: no cover - depends on runtime environment
-        logger.warning("capa analysis failed for %s: %s", binary_path, exc)
-        return None
+        if ghidra_context is None:
+            logger.warning("capa analysis failed for %s: %s", binary_path, exc)
+            return None
+        logger.warning("capa Ghidra backend failed for %s (%s); retrying with vivisect", binary_path, exc)
+        backend = CAPA_BACKEND_VIV
+        if selected is not None:
+            # Ghidra's entry addresses need not match vivisect's on a rebased image.
+            logger.info("Matching all functions with vivisect; the function selection came from Ghidra")
+        # The retry spends what is left of the original budget, not a fresh one.
+        budget = _CapaBudget(time_budget, None, deadline=budget.deadline)
+        try:
+            doc, rules = _analyze_with_capa(binary_path, resolved_rules, budget=budget)
+        except Exception as viv_exc:
+            logger.warning("capa analysis failed for %s: %s", binary_path, viv_exc)
+            return None
+
+    analysis = budget.describe()
+    analysis["elapsed_s"] = round(time.monotonic() - started, 2)
+    if analysis["timed_out"]:
+        logger.warning(
+            "capa time budget (%ss) exhausted for %s; %d functions skipped, summary is partial",
+            time_budget,
+            binary_path.name,
+            analysis["functions_skipped"],
+        )
 
     summaries: List[CapaRuleSummary] = []
     for rule_name, rule_data in doc.rules.items():
@@ -302,10 +577,6 @@ def build_capa_summary(binary_path: Path, output_dir: Path, rules_path: Path | N
         if summary:
             summaries.append(summary)
 
-    if not summaries:
-        logger.info("capa produced no high-signal matches for %s", binary_path)
-        return None
-
     summaries = sorted(
         summaries,
         key=lambda entry: (-_rule_score(entry), entry.namespace or "", entry.name),
@@ -341,28 +612,118 @@ def build_capa_summary(binary_path: Path, output_dir: Path, rules_path: Path | N
         "path": str(binary_path),
     }
 
-    payload = {
+    return {
         "schema_version": CAPA_SUMMARY_VERSION,
         "capa_version": CAPA_VERSION,
+        "backend": backend,
         "generated_at": datetime.now(timezone.utc).isoformat().replace("+00:00", "Z"),
         "rules_source": str(resolved_rules) if resolved_rules else "builtin",
         "rules_loaded": len(rules),
+        "analysis": analysis,
         "sample": sample_meta,
         "counts": counts,
         "highlights": highlights,
         "rules": rules_payload,
     }
 
+
+def build_capa_summary(
+    binary_path: Path,
+    output_dir: Path,
+    rules_path: Path | None = None,
+    ghidra_context: GhidraCapaContext | None = None,
+    time_budget: float | None = None,
+    function_addresses: Iterable[int] | None = None,
+    sample_sha256: str | None = None,
+) -> Optional[Path]:
+    """
+    Execute flare-capa on `binary_path` and write a filtered JSON summary.
+
+    Complete (non-partial) results are cached in resolve_capa_cache_dir(),
+    keyed by sample SHA-256, capa version, a hash of the rule files and the
+    backend, and reused on the next build of the same sample.
+
+    Args:
+        ghidra_context: When provided, capa reads features from this open
+            Ghidra program instead of running its own vivisect analysis.
+            Falls back to vivisect if the Ghidra backend fails.
+        time_budget: Wall-clock seconds for rule matching (defaults to
+            CAPA_TIMEOUT). Functions not reached in time are skipped and the
+            summary is marked partial.
+        function_addresses: Restrict function-scope matching to these
+            addresses (see select_capa_functions).
+        sample_sha256: Precomputed SHA-256 of the sample (avoids rehashing).
+
+    Returns:
+        Path to capa_summary.json if generated, else None.
+    """
+
+    if _env_flag("CAPA_DISABLE"):
+        logger.info("CAPA_DISABLE is set; skipping capa analysis.")
+        return None
+
+    binary_path = Path(binary_path)
+    output_dir = Path(output_dir)
+    output_dir.mkdir(parents=True, exist_ok=True)
+
+    resolved_rules = _resolve_rules_path(rules_path)
+    output_path = output_dir / "capa_summary.json"
+
+    if time_budget is None:
+        time_budget = resolve_capa_time_budget()
+    selected = set(function_addresses) if function_addresses is not None else None
+    backend = CAPA_BACKEND_GHIDRA if ghidra_context is not None else CAPA_BACKEND_VIV
+
+    cache_path: Optional[Path] = None
+    cache_dir = resolve_capa_cache_dir()
+    if cache_dir is not None:
+        try:
+            sha256 = sample_sha256 or _file_sha256(binary_path)
+            cache_path = _capa_cache_path(cache_dir, sha256, resolved_rules, backend)
+        except OSError as exc:
+            logger.warning("capa cache disabled for %s: %s", binary_path, exc)
+
+    cached = _read_capa_cache(cache_path) if cache_path is not None else None
+    if cached is not None:
+        logger.info("Reusing cached capa results for %s", binary_path.name)
+        payload = cached["payload"]
+        if payload is not None:
+            payload["sample"]["path"] = str(binary_path)
+            payload["cached"] = True
+    else:
+        payload = _run_capa_payload(binary_path, resolved_rules, ghidra_context, time_budget, selected)
+        if payload is None:
+            return None
+        if cache_path is not None and not payload["analysis"]["partial"]:
+            if payload["backend"] != backend:  # Ghidra backend failed and vivisect ran instead
+                cache_path = _capa_cache_path(cache_dir, sha256, resolved_rules, payload["backend"])
+            _write_capa_cache(cache_path, payload)
+
+    if payload is None or not payload["rules"]:
+        logger.info("capa produced no high-signal matches for %s", binary_path)
+        return None
+
     with output_path.open("w", encoding="utf-8") as fh:
         json.dump(payload, fh, indent=2)
 
     logger.info(
         "capa summary written for %s (%d rules, %d attack mappings)",
         binary_path.name,
-        counts["rules"],
-        counts["attack_mappings"],
+        payload["counts"]["rules"],
+        payload["counts"]["attack_mappings"],
     )
     return output_path
 
 
-__all__ = ["build_capa_summary", "CAPA_SUMMARY_VERSION"]
+__all__ = [
+    "build_capa_summary",
+    "resolve_capa_backend",
+    "resolve_capa_cache_dir",
+    "resolve_capa_max_functions",
+    "resolve_capa_time_budget",
+    "select_capa_functions",
+    "GhidraCapaContext",
+    "CAPA_SUMMARY_VERSION",
+    "CAPA_BACKEND_VIV",
+    "CAPA_BACKEND_GHIDRA",
+]
@@ -4,16 +4,24 @@ from __future__ import annotations
 
 import argparse
 import json
+import sys
 import zipfile
-from pathlib import Path, PureWindowsPath
+from pathlib import Path
+from typing import Optional
 
 from .agent import ReverseEngineeringAgent
+from .bundle import archive_kind, build_bundle, load_manifest, member_snapshots
 from .config import load_settings
+from .hypotheses import HypothesisCoordinator
+from .llm_cache import ResponseCache, cached_chat_content
 from .llm_client import LLMClient
 from .log import get_logger, setup_logging
-from .oneshot import OneshotPruningError, build_oneshot_summary
+from .oneshot import OneshotPruningError, build_oneshot_summary, run_sectioned_oneshot
 from .prompts import AUTO_SUMMARY_ONESHOT_SYSTEM_PROMPT, ONESHOT_SYSTEM_PROMPT, TOOLS
-from .snapshot import SnapshotError, SnapshotTools, build_snapshot, build_tool_map
+from .session import AskSession, load_questions
+from .snapshot import SnapshotError, SnapshotTools, build_prefetch_warmers, build_snapshot, build_tool_map
+from .snapshot.lazyzip import lazy_enabled, open_snapshot_zip, validate_member_name
+from .watch import Processor, WatchPipeline, jobs_from_env
 
 logger = get_logger(__name__)
 
@@ -33,14 +41,54 @@ def build_parser() -> argparse.ArgumentParser:
     summary = subparsers.add_parser("summary", help="Generate executive summary.")
     add_binary_argument(summary)
     summary.add_argument("--json", action="store_true", help="Output raw JSON instead of LLM analysis.")
+    summary.add_argument("--no-cache", action="store_true", help="Bypass the local LLM response cache.")
 
     ask = subparsers.add_parser("ask", help="Ask a custom question about the binary.")
     add_binary_argument(ask)
-    ask.add_argument("question", help="Question to run through the agent.")
+    ask.add_argument("question", nargs="?", help="Question to run through the agent (omit for a prompt).")
+    ask.add_argument(
+        "--questions", type=Path, help="File with one question per line ('-' for stdin), answered in one session."
+    )
+    ask.add_argument("--jobs", type=int, default=1, help="Answer up to N --questions concurrently.")
+    ask.add_argument(
+        "--hypotheses",
+        action="store_true",
+        help="Investigate each import capability with a parallel sub-agent and merge their findings.",
+    )
 
     oneshot = subparsers.add_parser("oneshot", help="Generate deterministic pruned summary.")
     add_binary_argument(oneshot)
     oneshot.add_argument("--json", action="store_true", help="Output raw JSON instead of LLM analysis.")
+    oneshot.add_argument("--no-cache", action="store_true", help="Bypass the local LLM response cache.")
+    oneshot.add_argument(
+        "--sectioned",
+        action="store_true",
+        help="Analyze imports, strings, key functions and capa concurrently, then merge the reports.",
+    )
+    oneshot.add_argument("--jobs", type=int, help="Sections analyzed at once with --sectioned (default 4).")
+
+    unpack = subparsers.add_parser(
+        "unpack", help="Snapshot every distinct executable in an archive, installer or directory."
+    )
+    unpack.add_argument("binary", type=Path, help="ZIP/tar/MSI/CAB/7z archive or directory.")
+    unpack.add_argument("--jobs", type=int, help="Members unpacked and snapshotted at once (default: 2).")
+
+    watch = subparsers.add_parser("watch", help="Snapshot and report on every sample dropped into a directory.")
+    watch.add_argument("directory", type=Path, help="Spool directory to watch.")
+    watch.add_argument(
+        "--output", type=Path, help="Where <sha256>/ result directories are written (default: <directory>/kernagent)."
+    )
+    watch.add_argument(
+        "--report",
+        choices=("summary", "oneshot", "json"),
+        default="summary",
+        help="Report written per sample: summary (default), oneshot triage, or the pruned JSON without an LLM.",
+    )
+    watch.add_argument("--jobs", type=int, help="Samples analyzed at once (default 2).")
+    watch.add_argument(
+        "--settle", type=float, default=1.0, help="Seconds a file must stay unchanged before it is analyzed."
+    )
+    watch.add_argument("--no-cache", action="store_true", help="Bypass the local LLM response cache.")
 
     return parser
 
@@ -62,23 +110,8 @@ def _safe_extract_zip(zip_path: Path, destination: Path) -> None:
 
     with zipfile.ZipFile(zip_path, "r") as zf:
         for member in zf.infolist():
-            member_name = member.filename
-            if not member_name:
-                continue
-
-            member_path = Path(member_name)
-            if member_path.is_absolute() or member_path.drive:
-                raise SnapshotError(f"Unsafe absolute path in archive entry: {member_name}")
-
-            if PureWindowsPath(member_name).drive:
-                raise SnapshotError(f"Unsafe absolute path in archive entry: {member_name}")
-
-            if any(part == ".." for part in member_path.parts):
-                raise SnapshotError(f"Unsafe relative path in archive entry: {member_name}")
-
-            target_path = (dest_root / member_path).resolve(strict=False)
-            if not str(target_path).startswith(str(dest_root)):
-                raise SnapshotError(f"Archive entry escapes destination: {member_name}")
+            if member.filename:
+                validate_member_name(member.filename, dest_root)
 
         zf.extractall(dest_root)
 
@@ -87,6 +120,13 @@ def _maybe_unpack_zip(zip_path: Path) -> Path | None:
     if not zip_path.exists():
         return None
     archive_dir = zip_path.parent / zip_path.stem
+    if lazy_enabled():
+        # Only the JSON artifacts now; decompilation is extracted as tools read it.
+        try:
+            return open_snapshot_zip(zip_path)
+        except SnapshotError as exc:
+            logger.error("Failed to open snapshot zip %s: %s", zip_path, exc)
+            raise
     logger.info("Extracting snapshot zip %s", zip_path)
     try:
         _safe_extract_zip(zip_path, zip_path.parent)
@@ -110,16 +150,56 @@ def ensure_snapshot(binary_path: Path, verbose: bool = False) -> Path:
     return build_snapshot(binary_path, None, verbose=verbose)
 
 
-def run_agent_and_print(archive_dir: Path, question: str, settings, verbose: bool) -> None:
+def run_agent_and_print(archive_dir: Path, question: str, settings, verbose: bool, hypotheses: bool = False) -> None:
     snapshot = SnapshotTools(archive_dir)
-    tool_map = build_tool_map(snapshot)
     llm = LLMClient(settings)
-    agent = ReverseEngineeringAgent(llm, TOOLS, tool_map)
+    if hypotheses:
+        print(HypothesisCoordinator(llm, snapshot).run(question, verbose=verbose))
+        return
+    tool_map = build_tool_map(snapshot)
+    agent = ReverseEngineeringAgent(llm, TOOLS, tool_map, warmers=build_prefetch_warmers(snapshot))
     answer = agent.run(question, verbose=verbose)
     print(answer)
 
 
-def run_oneshot_and_print(archive_dir: Path, settings, verbose: bool, json_output: bool = False) -> None:
+def run_questions_and_print(archive_dir: Path, questions, settings, verbose: bool, jobs: int = 1) -> None:
+    """Answer several questions with one snapshot, sharing caches and earlier findings."""
+
+    session = AskSession(archive_dir, LLMClient(settings))
+    answers = session.ask_many(questions, jobs=jobs, verbose=verbose)
+    for number, (question, answer) in enumerate(zip(questions, answers), 1):
+        print(f"## Q{number}: {question}\n\n{answer}\n")
+
+
+def run_interactive(archive_dir: Path, settings, verbose: bool, input_fn=input) -> None:
+    """Prompt for questions until EOF or `exit`; `:reset` forgets earlier findings."""
+
+    session = AskSession(archive_dir, LLMClient(settings))
+    while True:
+        try:
+            question = input_fn("kernagent> ").strip()
+        except (EOFError, KeyboardInterrupt):
+            print()
+            return
+        if not question:
+            continue
+        if question in {"exit", "quit"}:
+            return
+        if question == ":reset":
+            session.reset()
+            continue
+        print(session.ask(question, verbose=verbose))
+
+
+def run_oneshot_and_print(
+    archive_dir: Path,
+    settings,
+    verbose: bool,
+    json_output: bool = False,
+    use_cache: bool = True,
+    sectioned: bool = False,
+    jobs: Optional[int] = None,
+) -> None:
     summary = build_oneshot_summary(archive_dir, verbose=verbose)
 
     if json_output:
@@ -127,23 +207,34 @@ def run_oneshot_and_print(archive_dir: Path, settings, verbose: bool, json_outpu
         return
 
     llm = LLMClient(settings)
+    if sectioned:
+        cache = ResponseCache.from_env() if use_cache else None
+        print(run_sectioned_oneshot(llm, settings, summary, cache=cache, jobs=jobs, verbose=verbose))
+        return
+
     payload = json.dumps(summary, indent=2)
     try:
-        response = llm.chat(
-            verbose=verbose,
-            messages=[
+        content = cached_chat_content(
+            llm,
+            settings,
+            [
                 {"role": "system", "content": ONESHOT_SYSTEM_PROMPT},
                 {"role": "user", "content": payload},
             ],
+            cache=ResponseCache.from_env() if use_cache else None,
+            verbose=verbose,
             temperature=0,
+            phase="oneshot",
         )
     except Exception as exc:  # pragma: no cover - network dependent
         logger.error("Oneshot LLM call failed: %s", exc)
         raise
-    print(response.choices[0].message.content or "")
+    print(content)
 
 
-def run_summary_and_print(archive_dir: Path, settings, verbose: bool, json_output: bool = False) -> None:
+def run_summary_and_print(
+    archive_dir: Path, settings, verbose: bool, json_output: bool = False, use_cache: bool = True
+) -> None:
     """
     Lightweight summary path intended to work well on smaller LLMs.
 
@@ -151,6 +242,7 @@ def run_summary_and_print(archive_dir: Path, settings, verbose: bool, json_outpu
     - Build deterministic pruned snapshot via build_oneshot_summary()
     - Single chat completion with AUTO_SUMMARY_ONESHOT_SYSTEM_PROMPT
     - No tools/function-calling at inference time
+    - Responses are cached on disk (see llm_cache) unless use_cache is False
     """
     summary = build_oneshot_summary(archive_dir, verbose=verbose)
 
@@ -162,19 +254,136 @@ def run_summary_and_print(archive_dir: Path, settings, verbose: bool, json_outpu
 
     llm = LLMClient(settings)
     try:
-        response = llm.chat(
-            verbose=verbose,
-            messages=[
+        content = cached_chat_content(
+            llm,
+            settings,
+            [
                 {"role": "system", "content": AUTO_SUMMARY_ONESHOT_SYSTEM_PROMPT},
                 {"role": "user", "content": payload},
             ],
+            cache=ResponseCache.from_env() if use_cache else None,
+            verbose=verbose,
             temperature=0,
+            phase="oneshot",
         )
     except Exception as exc:  # pragma: no cover - network dependent
         logger.error("Summary LLM call failed: %s", exc)
         raise
 
-    print(response.choices[0].message.content or "")
+    print(content)
+
+
+def run_bundle(args, settings, input_path: Path) -> None:
+    """Archive, installer or directory input: snapshot each distinct executable, then run the command per member."""
+
+    jobs = args.jobs if args.command == "unpack" else None
+    try:
+        bundle_dir = build_bundle(input_path, jobs=jobs, verbose=args.verbose)
+    except SnapshotError as exc:
+        logger.error("Unpacking %s failed: %s", input_path, exc)
+        raise SystemExit(str(exc)) from exc
+    manifest = load_manifest(bundle_dir) or {}
+    if not manifest.get("members"):
+        # Documents and packages (docx, xlsm, jar, apk, doc, xls) are ZIP/OLE containers too.
+        raise SystemExit(f"no executable members in {input_path}")
+    members = list(member_snapshots(bundle_dir))
+    failed = [entry for entry in manifest.get("members", []) if entry.get("state") != "done"]
+
+    if args.command == "unpack":
+        for entry in manifest.get("members", []):
+            duplicates = f" (+{len(entry['duplicates'])} duplicates)" if entry.get("duplicates") else ""
+            print(f"{entry['state']:<7} {entry['format']:<6} {entry['path']}{duplicates}")
+        print(f"\n{len(members)} snapshots, {len(failed)} failed, {manifest.get('skipped', 0)} non-executable files")
+        print(f"Manifest: {bundle_dir / 'manifest.json'}")
+        return
+
+    json_output = getattr(args, "json", False)
+    use_cache = not getattr(args, "no_cache", False)
+    if json_output:
+        reports = {path: build_oneshot_summary(archive_dir, verbose=args.verbose) for path, archive_dir in members}
+        print(json.dumps({"manifest": str(bundle_dir / "manifest.json"), "members": reports}, indent=2))
+        return
+    for path, archive_dir in members:
+        print(f"## {path}\n")
+        if args.command == "summary":
+            run_summary_and_print(archive_dir, settings, args.verbose, use_cache=use_cache)
+        else:
+            run_oneshot_and_print(
+                archive_dir,
+                settings,
+                args.verbose,
+                use_cache=use_cache,
+                sectioned=getattr(args, "sectioned", False),
+                jobs=getattr(args, "jobs", None),
+            )
+        print()
+    for entry in failed:
+        print(f"## {entry['path']}\n\nSnapshot failed: {entry.get('error')}\n")
+
+
+def bundle_member_for_ask(input_path: Path, verbose: bool) -> Path:
+    """Snapshot of the only executable in an archive; `ask` is about one binary."""
+
+    try:
+        bundle_dir = build_bundle(input_path, verbose=verbose, snapshot=False)
+        entries = (load_manifest(bundle_dir) or {}).get("members", [])
+        if not entries:
+            raise SystemExit(f"no executable members in {input_path}")
+        if len(entries) > 1:
+            files = "\n".join(f"  {bundle_dir / entry['file']}" for entry in entries)
+            raise SystemExit(f"{input_path.name} holds {len(entries)} executables; ask about one of them:\n{files}")
+        build_bundle(input_path, verbose=verbose)
+    except SnapshotError as exc:
+        logger.error("Unpacking %s failed: %s", input_path, exc)
+        raise SystemExit(str(exc)) from exc
+    for _path, archive_dir in member_snapshots(bundle_dir):
+        return archive_dir
+    entry = (load_manifest(bundle_dir) or {}).get("members", [{}])[0]
+    raise SystemExit(f"Snapshot of {entry.get('path')} failed: {entry.get('error')}")
+
+
+def build_watch_processor(settings, report: str, verbose: bool, use_cache: bool = True) -> Processor:
+    """Snapshot a sample into its result directory and write the requested report next to it."""
+
+    prompts = {"summary": AUTO_SUMMARY_ONESHOT_SYSTEM_PROMPT, "oneshot": ONESHOT_SYSTEM_PROMPT}
+    llm = LLMClient(settings) if report in prompts else None
+    cache = ResponseCache.from_env() if use_cache else None
+
+    def process(sample: Path, result_dir: Path):
+        archive_dir = build_snapshot(sample, result_dir / f"{sample.stem}_archive", verbose=verbose)
+        summary = build_oneshot_summary(archive_dir, verbose=verbose)
+        if llm is None:
+            name, content = "summary.json", json.dumps(summary, indent=2)
+        else:
+            name = f"{report}.md"
+            content = cached_chat_content(
+                llm,
+                settings,
+                [
+                    {"role": "system", "content": prompts[report]},
+                    {"role": "user", "content": json.dumps(summary, indent=2)},
+                ],
+                cache=cache,
+                verbose=verbose,
+                temperature=0,
+                phase="oneshot",
+            )
+        tmp = result_dir / f".{name}.tmp"
+        tmp.write_text(content, encoding="utf-8")
+        tmp.replace(result_dir / name)
+        return [name]
+
+    return process
+
+
+def run_watch(args, settings) -> None:
+    directory = args.directory.expanduser().resolve()
+    if not directory.is_dir():
+        raise SystemExit(f"Not a directory: {directory}")
+    output_dir = (args.output or directory / "kernagent").expanduser().resolve()
+    process = build_watch_processor(settings, args.report, args.verbose, use_cache=not args.no_cache)
+    jobs = args.jobs if args.jobs is not None else jobs_from_env()
+    WatchPipeline(directory, output_dir, process, jobs=jobs, settle=args.settle).run()
 
 
 def main() -> None:
@@ -186,37 +395,76 @@ def main() -> None:
     # Configure logging - only debug mode shows httpx logs
     setup_logging(settings.debug)
 
-    # Apply CLI overrides to settings
-    if args.model:
-        settings.model = args.model
-    if args.base_url:
-        settings.base_url = args.base_url
-    if args.api_key:
-        settings.api_key = args.api_key
+    # Apply CLI overrides to settings; they also replace any per-phase routing
+    for field_name in ("model", "base_url", "api_key"):
+        value = getattr(args, field_name)
+        if value:
+            setattr(settings, field_name, value)
+            for route in settings.routes.values():
+                route.pop(field_name, None)
+
+    if args.command == "watch":
+        run_watch(args, settings)
+        return
 
     binary_path = Path(args.binary).expanduser().resolve()
     if not binary_path.exists():
         raise FileNotFoundError(binary_path)
 
-    try:
-        archive_dir = ensure_snapshot(binary_path, verbose=args.verbose)
-    except SnapshotError as exc:
-        logger.error("Snapshot build failed: %s", exc)
-        raise SystemExit(str(exc)) from exc
+    bundle_kind = archive_kind(binary_path)
+    if args.command == "ask" and bundle_kind:
+        archive_dir = bundle_member_for_ask(binary_path, args.verbose)
+    elif args.command == "unpack" or bundle_kind:
+        try:
+            run_bundle(args, settings, binary_path)
+        except OneshotPruningError as exc:
+            raise SystemExit(str(exc)) from exc
+        return
+    else:
+        try:
+            archive_dir = ensure_snapshot(binary_path, verbose=args.verbose)
+        except SnapshotError as exc:
+            logger.error("Snapshot build failed: %s", exc)
+            raise SystemExit(str(exc)) from exc
 
     if args.command == "summary":
         try:
             json_output = getattr(args, "json", False)
-            run_summary_and_print(archive_dir, settings, args.verbose, json_output)
+            run_summary_and_print(
+                archive_dir, settings, args.verbose, json_output, use_cache=not getattr(args, "no_cache", False)
+            )
         except OneshotPruningError as exc:
             logger.error("Summary build failed: %s", exc)
             raise SystemExit(str(exc)) from exc
     elif args.command == "ask":
-        run_agent_and_print(archive_dir, args.question, settings, args.verbose)
+        questions_file = getattr(args, "questions", None)
+        if questions_file:
+            if str(questions_file) == "-":
+                questions = load_questions(sys.stdin)
+            else:
+                with questions_file.expanduser().open("r", encoding="utf-8") as f:
+                    questions = load_questions(f)
+            if args.question:
+                questions.insert(0, args.question)
+            run_questions_and_print(archive_dir, questions, settings, args.verbose, jobs=getattr(args, "jobs", 1))
+        elif args.question:
+            run_agent_and_print(
+                archive_dir, args.question, settings, args.verbose, hypotheses=getattr(args, "hypotheses", False)
+            )
+        else:
+            run_interactive(archive_dir, settings, args.verbose)
     elif args.command == "oneshot":
         try:
             json_output = getattr(args, "json", False)
-            run_oneshot_and_print(archive_dir, settings, args.verbose, json_output)
+            run_oneshot_and_print(
+                archive_dir,
+                settings,
+                args.verbose,
+                json_output,
+                use_cache=not getattr(args, "no_cache", False),
+                sectioned=getattr(args, "sectioned", False),
+                jobs=getattr(args, "jobs", None),
+            )
         except OneshotPruningError as exc:
             raise SystemExit(str(exc)) from exc
     else:  # pragma: no cover
@@ -3,8 +3,9 @@
 from __future__ import annotations
 
 import os
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from pathlib import Path
+from typing import Dict, Optional
 
 try:
     from dotenv import load_dotenv
@@ -12,6 +13,20 @@ except ImportError:  # pragma: no cover - optional dependency
     load_dotenv = None
 
 
+# Phases that can be routed to their own model/endpoint, and where each escalates on failure.
+PHASES = ("explore", "synthesis", "oneshot")
+ESCALATION = {"explore": "synthesis", "oneshot": "synthesis"}
+
+
+@dataclass
+class ModelRoute:
+    """Model and endpoint used for one phase."""
+
+    model: str
+    base_url: str
+    api_key: str
+
+
 @dataclass
 class Settings:
     """Container for runtime configuration values."""
@@ -20,6 +35,34 @@ class Settings:
     base_url: str = os.getenv("OPENAI_BASE_URL", "http://localhost:1234/v1")
     model: str = os.getenv("OPENAI_MODEL", "kernagent-default-model")
     debug: bool = os.getenv("DEBUG", "false").lower() == "true"
+    # Per-phase overrides ({"explore": {"model": ..., "base_url": ...}}); unset keys use the defaults above.
+    routes: Dict[str, Dict[str, str]] = field(default_factory=dict)
+
+    def route(self, phase: Optional[str] = None) -> ModelRoute:
+        override = self.routes.get(phase or "", {})
+        return ModelRoute(
+            model=override.get("model") or self.model,
+            base_url=override.get("base_url") or self.base_url,
+            api_key=override.get("api_key") or self.api_key,
+        )
+
+
+def _load_routes() -> Dict[str, Dict[str, str]]:
+    routes: Dict[str, Dict[str, str]] = {}
+    for phase in PHASES:
+        suffix = phase.upper()
+        override = {
+            key: value
+            for key, value in (
+                ("model", os.getenv(f"OPENAI_MODEL_{suffix}")),
+                ("base_url", os.getenv(f"OPENAI_BASE_URL_{suffix}")),
+                ("api_key", os.getenv(f"OPENAI_API_KEY_{suffix}")),
+            )
+            if value
+        }
+        if override:
+            routes[phase] = override
+    return routes
 
 
 def load_settings() -> Settings:
@@ -42,4 +85,5 @@ def load_settings() -> Settings:
         base_url=os.getenv("OPENAI_BASE_URL", "http://localhost:1234/v1"),
         model=os.getenv("OPENAI_MODEL", "kernagent-default-model"),
         debug=os.getenv("DEBUG", "false").lower() == "true",
+        routes=_load_routes(),
     )
@@ -0,0 +1,123 @@
+"""Deadlines and cooperative cancellation for tool calls.
+
+The agent runs each tool handler on a worker thread under a ``Deadline``.
+Long scans in the snapshot tools poll ``cancelled()`` between records and,
+once it is true, stop and return what they have flagged as truncated. A
+handler that blocks without checking (waiting on I/O or a lock) is abandoned
+after a short grace period and reported as timed out; its thread is a daemon
+and exits at its next check. Code that holds the GIL cannot be abandoned this
+way: ``re`` keeps it for a whole match, so search patterns that could
+backtrack catastrophically are rejected before compiling
+(``snapshot.tools.compile_search_pattern``).
+"""
+
+from __future__ import annotations
+
+import os
+import threading
+import time
+from contextlib import contextmanager
+from typing import Any, Callable, Dict, Iterator, Optional
+
+from .log import get_logger
+
+logger = get_logger(__name__)
+
+DEFAULT_TOOL_TIMEOUT = 30.0
+# Time a cancelled handler gets to return its partial result.
+GRACE_SECONDS = 1.0
+
+_local = threading.local()
+
+
+class ToolTimeoutError(TimeoutError):
+    """A tool handler did not return within its deadline plus the grace period."""
+
+
+class Deadline:
+    """A point in time after which the current tool call should wrap up."""
+
+    def __init__(self, seconds: Optional[float]):
+        self.expires_at = time.monotonic() + seconds if seconds else None
+        self._cancelled = threading.Event()
+
+    def cancel(self) -> None:
+        self._cancelled.set()
+
+    def expired(self) -> bool:
+        if self._cancelled.is_set():
+            return True
+        return self.expires_at is not None and time.monotonic() >= self.expires_at
+
+
+@contextmanager
+def deadline_scope(deadline: Optional[Deadline]) -> Iterator[None]:
+    """Make `deadline` the one `cancelled()` checks on this thread."""
+
+    previous = getattr(_local, "deadline", None)
+    _local.deadline = deadline
+    try:
+        yield
+    finally:
+        _local.deadline = previous
+
+
+def cancelled() -> bool:
+    """True once the current tool call's deadline has passed."""
+
+    deadline = getattr(_local, "deadline", None)
+    return deadline is not None and deadline.expired()
+
+
+def tool_timeout_from_env() -> float:
+    value = os.getenv("KERNAGENT_TOOL_TIMEOUT", "").strip()
+    try:
+        return max(0.0, float(value)) if value else DEFAULT_TOOL_TIMEOUT
+    except ValueError:
+        logger.warning("Ignoring invalid KERNAGENT_TOOL_TIMEOUT=%s", value)
+        return DEFAULT_TOOL_TIMEOUT
+
+
+def call_with_deadline(
+    handler: Callable[..., Any], kwargs: Dict[str, Any], seconds: Optional[float], grace: Optional[float] = None
+) -> Any:
+    """Run ``handler(**kwargs)`` under a deadline of `seconds` (None/0 = no limit).
+
+    Raises ToolTimeoutError if the handler is still running `grace` seconds
+    after the deadline; exceptions from the handler propagate unchanged.
+    """
+
+    if not seconds:
+        return handler(**kwargs)
+
+    if grace is None:
+        grace = GRACE_SECONDS
+    deadline = Deadline(seconds)
+    outcome: Dict[str, Any] = {}
+
+    def target() -> None:
+        with deadline_scope(deadline):
+            try:
+                outcome["result"] = handler(**kwargs)
+            except BaseException as exc:  # re-raised on the caller's thread
+                outcome["error"] = exc
+
+    thread = threading.Thread(target=target, name="tool-call", daemon=True)
+    thread.start()
+    thread.join(seconds + grace)
+    if thread.is_alive():
+        deadline.cancel()
+        raise ToolTimeoutError(f"Tool did not finish within {seconds:g}s")
+    if "error" in outcome:
+        raise outcome["error"]
+    return outcome["result"]
+
+
+__all__ = [
+    "Deadline",
+    "ToolTimeoutError",
+    "call_with_deadline",
+    "cancelled",
+    "deadline_scope",
+    "tool_timeout_from_env",
+]
@@ -0,0 +1,165 @@
+"""Coordinator that explores capability hypotheses with parallel sub-agents.
+
+A broad question ("what does this do?") otherwise walks network, persistence,
+crypto and injection one after another in a single tool loop. Here the
+oneshot pruner's import buckets seed one focused sub-agent per detected
+capability; the sub-agents run concurrently over forks of one
+``SnapshotTools`` (shared caches, separate token budgets) and a shared memo of
+tool results, and a final tool-free completion merges their reports.
+"""
+
+from __future__ import annotations
+
+import json
+import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass
+from typing import Any, Callable, Dict, List, Optional
+
+from .agent import ReverseEngineeringAgent
+from .log import get_logger
+from .oneshot import import_capability_buckets
+from .prompts import HYPOTHESIS_MERGE_SYSTEM_PROMPT, HYPOTHESIS_PROMPT, TOOLS
+from .snapshot import SnapshotTools, build_prefetch_warmers, build_tool_map
+
+logger = get_logger(__name__)
+
+DEFAULT_MAX_HYPOTHESES = 4
+DEFAULT_JOBS = 4
+DEFAULT_SUB_ITERATIONS = 8
+APIS_PER_HYPOTHESIS = 12
+
+# Results of these depend on the calling agent's token budget, so they are never shared.
+UNSHARED_TOOLS = frozenset({"read_decompilation", "read_decompilation_slice"})
+
+
+@dataclass
+class HypothesisReport:
+    capability: str
+    apis: List[str]
+    answer: str
+
+
+def _env_int(name: str, default: int) -> int:
+    value = os.getenv(name, "").strip()
+    try:
+        return int(value) if value else default
+    except ValueError:
+        logger.warning("Ignoring invalid %s=%s", name, value)
+        return default
+
+
+def shared_tool_map(tool_map: Dict[str, Callable[..., Any]], memo: Dict[str, Any], lock: threading.Lock):
+    """Wrap `tool_map` so identical calls from any sub-agent are answered once (timed-out results are not kept)."""
+
+    def wrap(name: str, handler: Callable[..., Any]) -> Callable[..., Any]:
+        if name in UNSHARED_TOOLS:
+            return handler
+
+        def shared(**kwargs: Any) -> Any:
+            key = name + json.dumps(kwargs, sort_keys=True, default=str)
+            with lock:
+                if key in memo:
+                    return memo[key]
+            result = handler(**kwargs)
+            # A result cut short by the tool deadline may complete on a retry.
+            if isinstance(result, dict) and result.get("timed_out"):
+                return result
+            with lock:
+                memo.setdefault(key, result)
+            return result
+
+        return shared
+
+    return {name: wrap(name, handler) for name, handler in tool_map.items()}
+
+
+class HypothesisCoordinator:
+    """Answer one question by fanning out capability-focused sub-agents."""
+
+    def __init__(
+        self,
+        llm: Any,
+        snapshot: SnapshotTools,
+        max_hypotheses: Optional[int] = None,
+        jobs: Optional[int] = None,
+        sub_iterations: Optional[int] = None,
+        agent_factory: Callable[..., ReverseEngineeringAgent] = ReverseEngineeringAgent,
+    ):
+        self.llm = llm
+        self.snapshot = snapshot
+        if max_hypotheses is None:
+            max_hypotheses = _env_int("KERNAGENT_HYPOTHESIS_MAX", DEFAULT_MAX_HYPOTHESES)
+        if jobs is None:
+            jobs = _env_int("KERNAGENT_HYPOTHESIS_JOBS", DEFAULT_JOBS)
+        if sub_iterations is None:
+            sub_iterations = _env_int("KERNAGENT_HYPOTHESIS_ITERATIONS", DEFAULT_SUB_ITERATIONS)
+        self.max_hypotheses = max_hypotheses
+        self.jobs = jobs
+        self.sub_iterations = sub_iterations
+        self.agent_factory = agent_factory
+        self._memo: Dict[str, Any] = {}
+        self._memo_lock = threading.Lock()
+
+    def hypotheses(self) -> Dict[str, List[str]]:
+        """Capability -> seed APIs, at most `max_hypotheses` in the pruner's capability order."""
+
+        try:
+            buckets = import_capability_buckets(self.snapshot.root)
+        except Exception as exc:  # unreadable imports: fall back to a single agent
+            logger.warning("Could not bucket imports for hypotheses: %s", exc)
+            return {}
+        return dict(list(buckets.items())[: max(0, self.max_hypotheses)])
+
+    def _agent(self, **kwargs: Any) -> ReverseEngineeringAgent:
+        snapshot = self.snapshot.fork()
+        tool_map = shared_tool_map(build_tool_map(snapshot), self._memo, self._memo_lock)
+        return self.agent_factory(self.llm, TOOLS, tool_map, warmers=build_prefetch_warmers(snapshot), **kwargs)
+
+    def _investigate(self, question: str, capability: str, apis: List[str], verbose: bool) -> HypothesisReport:
+        shown = ", ".join(apis[:APIS_PER_HYPOTHESIS]) + (", ..." if len(apis) > APIS_PER_HYPOTHESIS else "")
+        prompt = HYPOTHESIS_PROMPT.format(question=question, capability=capability, apis=shown)
+        answer = self._agent(max_iterations=self.sub_iterations).run(prompt, verbose=verbose)
+        if verbose:
+            logger.info("Hypothesis %s finished", capability)
+        return HypothesisReport(capability, apis, answer)
+
+    def _merge(self, question: str, reports: List[HypothesisReport], verbose: bool) -> str:
+        sections = [f"### {report.capability}\n{report.answer.strip()}" for report in reports]
+        try:
+            response = self.llm.chat(
+                verbose=verbose,
+                messages=[
+                    {"role": "system", "content": HYPOTHESIS_MERGE_SYSTEM_PROMPT},
+                    {"role": "user", "content": f"Question: {question}\n\n" + "\n\n".join(sections)},
+                ],
+                temperature=0.1,
+                phase="synthesis",
+            )
+            content = response.choices[0].message.content
+            if content:
+                return content
+        except Exception as exc:
+            logger.error("Merging hypothesis reports failed: %s", exc)
+        return "\n\n".join(sections)
+
+    def run(self, question: str, verbose: bool = False) -> str:
+        seeds = self.hypotheses()
+        if not seeds:
+            if verbose:
+                logger.info("No capability buckets detected; answering with a single agent")
+            return self._agent().run(question, verbose=verbose)
+
+        if verbose:
+            logger.info("Investigating %d hypotheses: %s", len(seeds), ", ".join(seeds))
+        with ThreadPoolExecutor(max_workers=max(1, self.jobs), thread_name_prefix="hypothesis") as executor:
+            futures = [
+                executor.submit(self._investigate, question, capability, apis, verbose)
+                for capability, apis in seeds.items()
+            ]
+            reports = [future.result() for future in futures]
+        return self._merge(question, reports, verbose)
+
+
+__all__ = ["HypothesisCoordinator", "HypothesisReport", "UNSHARED_TOOLS", "shared_tool_map"]
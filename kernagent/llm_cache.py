@@ -0,0 +1,221 @@
+"""On-disk cache for deterministic (temperature=0) LLM completions."""
+
+from __future__ import annotations
+
+import hashlib
+import json
+import os
+import time
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Tuple
+
+from .log import get_logger
+
+logger = get_logger(__name__)
+
+DEFAULT_TTL_SECONDS = 30 * 24 * 3600
+DEFAULT_MAX_BYTES = 256 * 1024 * 1024
+CACHE_ENTRY_VERSION = 1
+
+
+def _sha256(text: str) -> str:
+    return hashlib.sha256(text.encode("utf-8")).hexdigest()
+
+
+def _env_number(name: str, default: float) -> float:
+    value = os.getenv(name, "").strip()
+    if not value:
+        return default
+    try:
+        return float(value)
+    except ValueError:
+        logger.warning("Ignoring invalid %s=%s", name, value)
+        return default
+
+
+def default_cache_dir() -> Path:
+    env_value = os.getenv("KERNAGENT_LLM_CACHE_DIR")
+    if env_value:
+        return Path(env_value).expanduser()
+    cache_home = Path(os.environ.get("XDG_CACHE_HOME", Path.home() / ".cache"))
+    return cache_home / "kernagent" / "llm"
+
+
+class ResponseCache:
+    """
+    Completion cache keyed by model, base URL, system prompt hash and payload hash.
+
+    Entries older than `ttl_seconds` are ignored and removed; when the cache
+    directory grows past `max_bytes`, the least recently used entries are
+    evicted. The directory is scanned once per instance and then only when a
+    running total of the bytes written crosses `max_bytes`.
+    """
+
+    def __init__(
+        self,
+        root: Optional[Path] = None,
+        ttl_seconds: float = DEFAULT_TTL_SECONDS,
+        max_bytes: int = DEFAULT_MAX_BYTES,
+    ):
+        self.root = Path(root) if root else default_cache_dir()
+        self.ttl_seconds = ttl_seconds
+        self.max_bytes = max_bytes
+        self._size: Optional[int] = None
+
+    @classmethod
+    def from_env(cls) -> Optional["ResponseCache"]:
+        """Cache configured from KERNAGENT_LLM_CACHE_* (None if disabled)."""
+
+        if os.getenv("KERNAGENT_LLM_CACHE_DISABLE", "").lower() in {"1", "true", "yes", "on"}:
+            return None
+        return cls(
+            ttl_seconds=_env_number("KERNAGENT_LLM_CACHE_TTL", DEFAULT_TTL_SECONDS),
+            max_bytes=int(_env_number("KERNAGENT_LLM_CACHE_MAX_MB", DEFAULT_MAX_BYTES / 2**20) * 2**20),
+        )
+
+    @staticmethod
+    def make_key(model: str, base_url: str, messages: List[Dict[str, Any]], **params: Any) -> str:
+        system = "".join(m.get("content") or "" for m in messages if m.get("role") == "system")
+        payload = json.dumps(
+            [m for m in messages if m.get("role") != "system"], sort_keys=True, ensure_ascii=False
+        )
+        material = {
+            "model": model,
+            "base_url": base_url.rstrip("/"),
+            "system_sha256": _sha256(system),
+            "payload_sha256": _sha256(payload),
+            "params": params,
+        }
+        return _sha256(json.dumps(material, sort_keys=True))
+
+    def _path(self, key: str) -> Path:
+        return self.root / key[:2] / f"{key}.json"
+
+    def get(self, key: str) -> Optional[str]:
+        path = self._path(key)
+        try:
+            with path.open("r", encoding="utf-8") as f:
+                entry = json.load(f)
+        except FileNotFoundError:
+            return None
+        except (OSError, ValueError) as exc:
+            logger.warning("Ignoring unreadable LLM cache entry %s: %s", path, exc)
+            return None
+
+        if entry.get("version") != CACHE_ENTRY_VERSION:
+            return None
+        if self.ttl_seconds > 0 and time.time() - entry.get("created", 0) > self.ttl_seconds:
+            path.unlink(missing_ok=True)
+            return None
+
+        os.utime(path)  # mark as recently used for eviction
+        return entry.get("content")
+
+    def put(self, key: str, content: str, model: str) -> None:
+        path = self._path(key)
+        entry = {"version": CACHE_ENTRY_VERSION, "created": time.time(), "model": model, "content": content}
+        try:
+            path.parent.mkdir(parents=True, exist_ok=True)
+            try:
+                replaced = path.stat().st_size
+            except FileNotFoundError:
+                replaced = 0
+            tmp_path = path.with_suffix(f".{os.getpid()}.tmp")
+            with tmp_path.open("w", encoding="utf-8") as f:
+                json.dump(entry, f)
+            written = tmp_path.stat().st_size
+            os.replace(tmp_path, path)
+        except OSError as exc:
+            logger.warning("Could not write LLM cache entry %s: %s", path, exc)
+            return
+        if self.max_bytes <= 0:
+            return
+        if self._size is None:
+            self._size = self._evict()
+            return
+        # Other processes and expired-entry removal make this an estimate; the
+        # scan in _evict resets it to the real size.
+        self._size += written - replaced
+        if self._size > self.max_bytes:
+            self._size = self._evict()
+
+    def _evict(self) -> int:
+        """Drop least recently used entries past `max_bytes`; returns the bytes left."""
+
+        entries = []
+        total = 0
+        entries = []
+        total = 0
+        for path in self.root.glob("*/*.json"):
+            try:
+                stat = path.stat()
+            except OSError:
+                continue
+            entries.append((stat.st_mtime, stat.st_size, path))
+            total += stat.st_size
+
+        for _mtime, size, path in sorted(entries):
+            if self.max_bytes <= 0 or total <= self.max_bytes:
+                break
+            path.unlink(missing_ok=True)
+            total -= size
+        return total
+
+
+def cached_chat_content(
+    llm,
+    settings,
+    messages: List[Dict[str, Any]],
+    cache: Optional[ResponseCache] = None,
+    verbose: bool = False,
+    **kwargs: Any,
+) -> str:
+    """
+    Return the completion text for `messages`, served from `cache` when possible.
+
+    Only temperature=0 requests are cached; anything else goes straight to the LLM.
+    A `phase` routes the request (see Settings.routes); if that model fails or
+    answers empty, the request is retried on the phase it escalates to. Each
+    answer is cached under the model that produced it.
+    """
+
+    phase = kwargs.pop("phase", None)
+    cacheable = cache is not None and kwargs.get("temperature") == 0
+
+    def lookup(route_phase: Optional[str]) -> Tuple[Optional[str], Optional[str], str]:
+        route = settings.route(route_phase)
+        model = kwargs.get("model") or route.model
+        if not cacheable:
+            return None, None, model
+        key = cache.make_key(model, route.base_url, messages, **kwargs)
+        content = cache.get(key)
+        if content is not None:
+            logger.info("Using cached LLM response (%s)", key[:12])
+        return content, key, model
+
+    content, key, model = lookup(phase)
+    if content is not None:
+        return content
+
+    escalate = getattr(llm, "escalation", None)
+    fallback = escalate(phase) if escalate and phase else None
+    try:
+        response = llm.chat(verbose=verbose, messages=messages, phase=phase, **kwargs)
+        content = response.choices[0].message.content or ""
+    except Exception as exc:
+        if not fallback:
+            raise
+        logger.warning("%s model failed (%s); escalating to %s", phase, exc, fallback)
+        content = ""
+    if not content and fallback:
+        content, key, model = lookup(fallback)
+        if content is not None:
+            return content
+        response = llm.chat(verbose=verbose, messages=messages, phase=fallback, **kwargs)
+        content = response.choices[0].message.content or ""
+    if cacheable and content:
+        cache.put(key, content, model)
+    return content
+
+
+__all__ = ["ResponseCache", "cached_chat_content", "default_cache_dir"]
@@ -7,14 +7,20 @@ try:
 except ImportError:  # pragma: no cover - handled lazily
     OpenAI = None  # type: ignore[assignment]
 
-from .config import Settings
+from typing import Dict, Optional, Tuple
+
+from .config import ESCALATION, ModelRoute, Settings
 from .log import get_logger
 
 logger = get_logger(__name__)
 
 
 class LLMClient:
-    """Thin convenience wrapper around the OpenAI SDK."""
+    """Thin convenience wrapper around the OpenAI SDK.
+
+    Requests may name a phase ("explore", "synthesis", "oneshot"); each phase
+    uses the model and endpoint configured for it in ``Settings.routes``.
+    """
 
     def __init__(self, settings: Settings):
         if OpenAI is None:  # pragma: no cover - depends on local tooling setup
@@ -23,24 +29,40 @@ class LLMClient:
                 "Install it with `pip install openai`."
             )
         self.settings = settings
-        self.client = OpenAI(
-            api_key=settings.api_key,
-            base_url=settings.base_url,
-        )
+        self._clients: Dict[Tuple[str, str], OpenAI] = {}
+        self.client = self._client_for(settings.route())
+
+    def _client_for(self, route: ModelRoute):
+        key = (route.base_url, route.api_key)
+        client = self._clients.get(key)
+        if client is None:
+            client = OpenAI(api_key=route.api_key, base_url=route.base_url)
+            self._clients[key] = client
+        return client
+
+    def escalation(self, phase: Optional[str]) -> Optional[str]:
+        """Phase to retry with when `phase` fails, if it is routed to a different model."""
+
+        target = ESCALATION.get(phase or "")
+        if target and self.settings.route(target) != self.settings.route(phase):
+            return target
+        return None
 
-    def chat(self, verbose: bool = False, **kwargs):
+    def chat(self, verbose: bool = False, phase: Optional[str] = None, **kwargs):
         """Call the chat completions API.
 
         Args:
             verbose: If True, log API call details.
+            phase: Route the request to the model configured for this phase.
             **kwargs: Arguments passed to the OpenAI chat completions API.
         """
-        kwargs.setdefault("model", self.settings.model)
+        route = self.settings.route(phase)
+        kwargs.setdefault("model", route.model)
 
         if verbose:
-            logger.info("Calling LLM API with model: %s", kwargs["model"])
+            logger.info("Calling LLM API with model: %s%s", kwargs["model"], f" ({phase})" if phase else "")
 
-        response = self.client.chat.completions.create(**kwargs)
+        response = self._client_for(route).chat.completions.create(**kwargs)
 
         if verbose and hasattr(response, "usage") and response.usage:
             logger.info(
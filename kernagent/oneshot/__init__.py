@@ -1,5 +1,6 @@
 """Oneshot pruning utilities."""
 
-from .pruner import OneshotPruningError, build_oneshot_summary
+from .pruner import OneshotPruningError, build_oneshot_summary, import_capability_buckets
+from .sections import run_sectioned_oneshot
 
-__all__ = ["build_oneshot_summary", "OneshotPruningError"]
+__all__ = ["build_oneshot_summary", "import_capability_buckets", "run_sectioned_oneshot", "OneshotPruningError"]
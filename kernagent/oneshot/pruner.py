@@ -7,13 +7,16 @@ and emits a compact, capability-focused JSON payload ready for the LLM.
 
 from __future__ import annotations
 
-import json
 import re
 from collections import Counter, defaultdict
 from pathlib import Path
 from typing import Any, Dict, Iterable, List, Mapping, Optional, Sequence, Tuple
 
 from ..log import get_logger
+from ..snapshot import codec
+from ..snapshot.edges import EdgeTable, load_edge_table
+from ..snapshot.records import FunctionRecord, StringRecord
+from ..snapshot.shards import iter_records, load_manifest, map_records, record_paths
 
 logger = get_logger(__name__)
 
@@ -161,25 +164,14 @@ def _read_json(path: Path) -> Any:
     if not path.exists():
         raise OneshotPruningError(f"Required artifact missing: {path}")
     with path.open("r", encoding="utf-8") as fh:
-        return json.load(fh)
+        return codec.load(fh)
 
 
 def _read_optional_json(path: Path) -> Any | None:
     if not path.exists():
         return None
     with path.open("r", encoding="utf-8") as fh:
-        return json.load(fh)
-
-
-def _iter_jsonl(path: Path) -> Iterable[Dict[str, Any]]:
-    if not path.exists():
-        return
-    with path.open("r", encoding="utf-8") as fh:
-        for line in fh:
-            line = line.strip()
-            if not line:
-                continue
-            yield json.loads(line)
+        return codec.load(fh)
 
 
 def _normalize_hex(value: Optional[str]) -> Optional[str]:
@@ -254,8 +246,10 @@ def _summarize_capa_for_oneshot(capa_summary: Optional[Dict[str, Any]]) -> Optio
         )
 
     highlights = capa_summary.get("highlights") or {}
+    analysis = capa_summary.get("analysis") or {}
 
     return {
+        "partial": bool(analysis.get("partial")),
         "counts": capa_summary.get("counts"),
         "capa_version": capa_summary.get("capa_version"),
         "rules_source": capa_summary.get("rules_source"),
@@ -365,6 +359,14 @@ def _build_import_capabilities(imports_exports: Dict[str, Any]) -> Tuple[Dict[st
     return bucketed, api_cap_map
 
 
+def import_capability_buckets(archive_dir: Path) -> Dict[str, List[str]]:
+    """Non-empty capability -> matching imports/exports buckets, in CAPABILITY_ORDER."""
+
+    imports_exports = _read_optional_json(Path(archive_dir) / "imports_exports.json") or {}
+    bucketed, _ = _build_import_capabilities(imports_exports)
+    return {cap: bucketed[cap] for cap in CAPABILITY_ORDER if bucketed[cap]}
+
+
 def _classify_string(value: str) -> Optional[str]:
     if not value or len(value) < 4:
         return None
@@ -465,23 +467,25 @@ def _resolve_function_refs(
     return refs, eas
 
 
-def _build_callgraph_maps(callgraph_path: Path, name_by_ea: Dict[str, str]) -> Tuple[Dict[str, Dict[str, str]], Dict[str, Dict[str, str]]]:
+def _build_callgraph_maps(edges: EdgeTable, functions: List[FunctionRecord], name_by_ea: Dict[str, str]) -> Tuple[Dict[str, Dict[str, str]], Dict[str, Dict[str, str]]]:
+    """Internal callers/callees per function; callers fall back to any referencing function."""
+
     callers: Dict[str, Dict[str, str]] = defaultdict(dict)
     callees: Dict[str, Dict[str, str]] = defaultdict(dict)
-    if not callgraph_path.exists():
-        return callers, callees
-
-    for entry in _iter_jsonl(callgraph_path):
-        src = entry.get("from")
-        dst = entry.get("to")
-        if not src or not dst:
-            continue
+    for edge in edges.call_edges():
+        src = edge.from_ea
+        dst = edge.to_ea
         if src.startswith("EXTERNAL") or dst.startswith("EXTERNAL"):
             continue
-        src_name = entry.get("from_name") or name_by_ea.get(src) or src
-        dst_name = entry.get("to_name") or name_by_ea.get(dst) or dst
-        callees[src][dst] = dst_name
-        callers[dst][src] = src_name
+        callees[src][dst] = edge.to_name or name_by_ea.get(dst) or dst
+        callers[dst][src] = edge.from_name or name_by_ea.get(src) or src
+
+    for function in functions:
+        if function.ea in callers:
+            continue
+        for caller_ea in edges.callers(function.ea):
+            if not caller_ea.startswith("EXTERNAL"):
+                callers[function.ea][caller_ea] = name_by_ea.get(caller_ea, caller_ea)
     return callers, callees
 
 
@@ -508,21 +512,27 @@ def _find_section_name(addr: Optional[int], sections: List[Dict[str, Any]]) -> O
 
 
 def _score_function(
-    record: Dict[str, Any],
+    record: FunctionRecord | Dict[str, Any],
     entrypoint_names: set,
     exported_names: set,
     suspicious_section_names: set,
     func_capabilities: Dict[str, set],
     func_has_strings: set,
+    fan_in: Optional[int] = None,
+    fan_out: Optional[int] = None,
 ) -> int:
+    """Heuristic interest score; fan-in/out default to the record's xrefs lists."""
+
     score = 0
     name_lower = (record["name"] or "").lower()
     ea = record["ea"]
     metrics = record.get("metrics") or {}
     complexity = metrics.get("cyclomatic_complexity") or 0
     size = metrics.get("size_bytes") or 0
-    fan_out = len(record.get("xrefs_out") or [])
-    fan_in = len(record.get("xrefs_in") or [])
+    if fan_out is None:
+        fan_out = len(record.get("xrefs_out") or [])
+    if fan_in is None:
+        fan_in = len(record.get("xrefs_in") or [])
     section_name = record.get("section_name")
 
     if name_lower in entrypoint_names or record["name"] in exported_names:
@@ -614,33 +624,26 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
     imports_exports = _read_json(archive_dir / "imports_exports.json")
     index_data = _read_json(archive_dir / "index.json")
 
-    functions_path = archive_dir / "functions.jsonl"
-    strings_path = archive_dir / "strings.jsonl"
-    callgraph_path = archive_dir / "callgraph.jsonl"
-    data_path = archive_dir / "data.jsonl"
+    shard_manifest = load_manifest(archive_dir)
+    function_paths = record_paths(archive_dir, "functions", shard_manifest)
+    string_paths = record_paths(archive_dir, "strings", shard_manifest)
+    data_paths = record_paths(archive_dir, "data", shard_manifest)
 
-    if not functions_path.exists():
-        raise OneshotPruningError(f"Required artifact missing: {functions_path}")
-    if not strings_path.exists():
-        raise OneshotPruningError(f"Required artifact missing: {strings_path}")
+    if not function_paths:
+        raise OneshotPruningError(f"Required artifact missing: {archive_dir / 'functions.jsonl'}")
+    if not string_paths:
+        raise OneshotPruningError(f"Required artifact missing: {archive_dir / 'strings.jsonl'}")
 
-    # Build minimal function records
-    functions: List[Dict[str, Any]] = []
+    # Build minimal function records (only the fields the pruner scores on are decoded)
     name_by_ea: Dict[str, str] = {}
     ea_by_name: Dict[str, str] = {k: v for k, v in (index_data.get("by_name") or {}).items()}
 
-    for entry in _iter_jsonl(functions_path):
-        record = {
-            "ea": entry.get("ea"),
-            "name": entry.get("name") or entry.get("ea"),
-            "metrics": entry.get("metrics") or {},
-            "xrefs_in": entry.get("xrefs_in") or [],
-            "xrefs_out": entry.get("xrefs_out") or [],
-            "ranges": entry.get("ranges") or [],
-        }
-        functions.append(record)
-        if record["ea"]:
-            name_by_ea[record["ea"]] = record["name"]
+    functions: List[FunctionRecord] = map_records(
+        function_paths, FunctionRecord.from_dict, fields=FunctionRecord.SOURCE_FIELDS
+    )
+    for record in functions:
+        if record.ea:
+            name_by_ea[record.ea] = record.name
 
     if not functions:
         raise OneshotPruningError("functions.jsonl is empty – cannot build summary.")
@@ -664,11 +667,9 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
     suspicious_section_names = {sec["name"].lower() for sec in suspicious_sections if sec.get("name")}
 
     for function in functions:
-        ranges = function.get("ranges") or []
-        first_range = ranges[0] if ranges else None
+        first_range = function.ranges[0] if function.ranges else None
         start_addr = _parse_address(first_range[0]) if first_range else None
-        section_name = _find_section_name(start_addr, sections)
-        function["section_name"] = section_name
+        function.section_name = _find_section_name(start_addr, sections)
 
     # Imports → capabilities
     imports_by_capability, api_capabilities = _build_import_capabilities(imports_exports)
@@ -684,11 +685,11 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
     function_strings: Dict[str, List[Tuple[str, str]]] = defaultdict(list)
     func_has_strings: set = set()
 
-    for entry in _iter_jsonl(strings_path):
-        value = entry.get("value")
+    for entry in map(StringRecord.from_dict, iter_records(string_paths)):
+        value = entry.value
         if not value:
             continue
-        refs, ref_eas = _resolve_function_refs(entry.get("xrefs"), name_by_ea, ea_by_name)
+        refs, ref_eas = _resolve_function_refs(entry.xrefs, name_by_ea, ea_by_name)
         kind = _classify_string(value)
         if kind:
             # Always count string kinds for suspicion signals, regardless of MAX_STRINGS limit
@@ -699,7 +700,7 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
                 interesting_strings.append(
                     {
                         "value": value,
-                        "ea": entry.get("ea"),
+                        "ea": entry.ea,
                         "used_in": used_in_names,
                         "kind": kind,
                     }
@@ -717,7 +718,8 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
             logger.info("String breakdown: %s", kind_breakdown)
 
     # Callgraph
-    callers_map, callees_map = _build_callgraph_maps(callgraph_path, name_by_ea)
+    edges = load_edge_table(archive_dir, shard_manifest)
+    callers_map, callees_map = _build_callgraph_maps(edges, functions, name_by_ea)
 
     entrypoint_candidates = {
         name.lower()
@@ -747,8 +749,8 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
     function_capabilities: Dict[str, set] = defaultdict(set)
 
     for function in functions:
-        ea = function["ea"]
-        for xref in function.get("xrefs_out", []):
+        ea = function.ea
+        for xref in edges.callees(ea):
             name = xref.get("name")
             if not name:
                 continue
@@ -772,30 +774,32 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
             suspicious_section_names,
             function_capabilities,
             func_has_strings,
+            fan_in=len(edges.callers(function.ea)),
+            fan_out=edges.call_sites(function.ea),
         )
-        function["score"] = score
+        function.score = score
         scored_functions.append(function)
 
-    scored_functions.sort(key=lambda item: item["score"], reverse=True)
+    scored_functions.sort(key=lambda item: item.score, reverse=True)
 
-    selected: List[Dict[str, Any]] = []
+    selected: List[FunctionRecord] = []
     seen_eas: set = set()
 
     # Always include explicit entrypoints
     for function in scored_functions:
-        name_lower = (function["name"] or "").lower()
-        if name_lower in entrypoint_names and function["ea"] not in seen_eas:
+        name_lower = (function.name or "").lower()
+        if name_lower in entrypoint_names and function.ea not in seen_eas:
             selected.append(function)
-            seen_eas.add(function["ea"])
+            seen_eas.add(function.ea)
             if len(selected) >= MAX_KEY_FUNCTIONS:
                 break
 
     if len(selected) < MAX_KEY_FUNCTIONS:
         for function in scored_functions:
-            if function["ea"] in seen_eas:
+            if function.ea in seen_eas:
                 continue
             selected.append(function)
-            seen_eas.add(function["ea"])
+            seen_eas.add(function.ea)
             if len(selected) >= MAX_KEY_FUNCTIONS:
                 break
 
@@ -804,26 +808,11 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
 
     key_functions_output: List[Dict[str, Any]] = []
     for function in selected:
-        ea = function["ea"]
-        metrics = function.get("metrics") or {}
+        ea = function.ea
+        metrics = function.metrics
         caps = sorted(function_capabilities.get(ea, []), key=lambda c: CAPABILITY_ORDER.index(c) if c in CAPABILITY_ORDER else len(CAPABILITY_ORDER))
-        callers = callers_map.get(ea)
-        callees = callees_map.get(ea)
-
-        if not callers:
-            fallback_callers = {}
-            for caller_ea in function.get("xrefs_in", []):
-                if isinstance(caller_ea, str) and not caller_ea.startswith("EXTERNAL"):
-                    fallback_callers[caller_ea] = name_by_ea.get(caller_ea, caller_ea)
-            callers = fallback_callers
-
-        if not callees:
-            fallback_callees = {}
-            for callee in function.get("xrefs_out", []):
-                callee_ea = callee.get("ea")
-                if callee_ea and not callee_ea.startswith("EXTERNAL"):
-                    fallback_callees[callee_ea] = callee.get("name") or name_by_ea.get(callee_ea, callee_ea)
-            callees = fallback_callees
+        callers = callers_map.get(ea) or {}
+        callees = callees_map.get(ea) or {}
 
         strings_for_func = [
             value for value, _kind in function_strings.get(ea, [])
@@ -832,7 +821,7 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
         key_functions_output.append(
             {
                 "ea": ea,
-                "name": function["name"],
+                "name": function.name,
                 "size_bytes": metrics.get("size_bytes"),
                 "cyclomatic_complexity": metrics.get("cyclomatic_complexity"),
                 "capabilities": caps,
@@ -844,8 +833,8 @@ def build_oneshot_summary(archive_dir: Path, verbose: bool = False) -> Dict[str,
 
     # Possible configs (best-effort)
     possible_configs: List[Dict[str, Any]] = []
-    if data_path.exists():
-        for entry in _iter_jsonl(data_path):
+    if data_paths:
+        for entry in iter_records(data_paths):
             length = entry.get("length") or 0
             value = entry.get("value")
             ea = entry.get("ea")
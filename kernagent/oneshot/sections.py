@@ -0,0 +1,135 @@
+"""Sectioned oneshot analysis: analyze summary sections concurrently, then merge.
+
+One completion over the whole pruned summary means the report takes as long as
+one long generation and the payload can exceed a small model's context. Here
+the summary is split into independent sections (capabilities/imports,
+strings/configs, key functions, capa), each analyzed by its own completion on
+a thread pool, and a short final call merges the section reports. Reports are
+always merged in ``SECTION_ORDER`` so the merge prompt, and therefore its
+cache key, does not depend on which section finished first.
+"""
+
+from __future__ import annotations
+
+import json
+import os
+from concurrent.futures import ThreadPoolExecutor
+from typing import Any, Dict, List, Optional, Tuple
+
+from ..llm_cache import ResponseCache, cached_chat_content
+from ..log import get_logger
+from ..prompts import ONESHOT_MERGE_SYSTEM_PROMPT, ONESHOT_SECTION_FOCUS, ONESHOT_SECTION_SYSTEM_PROMPT
+
+logger = get_logger(__name__)
+
+DEFAULT_JOBS = 4
+
+# Section name -> summary keys it carries, in merge order.
+SECTION_ORDER: Tuple[Tuple[str, Tuple[str, ...]], ...] = (
+    ("capabilities", ("imports", "sections", "suspicion_signals")),
+    ("strings", ("interesting_strings", "possible_configs")),
+    ("functions", ("key_functions",)),
+    ("capa", ("capa",)),
+)
+
+# Given to every section and to the merge so each call knows what it is looking at.
+SHARED_KEYS = ("file",)
+
+
+def _empty(value: Any) -> bool:
+    if isinstance(value, dict):
+        return not any(not _empty(item) for item in value.values())
+    return value in (None, [], "", 0, False)
+
+
+def split_summary(summary: Dict[str, Any]) -> List[Tuple[str, Dict[str, Any]]]:
+    """(section, payload) pairs in merge order; sections with nothing to analyze are skipped."""
+
+    shared = {key: summary[key] for key in SHARED_KEYS if key in summary}
+    sections = []
+    for name, keys in SECTION_ORDER:
+        body = {key: summary[key] for key in keys if key in summary}
+        if all(_empty(value) for value in body.values()):
+            continue
+        sections.append((name, {**shared, **body}))
+    return sections
+
+
+def jobs_from_env() -> int:
+    value = os.getenv("KERNAGENT_ONESHOT_JOBS", "").strip()
+    try:
+        return max(1, int(value)) if value else DEFAULT_JOBS
+    except ValueError:
+        logger.warning("Ignoring invalid KERNAGENT_ONESHOT_JOBS=%s", value)
+        return DEFAULT_JOBS
+
+
+def merge_payload(summary: Dict[str, Any], reports: List[Tuple[str, str]]) -> str:
+    """The merge call's user message: shared metadata and signals, then reports in order."""
+
+    header = {key: summary[key] for key in SHARED_KEYS + ("suspicion_signals",) if key in summary}
+    parts = [json.dumps(header, indent=2)]
+    parts.extend(f"### {name}\n{report.strip()}" for name, report in reports)
+    return "\n\n".join(parts)
+
+
+def run_sectioned_oneshot(
+    llm: Any,
+    settings: Any,
+    summary: Dict[str, Any],
+    cache: Optional[ResponseCache] = None,
+    jobs: Optional[int] = None,
+    verbose: bool = False,
+) -> str:
+    """Analyze each section of `summary` concurrently and merge the reports into one report."""
+
+    sections = split_summary(summary)
+    jobs = jobs_from_env() if jobs is None else max(1, jobs)
+
+    def analyze(name: str, payload: Dict[str, Any]) -> str:
+        system = ONESHOT_SECTION_SYSTEM_PROMPT.format(section=name, focus=ONESHOT_SECTION_FOCUS[name])
+        try:
+            content = cached_chat_content(
+                llm,
+                settings,
+                [
+                    {"role": "system", "content": system},
+                    {"role": "user", "content": json.dumps(payload, indent=2)},
+                ],
+                cache=cache,
+                verbose=verbose,
+                temperature=0,
+                phase="oneshot",
+            )
+        except Exception as exc:
+            logger.error("Oneshot section %s failed: %s", name, exc)
+            return f"(section analysis failed: {exc})"
+        if verbose:
+            logger.info("Oneshot section %s analyzed", name)
+        return content or "(no findings)"
+
+    with ThreadPoolExecutor(max_workers=jobs, thread_name_prefix="oneshot") as executor:
+        futures = [(name, executor.submit(analyze, name, payload)) for name, payload in sections]
+        reports = [(name, future.result()) for name, future in futures]
+
+    try:
+        content = cached_chat_content(
+            llm,
+            settings,
+            [
+                {"role": "system", "content": ONESHOT_MERGE_SYSTEM_PROMPT},
+                {"role": "user", "content": merge_payload(summary, reports)},
+            ],
+            cache=cache,
+            verbose=verbose,
+            temperature=0,
+            phase="oneshot",
+        )
+        if content:
+            return content
+    except Exception as exc:
+        logger.error("Merging oneshot sections failed: %s", exc)
+    return "\n\n".join(f"### {name}\n{report.strip()}" for name, report in reports)
+
+
+__all__ = ["SECTION_ORDER", "merge_payload", "run_sectioned_oneshot", "split_summary"]
@@ -0,0 +1,201 @@
+"""Speculative tool calls that overlap with model inference.
+
+After each agent iteration the results just returned predict what the model
+will likely ask for next: the decompilation and xrefs of the top hits of a
+search, the callers of a matched string. ``Prefetcher`` runs those calls on
+a small thread pool while the next completion is generated; when the model
+does request one, the agent takes the finished (or in-flight) result instead
+of calling the tool again.
+
+Only side-effect-free tools are prefetched for their results. Tools with
+side effects (``read_decompilation`` charges the session token budget) are
+given a *warmer* instead: a callable that fills the snapshot caches so the
+real call that follows is fast.
+"""
+
+from __future__ import annotations
+
+import inspect
+import json
+import os
+import threading
+from concurrent.futures import Future, ThreadPoolExecutor
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+from .deadline import GRACE_SECONDS, Deadline, deadline_scope, tool_timeout_from_env
+from .log import get_logger
+
+logger = get_logger(__name__)
+
+# Tools whose prefetched result can be handed to the model as is.
+PURE_TOOLS = frozenset({"get_function", "get_xrefs"})
+
+DEFAULT_WORKERS = 2
+DEFAULT_TOP = 3
+
+
+def _hits(result: Any) -> List[Dict[str, Any]]:
+    if not isinstance(result, dict) or "error" in result:
+        return []
+    return [hit for hit in result.get("results") or [] if isinstance(hit, dict)]
+
+
+def predict_calls(name: str, result: Any, top: int = DEFAULT_TOP) -> List[Tuple[str, Dict[str, Any]]]:
+    """Likely follow-up (tool, args) pairs for a tool `name` that returned `result`."""
+
+    calls: List[Tuple[str, Dict[str, Any]]] = []
+    if name in {"search_functions", "find_relevant"}:
+        for hit in _hits(result)[:top]:
+            if hit.get("decomp_path"):
+                calls.append(("read_decompilation", {"decomp_path": hit["decomp_path"]}))
+            if hit.get("name") or hit.get("ea"):
+                calls.append(("get_xrefs", {"target": hit.get("name") or hit["ea"]}))
+    elif name == "search_strings":
+        for hit in _hits(result)[:top]:
+            if hit.get("address"):
+                calls.append(("get_xrefs", {"target": hit["address"]}))
+            for ref in hit.get("xref_functions") or []:
+                function = ref.get("function")
+                if function and function != "unknown":
+                    calls.append(("get_function", {"identifier": function}))
+    elif name == "search_imports_exports":
+        for hit in _hits(result)[:top]:
+            if hit.get("name"):
+                calls.append(("get_xrefs", {"target": hit["name"], "direction": "to"}))
+    elif name == "get_function" and isinstance(result, dict) and result.get("decomp_path"):
+        calls.append(("read_decompilation", {"decomp_path": result["decomp_path"]}))
+    return list({_plain_key(call): call for call in calls}.values())
+
+
+def _plain_key(call: Tuple[str, Dict[str, Any]]) -> str:
+    return call[0] + json.dumps(call[1], sort_keys=True, default=str)
+
+
+class Prefetcher:
+    """Run predicted tool calls in the background and serve them on request."""
+
+    def __init__(
+        self,
+        tool_map: Dict[str, Callable[..., Any]],
+        warmers: Optional[Dict[str, Callable[..., Any]]] = None,
+        workers: int = DEFAULT_WORKERS,
+        top: int = DEFAULT_TOP,
+        timeout: Optional[float] = None,
+    ):
+        self.tool_map = tool_map
+        self.warmers = dict(warmers or {})
+        self.top = max(1, top)
+        # Speculative calls get the same per-call deadline as real ones (see deadline.py).
+        self.timeout = tool_timeout_from_env() if timeout is None else timeout
+        self._executor = ThreadPoolExecutor(max_workers=max(1, workers), thread_name_prefix="prefetch")
+        self._pending: Dict[str, Future] = {}
+        self._lock = threading.Lock()
+        self.stats = {"scheduled": 0, "hits": 0, "discarded": 0}
+
+    @classmethod
+    def from_env(
+        cls, tool_map: Dict[str, Callable[..., Any]], warmers: Optional[Dict[str, Callable[..., Any]]] = None
+    ) -> Optional["Prefetcher"]:
+        """Prefetcher configured by KERNAGENT_PREFETCH*, or None when disabled."""
+
+        if os.getenv("KERNAGENT_PREFETCH", "1").strip().lower() in {"0", "false", "no", "off"}:
+            return None
+
+        def read(name: str, default: int) -> int:
+            value = os.getenv(name, "").strip()
+            try:
+                return int(value) if value else default
+            except ValueError:
+                logger.warning("Ignoring invalid %s=%s", name, value)
+                return default
+
+        workers = read("KERNAGENT_PREFETCH_WORKERS", DEFAULT_WORKERS)
+        if workers <= 0:
+            return None
+        return cls(tool_map, warmers, workers=workers, top=read("KERNAGENT_PREFETCH_TOP", DEFAULT_TOP))
+
+    def _target(self, name: str) -> Optional[Callable[..., Any]]:
+        if name in self.warmers:
+            return self.warmers[name]
+        if name in PURE_TOOLS:
+            return self.tool_map.get(name)
+        return None
+
+    def _run(self, target: Callable[..., Any], args: Dict[str, Any]) -> Any:
+        with deadline_scope(Deadline(self.timeout)):
+            return target(**args)
+
+    def _key(self, name: str, args: Dict[str, Any]) -> Optional[str]:
+        """Identify a call by its bound arguments so omitted defaults still match."""
+
+        handler = self.tool_map.get(name)
+        if handler is None:
+            return None
+        try:
+            bound = inspect.signature(handler).bind(**args)
+            bound.apply_defaults()
+            arguments = dict(bound.arguments)
+        except (TypeError, ValueError):
+            return None
+        return name + json.dumps(arguments, sort_keys=True, default=str)
+
+    def schedule(self, name: str, args: Dict[str, Any], result: Any) -> int:
+        """Start prefetching the likely follow-ups of one tool result; returns how many."""
+
+        started = 0
+        for call_name, call_args in predict_calls(name, result, self.top):
+            target = self._target(call_name)
+            key = self._key(call_name, call_args)
+            if target is None or key is None:
+                continue
+            with self._lock:
+                if key in self._pending:
+                    continue
+                self._pending[key] = self._executor.submit(self._run, target, call_args)
+            self.stats["scheduled"] += 1
+            started += 1
+        return started
+
+    def take(self, name: str, args: Dict[str, Any]) -> Optional[Any]:
+        """Result of a matching prefetch, or None if the tool should be called normally.
+
+        Waits for an in-flight match, at most the tool deadline. Warmed tools
+        always return None once the warm-up has finished so the real handler
+        runs against the warm cache; so do prefetches cut short by the deadline.
+        """
+
+        key = self._key(name, args)
+        if key is None:
+            return None
+        with self._lock:
+            future = self._pending.pop(key, None)
+        if future is None or future.cancelled():
+            return None
+        try:
+            result = future.result(timeout=self.timeout + GRACE_SECONDS if self.timeout else None)
+        except Exception as exc:  # the real call reports the error
+            logger.debug("Prefetch of %s failed: %s", name, exc)
+            return None
+        if name in self.warmers or name not in PURE_TOOLS:
+            return None
+        if isinstance(result, dict) and result.get("timed_out"):
+            return None
+        self.stats["hits"] += 1
+        return result
+
+    def discard_pending(self) -> None:
+        """Drop predictions that have not started; the model chose something else."""
+
+        with self._lock:
+            stale = [key for key, future in self._pending.items() if future.cancel()]
+            for key in stale:
+                del self._pending[key]
+        self.stats["discarded"] += len(stale)
+
+    def close(self) -> None:
+        with self._lock:
+            self._pending.clear()
+        self._executor.shutdown(wait=False, cancel_futures=True)
+
+
+__all__ = ["PURE_TOOLS", "Prefetcher", "predict_calls"]
@@ -15,15 +15,18 @@ You have read-only access to structured analysis artifacts extracted from the bi
 ## ARTIFACTS (READ-ONLY)
 
 - meta.json: file metadata (hashes, arch, compiler, format, image base, ranges)
-- functions.jsonl: all functions (EA, name, prototype, metrics, xrefs, instructions, decomp_path)
+- functions.jsonl: all functions (EA, name, prototype, metrics, instructions, decomp_path); get_function adds xrefs_in/xrefs_out
 - decomp/*.c: decompiler output for many functions
 - strings.jsonl: strings with addresses and xrefs
-- imports_exports.json: imports and exports with library, name, signature
+- imports_exports.json: imports and exports (external entry points) with library, name, signature
+- symbols.jsonl: every global symbol (labels, functions); looked up by resolve_symbol via symbols_index.json
 - sections.json: segments/sections with ranges and permissions
 - equates.json: named constants (may be empty)
-- callgraph.jsonl: call edges (from/to, names, types)
+- edges.json: deduplicated references between functions (caller, callee, type, number of call sites); older snapshots also have callgraph.jsonl
 - index.json: lookup tables (name <-> address) used internally by tools
 - data.jsonl: globals / structured data (names, types, addresses, sizes)
+- token_index.json: per-function token estimates (decompilation, instruction listing)
+- shards.json (large binaries only): functions/strings/data split into address-range shards; the tools read them for you
 - capa_summary.json: filtered CAPA hits (rule names, namespaces, ATT&CK/MBC tags, representative locations)
 
 You CANNOT modify code, rename symbols, or debug. All tools are for analysis only.
@@ -54,13 +57,19 @@ Always ground conclusions in tool outputs:
 - search_strings(pattern=keywords)
 - search_by_instruction() when relevant (e.g., "syscall", "cpuid")
 
-**3. “Show/assess function F”**
+**3. “Where does it do X?”**
+- find_relevant(query="X keywords") to get a ranked shortlist of functions
+- get_function / read_decompilation on the top hits
+- read_decompilation_slice(function, anchor="API/string/variable") to read just the relevant part of a large function
+
+**4. “Show/assess function F”**
 - search_functions(name_pattern="F") or use known EA
 - get_function(identifier)
-- read_decompilation(decomp_path) if available
+- read_decompilation(decomp_path) if available; search_functions/get_function report the token
+  cost up front, and functions too large for the read limit come back as a folded outline
 - trace_calls(start="F", direction="down" or "up") for context
 
-**4. “Find suspicious/interesting code”**
+**5. “Find suspicious/interesting code”**
 - get_function_stats() to spot large/complex functions
 - search_functions(min_complexity=20) for logic-heavy areas
 - search_by_instruction("syscall"/"cpuid"/"rdtsc"/"xor") for low-level tricks
@@ -103,7 +112,7 @@ The summary fields you may see include:
 - key_functions: a limited set of functions (EA, name, size, complexity, capabilities, callers/callees, associated strings) selected as behaviorally important.
 - possible_configs: candidate embedded configuration or data blobs.
 - suspicion_signals: precomputed boolean hints (e.g. uses_network, has_persistence_indicators, has_anti_debug_vm_indicators, etc.).
-- capa: CAPA highlights (top ATT&CK techniques, namespaces, and rule hits) when available.
+- capa: CAPA highlights (top ATT&CK techniques, namespaces, and rule hits) when available. If capa.partial is true, capa only covered part of the binary, so missing capabilities are not evidence of absence.
 
 Your tasks:
 
@@ -273,6 +282,11 @@ TOOLS = [
                         "type": "integer",
                         "default": 50,
                         "description": "Maximum number of results."
+                    },
+                    "fields": {
+                        "type": "array",
+                        "items": {"type": "string"},
+                        "description": "Return only these record fields per result (e.g. ['prototype', 'xrefs_in']) instead of the default summary. ea and name are always included."
                     }
                 }
             }
@@ -292,6 +306,11 @@ TOOLS = [
                     "identifier": {
                         "type": "string",
                         "description": "Function name or EA (hex without 0x)."
+                    },
+                    "fields": {
+                        "type": "array",
+                        "items": {"type": "string"},
+                        "description": "Return only these fields (e.g. ['prototype', 'xrefs_in', 'decomp_path']); omit for the full record. Much cheaper than the full record."
                     }
                 },
                 "required": ["identifier"]
@@ -304,7 +323,11 @@ TOOLS = [
             "name": "read_decompilation",
             "description": (
                 "Read C-like pseudocode from a decompilation file for a function. "
-                "Use decomp_path obtained from get_function() or search_functions()."
+                "Use decomp_path obtained from get_function() or search_functions(). "
+                "Code is normalized by default: warnings and casts of a variable to its own declared type "
+                "removed (value-converting casts are kept), undefinedN types "
+                "shortened to uN/byte, and auto-named locals shortened (uVar1 -> u1, param_1 -> a1, "
+                "local_10 -> l_10)."
             ),
             "parameters": {
                 "type": "object",
@@ -312,6 +335,14 @@ TOOLS = [
                     "decomp_path": {
                         "type": "string",
                         "description": "e.g. 'decomp/140001000_FUN_140001000.c'."
+                    },
+                    "normalize": {
+                        "type": "boolean",
+                        "description": "Set false to get the raw Ghidra output."
+                    },
+                    "max_tokens": {
+                        "type": "integer",
+                        "description": "Return a folded outline if the code is larger than this."
                     }
                 },
                 "required": ["decomp_path"]
@@ -342,6 +373,11 @@ TOOLS = [
                         "type": "integer",
                         "default": 50,
                         "description": "Maximum number of results."
+                    },
+                    "fields": {
+                        "type": "array",
+                        "items": {"type": "string"},
+                        "description": "Return only these string record fields (ea, value, length, xrefs) instead of the default summary. ea is always included."
                     }
                 },
                 "required": ["pattern"]
@@ -386,7 +422,7 @@ TOOLS = [
         "function": {
             "name": "trace_calls",
             "description": (
-                "Trace call relationships from a starting function using callgraph.jsonl. "
+                "Trace call relationships from a starting function using the call graph. "
                 "direction='down' shows callees; 'up' shows callers. Returns a tree up to max_depth "
                 "and may truncate very large graphs."
             ),
@@ -537,6 +573,11 @@ TOOLS = [
                         "type": "integer",
                         "default": 0,
                         "description": "Skip this many matching results (pagination)."
+                    },
+                    "fields": {
+                        "type": "array",
+                        "items": {"type": "string"},
+                        "description": "Return only these data record fields (name, type, length, section, value, xrefs) instead of the default summary. ea is always included."
                     }
                 }
             }
@@ -568,7 +609,7 @@ TOOLS = [
             "name": "get_xrefs",
             "description": (
                 "Return cross-references to or from a target symbol or address. "
-                "Combines callgraph.jsonl, functions.jsonl, strings.jsonl, data.jsonl, and imports_exports.json when available."
+                "Combines edges.json, functions.jsonl, strings.jsonl, data.jsonl, and imports_exports.json when available."
             ),
             "parameters": {
                 "type": "object",
@@ -617,7 +658,7 @@ TOOLS = [
                 "properties": {
                     "pattern": {
                         "type": "string",
-                        "description": "Substring or simple regex-like pattern to search for."
+                        "description": "Substring or simple regex to search for (nested quantifiers such as (a+)+ are rejected)."
                     },
                     "case_sensitive": {
                         "type": "boolean",
@@ -643,6 +684,63 @@ TOOLS = [
                 "required": ["pattern"]
             }
         }
+    },
+    {
+        "type": "function",
+        "function": {
+            "name": "find_relevant",
+            "description": (
+                "Rank functions by relevance to a free-text query (BM25 over function names, "
+                "called imports, referenced strings and decompiled code). "
+                "Use first for open questions like 'where is the C2 config decrypted?' "
+                "instead of many exploratory searches."
+            ),
+            "parameters": {
+                "type": "object",
+                "properties": {
+                    "query": {
+                        "type": "string",
+                        "description": "Keywords or a short natural-language description."
+                    },
+                    "k": {
+                        "type": "integer",
+                        "default": 10,
+                        "description": "Number of functions to return (max 50)."
+                    }
+                },
+                "required": ["query"]
+            }
+        }
+    },
+    {
+        "type": "function",
+        "function": {
+            "name": "read_decompilation_slice",
+            "description": (
+                "Read only the part of a function's decompilation related to an anchor: lines that "
+                "mention it, lines they depend on or feed through local variables, and the enclosing "
+                "if/loop/switch headers; the rest is folded into '/* ... omitted; calls X */' outlines. "
+                "Prefer over read_decompilation for one API call, string or variable in a large function."
+            ),
+            "parameters": {
+                "type": "object",
+                "properties": {
+                    "function": {
+                        "type": "string",
+                        "description": "Function name, EA or decomp_path."
+                    },
+                    "anchor": {
+                        "type": "string",
+                        "description": "API/callee name, local variable, string/global address, or string text."
+                    },
+                    "normalize": {
+                        "type": "boolean",
+                        "description": "Set false to slice the raw Ghidra output."
+                    }
+                },
+                "required": ["function", "anchor"]
+            }
+        }
     }
 ]
 
@@ -701,3 +799,75 @@ Constraints:
 - Do not invent functions, APIs, or strings.
 - If evidence is weak or ambiguous, say so briefly in the relevant section.
 """
+
+# ============================================================================
+# HYPOTHESIS PROMPTS - Used by `ask --hypotheses` (see hypotheses.py)
+# ============================================================================
+
+HYPOTHESIS_PROMPT = """{question}
+
+Investigate ONLY the "{capability}" hypothesis. The binary imports or exports
+these matching APIs: {apis}.
+
+Use the tools to confirm or refute that this capability is actually used (who calls
+the APIs, with which arguments, reached from where). Stop as soon as you have evidence.
+Reply with:
+- Verdict: SUPPORTED | NOT SUPPORTED | INCONCLUSIVE
+- Evidence: bullets citing function names/EAs, APIs and strings
+Do not discuss other capabilities.
+"""
+
+HYPOTHESIS_MERGE_SYSTEM_PROMPT = """
+You are kernagent, an expert reverse-engineering copilot.
+
+Several analysts each investigated one capability hypothesis about the same binary
+using a static snapshot. You receive the user's question and their reports.
+
+Answer the question using ONLY evidence from the reports:
+- Lead with the direct answer.
+- Cover each SUPPORTED capability with its evidence (function names/EAs, APIs, strings).
+- Mention NOT SUPPORTED / INCONCLUSIVE hypotheses in one line at the end.
+- Do not invent functions, addresses, APIs or strings; keep conflicting claims visible.
+"""
+
+ONESHOT_SECTION_SYSTEM_PROMPT = """
+You are an expert malware analyst reviewing ONE section of a structured static summary
+of a binary (Ghidra artifacts only; no AV detections, reputation or runtime data).
+
+Section: {section}
+{focus}
+
+Report ONLY what this section shows, as concise Markdown bullets:
+- Findings: each observed behavior or capability with the exact supporting items
+  (function names with EA, APIs, strings, rule names).
+- Benign explanations: indicators that may be legitimate in context.
+- Verdict hint: MALICIOUS | GRAYWARE | BENIGN | UNKNOWN, for this section alone, with one line of why.
+
+Do not speculate about other sections. Do not invent APIs, strings, functions or addresses.
+"""
+
+ONESHOT_SECTION_FOCUS = {
+    "capabilities": "Imports grouped by capability bucket, suspicious sections/RWX indicators and precomputed suspicion signals.",
+    "strings": "High-signal strings (URLs, IPs, paths, registry keys, commands) with their referencing functions, and candidate embedded configs.",
+    "functions": "Behaviorally important functions: size, complexity, capabilities, callers/callees and the strings they use.",
+    "capa": "CAPA highlights: ATT&CK techniques, namespaces and rule hits. If partial is true, absent rules are not evidence of absence.",
+}
+
+ONESHOT_MERGE_SYSTEM_PROMPT = """
+You are an expert malware analyst.
+
+Several analysts each reviewed one section of the same static summary of a binary.
+You receive the file metadata, the precomputed suspicion signals and their section
+reports in a fixed order. Base your reasoning ONLY on them.
+
+Respond in structured Markdown with the following sections:
+- Summary: what the binary MOST LIKELY does, 3-8 bullets citing evidence.
+- Capabilities: each concrete capability with the exact supporting items.
+- Classification: EXACTLY one of MALICIOUS | GRAYWARE | BENIGN | UNKNOWN with a short
+  justification tied to specific evidence; say so explicitly when evidence is weak or
+  could be a false positive.
+- Evidence Map
+
+Do not invent APIs, strings, functions or addresses that the reports do not mention.
+Keep conflicting section verdicts visible rather than silently picking one.
+"""
@@ -0,0 +1,279 @@
+"""Record/replay stand-ins for the LLM client.
+
+A *cassette* is a JSONL file holding one recorded agent session: a header
+line with the question and model, then one line per chat completion with the
+response message and token usage. ``RecordingLLM`` wraps a live client and
+writes cassettes; ``ReplayLLM`` plays them back deterministically through the
+same ``chat()`` interface, so the agent loop can be measured without a model.
+``serve_replay`` exposes a cassette as an OpenAI-compatible HTTP endpoint for
+code that talks to the API directly.
+"""
+
+from __future__ import annotations
+
+import json
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+from types import SimpleNamespace
+from typing import Any, Dict, Iterable, List, Optional
+
+from .log import get_logger
+
+logger = get_logger(__name__)
+
+CASSETTE_VERSION = 1
+
+
+class ReplayExhaustedError(RuntimeError):
+    """The agent asked for more completions than the cassette holds."""
+
+
+def estimate_prompt_tokens(messages: Iterable[Dict[str, Any]], tools: Optional[Iterable[Any]] = None) -> int:
+    """Rough prompt-token count of a request (~4 characters per token)."""
+
+    payload = {"messages": list(messages), "tools": list(tools or [])}
+    return len(json.dumps(payload, separators=(",", ":"), default=str)) // 4
+
+
+def _first_user_message(messages: Iterable[Dict[str, Any]]) -> Optional[str]:
+    for message in messages:
+        if message.get("role") == "user":
+            return message.get("content")
+    return None
+
+
+def _tool_names(tools: Optional[Iterable[Dict[str, Any]]]) -> List[str]:
+    return [(tool.get("function") or {}).get("name") for tool in tools or []]
+
+
+def _serialize_message(message: Any) -> Dict[str, Any]:
+    return {
+        "content": message.content,
+        "tool_calls": [
+            {"id": call.id, "name": call.function.name, "arguments": call.function.arguments}
+            for call in message.tool_calls or []
+        ],
+    }
+
+
+def _serialize_usage(usage: Any) -> Optional[Dict[str, int]]:
+    if not usage:
+        return None
+    return {
+        "prompt_tokens": getattr(usage, "prompt_tokens", 0) or 0,
+        "completion_tokens": getattr(usage, "completion_tokens", 0) or 0,
+    }
+
+
+def _build_response(turn: Dict[str, Any], model: Optional[str]) -> SimpleNamespace:
+    """OpenAI-SDK-shaped response object for one recorded turn."""
+
+    recorded = turn["response"]
+    tool_calls = [
+        SimpleNamespace(
+            id=call["id"],
+            type="function",
+            function=SimpleNamespace(name=call["name"], arguments=call.get("arguments") or "{}"),
+        )
+        for call in recorded.get("tool_calls") or []
+    ]
+    message = SimpleNamespace(role="assistant", content=recorded.get("content"), tool_calls=tool_calls or None)
+    usage = turn.get("usage") or {}
+    return SimpleNamespace(
+        model=model,
+        choices=[SimpleNamespace(index=0, message=message, finish_reason="tool_calls" if tool_calls else "stop")],
+        usage=SimpleNamespace(
+            prompt_tokens=usage.get("prompt_tokens", 0),
+            completion_tokens=usage.get("completion_tokens", 0),
+            total_tokens=usage.get("prompt_tokens", 0) + usage.get("completion_tokens", 0),
+        ),
+    )
+
+
+def load_cassette(path: Path) -> Dict[str, Any]:
+    """Read a cassette into ``{"header": {...}, "turns": [...]}``."""
+
+    header: Dict[str, Any] = {}
+    turns: List[Dict[str, Any]] = []
+    with Path(path).open("r", encoding="utf-8") as f:
+        for line in f:
+            if not line.strip():
+                continue
+            entry = json.loads(line)
+            if entry.get("kind") == "session":
+                header = entry
+            elif entry.get("kind") == "turn":
+                turns.append(entry)
+    if header.get("version", CASSETTE_VERSION) != CASSETTE_VERSION:
+        raise ValueError(f"Unsupported cassette version in {path}: {header.get('version')}")
+    return {"header": header, "turns": turns}
+
+
+class RecordingLLM:
+    """Wrap a live client and append every completion to a cassette."""
+
+    def __init__(self, llm: Any, path: Path):
+        self.llm = llm
+        self.path = Path(path)
+        self._header_written = False
+        self.path.parent.mkdir(parents=True, exist_ok=True)
+        self.path.write_text("", encoding="utf-8")
+
+    def _append(self, entry: Dict[str, Any]) -> None:
+        with self.path.open("a", encoding="utf-8") as f:
+            f.write(json.dumps(entry, ensure_ascii=False) + "\n")
+
+    def chat(self, verbose: bool = False, **kwargs: Any) -> Any:
+        messages = kwargs.get("messages") or []
+        if not self._header_written:
+            settings = getattr(self.llm, "settings", None)
+            self._append(
+                {
+                    "kind": "session",
+                    "version": CASSETTE_VERSION,
+                    "question": _first_user_message(messages),
+                    "model": kwargs.get("model") or getattr(settings, "model", None),
+                    "recorded_at": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+                }
+            )
+            self._header_written = True
+
+        start = time.perf_counter()
+        response = self.llm.chat(verbose=verbose, **kwargs)
+        self._append(
+            {
+                "kind": "turn",
+                "request": {
+                    "message_count": len(messages),
+                    "tools": _tool_names(kwargs.get("tools")),
+                    "prompt_tokens_est": estimate_prompt_tokens(messages, kwargs.get("tools")),
+                },
+                "response": _serialize_message(response.choices[0].message),
+                "usage": _serialize_usage(getattr(response, "usage", None)),
+                "latency_s": round(time.perf_counter() - start, 4),
+            }
+        )
+        return response
+
+
+class ReplayLLM:
+    """Play a cassette back through the ``LLMClient.chat`` interface.
+
+    Responses come from the cassette in order regardless of the request, so a
+    replayed session exercises the same tool calls while the prompt sizes
+    reflect the current tool outputs. ``requests`` keeps per-call statistics.
+    """
+
+    def __init__(self, cassette: Path | Dict[str, Any]):
+        data = cassette if isinstance(cassette, dict) else load_cassette(cassette)
+        self.header: Dict[str, Any] = data["header"]
+        self.turns: List[Dict[str, Any]] = data["turns"]
+        self.position = 0
+        self.requests: List[Dict[str, Any]] = []
+        self._lock = threading.Lock()
+
+    @property
+    def question(self) -> Optional[str]:
+        return self.header.get("question")
+
+    @property
+    def exhausted(self) -> bool:
+        return self.position >= len(self.turns)
+
+    def chat(self, verbose: bool = False, **kwargs: Any) -> SimpleNamespace:
+        with self._lock:
+            if self.exhausted:
+                raise ReplayExhaustedError(
+                    f"Cassette has {len(self.turns)} turns; request {self.position + 1} has no recording"
+                )
+            turn = self.turns[self.position]
+            self.position += 1
+
+        messages = kwargs.get("messages") or []
+        expected_tools = {call["name"] for call in turn["response"].get("tool_calls") or []}
+        exposed = set(_tool_names(kwargs.get("tools")))
+        self.requests.append(
+            {
+                "message_count": len(messages),
+                "prompt_tokens_est": estimate_prompt_tokens(messages, kwargs.get("tools")),
+                "completion_tokens": (turn.get("usage") or {}).get("completion_tokens", 0),
+                "unexposed_tools": sorted(expected_tools - exposed) if exposed else [],
+            }
+        )
+        if verbose:
+            logger.info("Replaying turn %d/%d", self.position, len(self.turns))
+        return _build_response(turn, kwargs.get("model") or self.header.get("model"))
+
+
+def _response_to_openai_json(response: SimpleNamespace) -> Dict[str, Any]:
+    choice = response.choices[0]
+    message: Dict[str, Any] = {"role": "assistant", "content": choice.message.content}
+    if choice.message.tool_calls:
+        message["tool_calls"] = [
+            {
+                "id": call.id,
+                "type": "function",
+                "function": {"name": call.function.name, "arguments": call.function.arguments},
+            }
+            for call in choice.message.tool_calls
+        ]
+    return {
+        "id": "replay",
+        "object": "chat.completion",
+        "created": 0,
+        "model": response.model or "replay",
+        "choices": [{"index": 0, "message": message, "finish_reason": choice.finish_reason}],
+        "usage": vars(response.usage),
+    }
+
+
+def serve_replay(replay: ReplayLLM, host: str = "127.0.0.1", port: int = 0) -> ThreadingHTTPServer:
+    """Serve `replay` at ``http://host:port/v1/chat/completions`` on a background thread.
+
+    Call ``shutdown()`` on the returned server when done; ``server_address``
+    holds the bound port when `port` is 0.
+    """
+
+    class Handler(BaseHTTPRequestHandler):
+        def do_POST(self) -> None:  # noqa: N802 - http.server API
+            if not self.path.rstrip("/").endswith("/chat/completions"):
+                self._send(404, {"error": {"message": f"Unknown endpoint {self.path}"}})
+                return
+            length = int(self.headers.get("Content-Length") or 0)
+            try:
+                request = json.loads(self.rfile.read(length) or b"{}")
+                response = replay.chat(**request)
+            except ReplayExhaustedError as exc:
+                self._send(409, {"error": {"message": str(exc)}})
+                return
+            except ValueError as exc:
+                self._send(400, {"error": {"message": str(exc)}})
+                return
+            self._send(200, _response_to_openai_json(response))
+
+        def _send(self, status: int, body: Dict[str, Any]) -> None:
+            data = json.dumps(body).encode("utf-8")
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def log_message(self, format: str, *args: Any) -> None:  # noqa: A002 - http.server API
+            logger.debug("replay server: " + format, *args)
+
+    server = ThreadingHTTPServer((host, port), Handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+__all__ = [
+    "RecordingLLM",
+    "ReplayExhaustedError",
+    "ReplayLLM",
+    "estimate_prompt_tokens",
+    "load_cassette",
+    "serve_replay",
+]
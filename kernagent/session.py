@@ -0,0 +1,139 @@
+"""Multi-question ask sessions over one snapshot.
+
+``AskSession`` keeps a single ``SnapshotTools`` (and its indexes and caches)
+alive across questions and carries a compact digest of earlier answers into
+each new question, so follow-ups do not restart the investigation from zero.
+Independent questions can run concurrently; they share the snapshot caches
+but each gets its own token budget and sees only the findings recorded before
+its batch started.
+"""
+
+from __future__ import annotations
+
+import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Any, Callable, Iterable, List, Optional, TextIO
+
+from .agent import ReverseEngineeringAgent
+from .log import get_logger
+from .prompts import TOOLS
+from .snapshot import SnapshotTools, build_prefetch_warmers, build_tool_map
+from .snapshot.tokens import estimate_tokens
+
+logger = get_logger(__name__)
+
+DEFAULT_CONTEXT_TOKENS = 1500
+# Characters of each answer kept in the carried-over digest.
+ANSWER_EXCERPT_CHARS = 1200
+
+
+@dataclass
+class Finding:
+    question: str
+    answer: str
+
+
+def load_questions(source: TextIO) -> List[str]:
+    """One question per line; blank lines and `#` comments are skipped."""
+
+    questions = []
+    for line in source:
+        line = line.strip()
+        if line and not line.startswith("#"):
+            questions.append(line)
+    return questions
+
+
+def _excerpt(text: str, limit: int = ANSWER_EXCERPT_CHARS) -> str:
+    text = " ".join(text.split())
+    return text if len(text) <= limit else text[: limit - 3].rstrip() + "..."
+
+
+class AskSession:
+    """Answer a series of questions against one snapshot with shared state."""
+
+    def __init__(
+        self,
+        archive_dir: Path,
+        llm: Any,
+        context_tokens: Optional[int] = None,
+        agent_factory: Callable[..., ReverseEngineeringAgent] = ReverseEngineeringAgent,
+    ):
+        self.snapshot = SnapshotTools(archive_dir)
+        self.llm = llm
+        if context_tokens is None:
+            value = os.getenv("KERNAGENT_SESSION_CONTEXT_TOKENS", "").strip()
+            try:
+                context_tokens = int(value) if value else DEFAULT_CONTEXT_TOKENS
+            except ValueError:
+                logger.warning("Ignoring invalid KERNAGENT_SESSION_CONTEXT_TOKENS=%s", value)
+                context_tokens = DEFAULT_CONTEXT_TOKENS
+        self.context_tokens = max(0, context_tokens)
+        self.agent_factory = agent_factory
+        self.findings: List[Finding] = []
+        self._lock = threading.Lock()
+
+    def context(self) -> Optional[str]:
+        """Digest of earlier answers in order, keeping the newest that fit the context budget."""
+
+        if not self.context_tokens:
+            return None
+        with self._lock:
+            findings = list(self.findings)
+
+        entries: List[str] = []
+        used = 0
+        for finding in reversed(findings):
+            entry = f"Q: {_excerpt(finding.question, 300)}\nA: {_excerpt(finding.answer)}"
+            cost = estimate_tokens(entry)
+            if used + cost > self.context_tokens:
+                break
+            entries.append(entry)
+            used += cost
+        return "\n\n".join(reversed(entries)) or None
+
+    def reset(self) -> None:
+        """Forget earlier findings; snapshot caches are kept."""
+
+        with self._lock:
+            self.findings.clear()
+
+    def _answer(self, question: str, context: Optional[str], verbose: bool) -> str:
+        # Each question gets a fresh token budget over the shared caches.
+        snapshot = self.snapshot.fork()
+        agent = self.agent_factory(
+            self.llm, TOOLS, build_tool_map(snapshot), warmers=build_prefetch_warmers(snapshot)
+        )
+        return agent.run(question, verbose=verbose, context=context)
+
+    def _record(self, question: str, answer: str) -> None:
+        if answer.startswith("LLM Error"):
+            return
+        with self._lock:
+            self.findings.append(Finding(question, answer))
+
+    def ask(self, question: str, verbose: bool = False) -> str:
+        answer = self._answer(question, self.context(), verbose)
+        self._record(question, answer)
+        return answer
+
+    def ask_many(self, questions: Iterable[str], jobs: int = 1, verbose: bool = False) -> List[str]:
+        """Answer `questions` in order, or `jobs` at a time when they are independent."""
+
+        questions = list(questions)
+        if jobs <= 1 or len(questions) <= 1:
+            return [self.ask(question, verbose=verbose) for question in questions]
+
+        context = self.context()
+        with ThreadPoolExecutor(max_workers=jobs, thread_name_prefix="ask") as executor:
+            futures = [executor.submit(self._answer, question, context, verbose) for question in questions]
+            answers = [future.result() for future in futures]
+        for question, answer in zip(questions, answers):
+            self._record(question, answer)
+        return answers
+
+
+__all__ = ["AskSession", "Finding", "load_questions"]
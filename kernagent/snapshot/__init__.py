@@ -1,6 +1,6 @@
 """Snapshot utilities for kernagent."""
 
 from .extractor import SnapshotError, build_snapshot  # noqa: F401
-from .tools import SnapshotTools, build_tool_map  # noqa: F401
+from .tools import SnapshotTools, build_prefetch_warmers, build_tool_map  # noqa: F401
 
-__all__ = ["SnapshotError", "build_snapshot", "SnapshotTools", "build_tool_map"]
+__all__ = ["SnapshotError", "build_snapshot", "SnapshotTools", "build_prefetch_warmers", "build_tool_map"]
@@ -0,0 +1,95 @@
+"""JSON codec for snapshot artifacts.
+
+orjson or msgspec is used when installed, with the stdlib json module as the
+fallback; KERNAGENT_JSON_CODEC=stdlib|orjson|msgspec forces a backend. Output
+is always compact (no indentation, minimal separators). Values the fast
+backends cannot represent (e.g. integers wider than 64 bits) transparently
+fall back to the stdlib codec.
+"""
+
+from __future__ import annotations
+
+import json
+import os
+from typing import IO, Any, Callable, Optional, Tuple
+
+from ..log import get_logger
+
+logger = get_logger(__name__)
+
+try:  # pragma: no cover - optional dependency
+    import orjson
+except ImportError:  # pragma: no cover - optional dependency
+    orjson = None
+
+try:  # pragma: no cover - optional dependency
+    import msgspec
+except ImportError:  # pragma: no cover - optional dependency
+    msgspec = None
+
+CODEC_STDLIB = "stdlib"
+CODEC_ORJSON = "orjson"
+CODEC_MSGSPEC = "msgspec"
+
+_STDLIB_DECODE_ERRORS: Tuple[type, ...] = (json.JSONDecodeError, ValueError, TypeError)
+_FAST_DECODE_ERRORS: Tuple[type, ...] = _STDLIB_DECODE_ERRORS + (
+    (msgspec.DecodeError,) if msgspec is not None else ()
+)
+
+# Exceptions raised by loads()/load() for malformed input.
+DecodeError = _STDLIB_DECODE_ERRORS
+
+
+def _stdlib_dumps(obj: Any) -> str:
+    return json.dumps(obj, separators=(",", ":"))
+
+
+def _select_backend() -> Tuple[str, Optional[Callable[[Any], Any]], Optional[Callable[[Any], bytes]]]:
+    requested = os.getenv("KERNAGENT_JSON_CODEC", "").strip().lower()
+    if requested and requested not in {CODEC_STDLIB, CODEC_ORJSON, CODEC_MSGSPEC}:
+        logger.warning("Unknown KERNAGENT_JSON_CODEC=%s; using auto-detection", requested)
+        requested = ""
+
+    if requested in {"", CODEC_ORJSON} and orjson is not None:
+        return CODEC_ORJSON, orjson.loads, orjson.dumps
+    if requested in {"", CODEC_MSGSPEC} and msgspec is not None:
+        return CODEC_MSGSPEC, msgspec.json.decode, msgspec.json.encode
+    if requested and requested != CODEC_STDLIB:
+        logger.warning("KERNAGENT_JSON_CODEC=%s is not installed; using stdlib json", requested)
+    return CODEC_STDLIB, None, None
+
+
+BACKEND, _fast_loads, _fast_dumps = _select_backend()
+
+
+def loads(data: str | bytes) -> Any:
+    """Decode one JSON document."""
+
+    if _fast_loads is not None:
+        try:
+            return _fast_loads(data)
+        except _FAST_DECODE_ERRORS:
+            pass  # let the stdlib decoder handle (or report) it
+    return json.loads(data)
+
+
+def dumps(obj: Any) -> str:
+    """Encode `obj` as compact JSON text."""
+
+    if _fast_dumps is not None:
+        try:
+            return _fast_dumps(obj).decode("utf-8")
+        except (TypeError, OverflowError, ValueError):
+            pass
+    return _stdlib_dumps(obj)
+
+
+def load(fh: IO[str]) -> Any:
+    return loads(fh.read())
+
+
+def dump(obj: Any, fh: IO[str]) -> None:
+    fh.write(dumps(obj))
+
+
+__all__ = ["BACKEND", "DecodeError", "dump", "dumps", "load", "loads"]
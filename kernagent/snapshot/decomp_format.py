@@ -0,0 +1,174 @@
+"""Token-lean rewriting of Ghidra decompiler output for LLM consumption.
+
+Ghidra's C is verbose: ``/* WARNING */`` banners, casts of a variable to the
+type it is already declared with, long auto-generated local names and
+declarations of locals that are never used. ``normalize_decompilation``
+removes that noise without changing what the code computes or touching
+anything the agent needs to cross-reference (function, global and label
+names such as ``FUN_10001020`` or ``DAT_1000c0`` are kept verbatim). Casts
+that convert a value (narrowing, signedness, int/float) are kept.
+"""
+
+from __future__ import annotations
+
+import re
+from typing import Dict, Set
+
+from .tokens import estimate_tokens
+
+# Bump when the rewrite rules change so cached results are recomputed.
+NORMALIZER_VERSION = 2
+
+_WARNING_COMMENT = re.compile(r"[ \t]*/\* WARNING:.*?\*/[ \t]*\n?", re.DOTALL)
+
+_UNDEFINED_TYPES = {"undefined": "byte", "undefined1": "u8", "undefined2": "u16", "undefined4": "u32", "undefined8": "u64"}
+_UNDEFINED_TYPE = re.compile(r"\bundefined[1248]?\b")
+
+# A cast applied directly to a variable: `(int)iVar1`, `(uint *)puVar2`. It is
+# only removed when the variable is declared with exactly that type. The
+# lookbehind keeps `sizeof(int)` and `f(void)` intact; the lookahead skips casts
+# whose operand is really `x[i]`, `x(...)`, `x.f` or `x->f`.
+_VARIABLE_CAST = re.compile(
+    r"(?<![\w\])])\((?P<type>[A-Za-z_][\w \t]*?[\s*]*)\)\s*(?P<name>[A-Za-z_]\w*)\b"
+    r"(?!\s*(?:\[|\(|\.|->|\+\+|--))"
+)
+_SIGNATURE = re.compile(r"^[^\n{;]*?\b[A-Za-z_]\w*\s*\((?P<params>[^)]*)\)\s*$", re.MULTILINE)
+_PARAMETER = re.compile(r"^(?P<type>[\w \t]+?[\s*]+)(?P<name>[A-Za-z_]\w*)$")
+_NULL_POINTER = re.compile(r"\((?:const\s+)?[A-Za-z_][\w ]*?\s*\*+\s*\)0x0\b")
+
+# Ghidra auto-generated local names and their short forms.
+_AUTO_NAMES = (
+    (re.compile(r"\b([A-Za-z]{1,3})Var(\d+)\b"), r"\1\2"),  # uVar1 -> u1, puVar3 -> pu3
+    (re.compile(r"\bparam_(\d+)\b"), r"a\1"),  # param_1 -> a1
+    (re.compile(r"\blocal_res([0-9a-f]+)\b"), r"r_\1"),
+    (re.compile(r"\blocal_([0-9a-f]+)\b"), r"l_\1"),
+    (re.compile(r"\bin_stack_([0-9a-f]+)\b"), r"stk_\1"),
+    (re.compile(r"\bextraout_(\w+)\b"), r"xo_\1"),
+)
+
+_IDENTIFIER = re.compile(r"\b[A-Za-z_]\w*\b")
+_DECLARATION = re.compile(
+    r"^[ \t]+(?P<type>[\w \t]+?[ \t*]\**)(?P<name>[A-Za-z_]\w*)(?P<array>[ \t]*\[\d+\])?;[ \t]*$"
+)
+# `return x;`, `goto LAB_1;` and friends have the shape of a declaration.
+_STATEMENT_KEYWORDS = frozenset({"return", "goto", "break", "continue", "case", "default", "do", "else", "throw", "delete"})
+_BLANK_RUNS = re.compile(r"\n{3,}")
+
+
+def rename_map(code: str) -> Dict[str, str]:
+    """Auto-name -> short-name map that never collides with an existing identifier."""
+
+    identifiers: Set[str] = set(_IDENTIFIER.findall(code))
+    mapping: Dict[str, str] = {}
+    taken = set(identifiers)
+    for name in sorted(identifiers):
+        for pattern, replacement in _AUTO_NAMES:
+            if pattern.fullmatch(name):
+                short = pattern.sub(replacement, name)
+                if short not in taken:
+                    mapping[name] = short
+                    taken.add(short)
+                break
+    return mapping
+
+
+def _declaration(line: str) -> "re.Match[str] | None":
+    match = _DECLARATION.match(line)
+    if match and match.group("type").split()[0] not in _STATEMENT_KEYWORDS:
+        return match
+    return None
+
+
+def _normalize_type(text: str) -> str:
+    return re.sub(r"\s*\*\s*", "*", " ".join(text.split()))
+
+
+def _declared_types(code: str) -> Dict[str, str]:
+    """Variable -> declared type, from the signature and the leading declaration block."""
+
+    types: Dict[str, str] = {}
+    lines = code.split("\n")
+    try:
+        start = lines.index("{")
+    except ValueError:
+        return types
+
+    signature = _SIGNATURE.search("\n".join(lines[:start]))
+    if signature:
+        for parameter in signature.group("params").split(","):
+            match = _PARAMETER.match(parameter.strip())
+            if match:
+                types[match.group("name")] = _normalize_type(match.group("type"))
+
+    for line in lines[start + 1 :]:
+        match = _declaration(line)
+        if not match:
+            break
+        if not match.group("array"):
+            types[match.group("name")] = _normalize_type(match.group("type"))
+    return types
+
+
+def _strip_redundant_casts(code: str) -> str:
+    declared = _declared_types(code)
+    if not declared:
+        return code
+
+    def replace(match: "re.Match[str]") -> str:
+        if declared.get(match.group("name")) == _normalize_type(match.group("type")):
+            return match.group("name")
+        return match.group(0)
+
+    return _VARIABLE_CAST.sub(replace, code)
+
+
+def _drop_dead_locals(code: str) -> str:
+    """Remove declarations in the leading local block whose name is never used again."""
+
+    lines = code.split("\n")
+    try:
+        start = lines.index("{") + 1
+    except ValueError:
+        return code
+
+    counts: Dict[str, int] = {}
+    for name in _IDENTIFIER.findall(code):
+        counts[name] = counts.get(name, 0) + 1
+
+    kept = lines[:start]
+    index = start
+    while index < len(lines):
+        line = lines[index]
+        # The block ends at the first blank line or statement.
+        match = _declaration(line)
+        if not match:
+            break
+        if counts.get(match.group("name"), 0) > 1:
+            kept.append(line)
+        index += 1
+    kept.extend(lines[index:])
+    return "\n".join(kept)
+
+
+def normalize_decompilation(code: str) -> str:
+    """Return a shorter rendering of Ghidra C output that computes the same thing."""
+
+    if not code:
+        return code
+    code = code.replace("\r\n", "\n")
+    code = _WARNING_COMMENT.sub("", code)
+    code = _NULL_POINTER.sub("NULL", code)
+    code = _strip_redundant_casts(code)
+    code = _UNDEFINED_TYPE.sub(lambda m: _UNDEFINED_TYPES[m.group(0)], code)
+
+    mapping = rename_map(code)
+    if mapping:
+        code = _IDENTIFIER.sub(lambda m: mapping.get(m.group(0), m.group(0)), code)
+
+    code = _drop_dead_locals(code)
+    code = "\n".join(line.rstrip() for line in code.split("\n"))
+    code = _BLANK_RUNS.sub("\n\n", code)
+    return code.strip("\n") + "\n"
+
+
+__all__ = ["NORMALIZER_VERSION", "estimate_tokens", "normalize_decompilation", "rename_map"]
@@ -0,0 +1,299 @@
+"""Anchor-based slicing of decompiled C.
+
+Given the lines of one decompiled function and a regex for an anchor (an
+API name, a string/global address or a local variable), keep the lines that
+mention the anchor, the lines they depend on through local variables
+(backwards) or that consume values they produce (forwards), and the control
+headers enclosing all of those. Everything else is folded into one-line
+outline comments listing the calls it contains.
+
+The "parser" is line based and relies on Ghidra's layout (one statement per
+line, braces on header lines); it is a reading aid, not a compiler.
+"""
+
+from __future__ import annotations
+
+import re
+from typing import Callable, Dict, List, Optional, Pattern, Set
+
+_IDENTIFIER = re.compile(r"\b[A-Za-z_]\w*\b")
+_CALL = re.compile(r"\b([A-Za-z_]\w*)\s*\(")
+_STRING_LITERAL = re.compile(r'"(?:[^"\\]|\\.)*"|\'(?:[^\'\\]|\\.)*\'')
+_ASSIGNMENT = re.compile(r"^(?P<lhs>[^=;\"']*?[\w\]\)])\s*(?:[-+*/%&|^]|<<|>>)?=(?!=)(?P<rhs>.*)$")
+_DECLARATION = re.compile(r"^[\w \t]+?[ \t*]\**(?P<name>[A-Za-z_]\w*)(?:[ \t]*\[\d+\])?;$")
+_CASE_LABEL = re.compile(r"^(?:case\b.*|default\s*):$")
+_CONTROL_CALLS = frozenset({"if", "while", "for", "switch", "return", "sizeof"})
+
+# Hops followed from the anchor lines through variable definitions / uses.
+BACKWARD_DEPTH = 2
+FORWARD_DEPTH = 1
+
+
+def _strip_literals(line: str) -> str:
+    return _STRING_LITERAL.sub('""', line)
+
+
+def _parameters(signature: str) -> Set[str]:
+    start, end = signature.find("("), signature.rfind(")")
+    if start < 0 or end < start:
+        return set()
+    names = set()
+    for param in signature[start + 1 : end].split(","):
+        identifiers = _IDENTIFIER.findall(param)
+        if identifiers:
+            names.add(identifiers[-1])
+    return names
+
+
+class _Function:
+    """Line-level facts about one decompiled function."""
+
+    def __init__(self, lines: List[str]):
+        self.lines = lines
+        self.body_start = next((i for i, line in enumerate(lines) if line.strip() == "{"), None)
+        signature = " ".join(lines[: self.body_start]) if self.body_start is not None else ""
+
+        self.variables: Set[str] = _parameters(signature)
+        self.declarations: Dict[str, int] = {}
+        self.defs: List[Set[str]] = []
+        self.uses: List[Set[str]] = []
+        self.enclosing: List[List[int]] = []  # header lines of the blocks containing each line
+        self.block_end: Dict[int, int] = {}
+        self.statement: List[int] = []  # first line of the statement each line belongs to
+
+        stack: List[int] = []
+        open_statement: Optional[int] = None
+        in_declarations = self.body_start is not None
+        for index, raw in enumerate(lines):
+            line = _strip_literals(raw.strip())
+            self.enclosing.append(list(stack))
+            self.statement.append(index if open_statement is None else open_statement)
+            if line and not line.startswith(("/*", "//")):
+                continuing = not line.endswith((";", "{", "}", ":", "*/"))
+                open_statement = self.statement[index] if continuing else None
+
+            if self.body_start is not None and index > self.body_start and in_declarations:
+                match = _DECLARATION.match(line)
+                if match:
+                    self.variables.add(match.group("name"))
+                    self.declarations[match.group("name")] = index
+                elif line:
+                    in_declarations = False
+
+            calls = set(_CALL.findall(line))
+            identifiers = set(_IDENTIFIER.findall(line)) - calls
+            assignment = _ASSIGNMENT.match(line) if index not in self.declarations.values() else None
+            if assignment:
+                lhs = set(_IDENTIFIER.findall(assignment.group("lhs")))
+                self.defs.append(lhs)
+                self.uses.append(identifiers - lhs | (lhs if assignment.group("lhs").startswith("*") else set()))
+            else:
+                self.defs.append(set())
+                self.uses.append(identifiers)
+
+            for char in line:
+                if char == "{":
+                    stack.append(index)
+                elif char == "}" and stack:
+                    self.block_end[stack.pop()] = index
+
+    def statement_lines(self, index: int) -> range:
+        """All lines of the (possibly multi-line) statement containing `index`."""
+
+        start = self.statement[index]
+        end = index
+        while end + 1 < len(self.lines) and self.statement[end + 1] == start:
+            end += 1
+        return range(start, end + 1)
+
+    def case_label(self, index: int) -> Optional[int]:
+        """Nearest preceding case/default label in the same switch body."""
+
+        own = self.lines[index].strip()
+        if own.startswith("}") or _CASE_LABEL.match(own):
+            return None
+        depth = len(self.enclosing[index])
+        for candidate in range(index - 1, -1, -1):
+            if len(self.enclosing[candidate]) < depth:
+                return None
+            if len(self.enclosing[candidate]) == depth and _CASE_LABEL.match(self.lines[candidate].strip()):
+                return candidate
+        return None
+
+    def if_chain_start(self, index: int) -> int:
+        """For an `else`/`else if` header, the `if` header that starts the chain."""
+
+        depth = len(self.enclosing[index])
+        current = index
+        while self.lines[current].strip().startswith("else"):
+            previous = next(
+                (
+                    candidate
+                    for candidate in range(current - 1, -1, -1)
+                    if len(self.enclosing[candidate]) == depth and self.lines[candidate].strip() != "}"
+                ),
+                None,
+            )
+            if previous is None:
+                break
+            current = previous
+        return current
+
+
+def _propagate(func: _Function, seeds: Set[int]) -> Set[int]:
+    keep = set(seeds)
+
+    # Backwards: definitions of the locals the kept lines read.
+    frontier = set(seeds)
+    for _ in range(BACKWARD_DEPTH):
+        needed = set().union(*(func.uses[i] for i in frontier)) & func.variables if frontier else set()
+        added = {
+            i for i, defs in enumerate(func.defs) if i not in keep and defs & needed
+        }
+        if not added:
+            break
+        keep |= added
+        frontier = added
+
+    # Forwards: lines consuming values the anchor lines produce.
+    frontier = set(seeds)
+    for _ in range(FORWARD_DEPTH):
+        produced = set().union(*(func.defs[i] for i in frontier)) & func.variables if frontier else set()
+        added = {i for i, uses in enumerate(func.uses) if i not in keep and uses & produced}
+        if not added:
+            break
+        keep |= added
+        frontier = added
+    return keep
+
+
+def _close_over_control(func: _Function, keep: Set[int]) -> Set[int]:
+    result = set(keep)
+    pending = list(keep)
+    while pending:
+        index = pending.pop()
+        # Whole multi-line statements, e.g. a `while (a &&` header split over lines.
+        extra: List[int] = list(func.statement_lines(index))
+        extra += func.enclosing[index]
+        label = func.case_label(index)
+        if label is not None:
+            extra.append(label)
+        if func.lines[index].strip().startswith("else"):
+            extra.append(func.if_chain_start(index))
+        for header in list(extra):
+            end = func.block_end.get(header)
+            if end is not None:
+                extra.append(end)
+        for line in extra:
+            if line not in result:
+                result.add(line)
+                pending.append(line)
+    return result
+
+
+def _outline(func: _Function, start: int, end: int) -> str:
+    calls: List[str] = []
+    for index in range(start, end + 1):
+        for name in _CALL.findall(_strip_literals(func.lines[index])):
+            if name not in _CONTROL_CALLS and name not in calls:
+                calls.append(name)
+    first = next((func.lines[i] for i in range(start, end + 1) if func.lines[i].strip()), "")
+    indent = re.match(r"\s*", first).group(0)
+    count = end - start + 1
+    summary = f"{count} line{'s' if count != 1 else ''} omitted (L{start + 1}-L{end + 1})"
+    if calls:
+        shown = ", ".join(calls[:8]) + (", ..." if len(calls) > 8 else "")
+        summary += f"; calls {shown}"
+    return f"{indent}/* ... {summary} */"
+
+
+def _parse(code: str) -> _Function:
+    lines = code.split("\n")
+    while lines and not lines[-1].strip():
+        lines.pop()
+    return _Function(lines)
+
+
+def _render(func: _Function, keep: Set[int]) -> List[str]:
+    lines = func.lines
+    keep = set(keep)
+    if func.body_start is not None:
+        keep |= set(range(func.body_start + 1))
+        keep.add(func.block_end.get(func.body_start, len(lines) - 1))
+
+    # Unused declarations are dropped silently rather than outlined.
+    skip = set(func.declarations.values()) - keep
+    output: List[str] = []
+    index = 0
+    while index < len(lines):
+        if index in keep:
+            output.append(lines[index])
+            index += 1
+            continue
+        if index in skip:
+            index += 1
+            continue
+        start = index
+        while index < len(lines) and index not in keep and index not in skip:
+            index += 1
+        if any(lines[i].strip() for i in range(start, index)):
+            output.append(_outline(func, start, index - 1))
+    return output
+
+
+def slice_decompilation(code: str, anchor: Pattern[str]) -> Optional[Dict[str, object]]:
+    """Slice `code` around lines matching `anchor`; None if the anchor never occurs."""
+
+    func = _parse(code)
+    seeds = {i for i, line in enumerate(func.lines) if anchor.search(line)}
+    if not seeds:
+        return None
+
+    statements = {line for seed in seeds for line in func.statement_lines(seed)}
+    keep = _close_over_control(func, _propagate(func, statements))
+    kept_vars = set().union(*(func.defs[i] | func.uses[i] for i in keep))
+    keep |= {line for name, line in func.declarations.items() if name in kept_vars}
+
+    output = _render(func, keep)
+    return {
+        "code": "\n".join(output) + "\n",
+        "anchor_lines": sorted(i + 1 for i in seeds),
+        "lines": len(output),
+        "total_lines": len(func.lines),
+    }
+
+
+def outline_decompilation(
+    code: str, max_tokens: Optional[int] = None, estimate: Optional[Callable[[str], int]] = None
+) -> Dict[str, object]:
+    """Control-flow skeleton of `code`: statements nested deeper than some depth are folded.
+
+    The deepest nesting level whose outline fits in `max_tokens` is used
+    (`estimate` counts tokens); without a limit, only top-level statements are kept.
+    """
+
+    func = _parse(code)
+    depths = [len(enclosing) for enclosing in func.enclosing]
+    max_depth = max(depths, default=1)
+
+    chosen: List[str] = []
+    chosen_depth = 1
+    for depth in range(max_depth if max_tokens else 1, 0, -1):
+        keep = {i for i, level in enumerate(depths) if level <= depth} - set(func.declarations.values())
+        keep |= {func.block_end[i] for i in keep if i in func.block_end}
+        used = set().union(*(func.uses[i] | func.defs[i] for i in keep))
+        keep |= {line for name, line in func.declarations.items() if name in used}
+        output = _render(func, keep)
+        chosen, chosen_depth = output, depth
+        if not max_tokens or estimate is None or estimate("\n".join(output)) <= max_tokens:
+            break
+
+    return {
+        "code": "\n".join(chosen) + "\n",
+        "depth": chosen_depth,
+        "lines": len(chosen),
+        "total_lines": len(func.lines),
+    }
+
+
+__all__ = ["outline_decompilation", "slice_decompilation"]
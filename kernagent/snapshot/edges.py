@@ -0,0 +1,277 @@
+"""Normalized reference edges between functions.
+
+Snapshots used to store the same edges three times: ``xrefs_out`` in
+functions.jsonl (one entry per call site, repeating the callee's address, name
+and type), ``xrefs_in`` (caller addresses) and ``callgraph.jsonl``. The
+extractor now writes them once, as ``edges.json``:
+
+    {"version": 1,
+     "types": ["COMPUTED_CALL", "DATA", "UNCONDITIONAL_CALL", ...],
+     "nodes": [["10001020", "FUN_10001020"], ["EXTERNAL:00000004", "SizeofResource"], ...],
+     "edges": [[src, dst, type, count], ...]}
+
+Nodes are ``[ea, name]`` pairs in address order and edges refer to them (and to
+``types``) by position; an edge is one (caller, callee, reference type) triple
+with the number of sites that make that reference. Per-function views
+(``xrefs_out``, ``xrefs_in``, the call graph) are derived on load. For older
+snapshots the table is built from the per-function lists on first use and
+stored as ``edges.json`` next to them, with a ``source`` signature so a rebuilt
+snapshot invalidates it.
+"""
+
+from __future__ import annotations
+
+import hashlib
+import os
+import threading
+from collections import defaultdict
+from pathlib import Path
+from typing import Any, Dict, Iterable, List, Optional, Tuple
+
+from ..log import get_logger
+from . import codec
+from .records import CallEdge
+from .shards import SHARD_MANIFEST, iter_records, record_paths
+
+logger = get_logger(__name__)
+
+EDGES_FILE = "edges.json"
+EDGES_VERSION = 1
+# Type given to an older snapshot's xrefs_in entry that has no matching call site.
+REFERENCE_TYPE = "REFERENCE"
+
+# (caller ea, caller name, callee ea, callee name, reference type)
+RawEdge = Tuple[str, Optional[str], str, Optional[str], str]
+
+
+def is_flow_type(type_name: Optional[str]) -> bool:
+    """Calls and jumps (Ghidra flow reference types); everything else is a plain reference."""
+
+    upper = (type_name or "").upper()
+    return "CALL" in upper or "JUMP" in upper
+
+
+def _node_key(ea: str) -> Tuple[int, int, str]:
+    try:
+        return (0, int(ea, 16), ea)
+    except ValueError:
+        return (1, 0, ea)
+
+
+class EdgeTable:
+    """Deduplicated edges with per-node adjacency lists."""
+
+    def __init__(
+        self,
+        types: List[str],
+        nodes: List[List[Optional[str]]],
+        edges: List[List[int]],
+        source: Optional[Dict[str, Any]] = None,
+    ):
+        self.types = types
+        self.eas: List[str] = [node[0] for node in nodes]
+        self.names: List[Optional[str]] = [node[1] for node in nodes]
+        self.edges = edges
+        self.source = source
+        self._flow = [is_flow_type(name) for name in types]
+        self._ids = {ea: node for node, ea in enumerate(self.eas)}
+        self._out: Dict[int, List[List[int]]] = defaultdict(list)
+        self._in: Dict[int, List[List[int]]] = defaultdict(list)
+        for edge in edges:
+            self._out[edge[0]].append(edge)
+            self._in[edge[1]].append(edge)
+
+    # -- construction ------------------------------------------------------------
+
+    @classmethod
+    def from_edges(cls, raw_edges: Iterable[RawEdge]) -> "EdgeTable":
+        """Aggregate one entry per reference site into counted, sorted edges."""
+
+        names: Dict[str, Optional[str]] = {}
+        counts: Dict[Tuple[str, str, str], int] = defaultdict(int)
+        for src, src_name, dst, dst_name, type_name in raw_edges:
+            if not src or not dst:
+                continue
+            if names.get(src) is None:
+                names[src] = src_name
+            if names.get(dst) is None:
+                names[dst] = dst_name
+            counts[(src, dst, type_name or REFERENCE_TYPE)] += 1
+
+        eas = sorted(names, key=_node_key)
+        ids = {ea: node for node, ea in enumerate(eas)}
+        types = sorted({type_name for _, _, type_name in counts})
+        type_ids = {type_name: number for number, type_name in enumerate(types)}
+        edges = sorted(
+            [ids[src], ids[dst], type_ids[type_name], count] for (src, dst, type_name), count in counts.items()
+        )
+        return cls(types, [[ea, names[ea]] for ea in eas], edges)
+
+    @classmethod
+    def from_functions(cls, records: Iterable[Dict[str, Any]]) -> "EdgeTable":
+        """Build the table from an older snapshot's xrefs_out/xrefs_in function fields."""
+
+        raw: List[RawEdge] = []
+        callers: List[Tuple[str, str]] = []
+        names: Dict[str, Optional[str]] = {}
+        for record in records:
+            ea = record.get("ea")
+            if not ea:
+                continue
+            names[ea] = record.get("name")
+            for xref in record.get("xrefs_out") or []:
+                raw.append((ea, record.get("name"), xref.get("ea"), xref.get("name"), xref.get("type")))
+            callers.extend((caller, ea) for caller in record.get("xrefs_in") or [])
+
+        # xrefs_in also lists functions that only take the callee's address.
+        flow_pairs = {(src, dst) for src, _, dst, _, _ in raw}
+        raw.extend(
+            (caller, names.get(caller), ea, names.get(ea), REFERENCE_TYPE)
+            for caller, ea in callers
+            if (caller, ea) not in flow_pairs
+        )
+        return cls.from_edges(raw)
+
+    @classmethod
+    def from_payload(cls, payload: Dict[str, Any]) -> "EdgeTable":
+        return cls(payload["types"], payload["nodes"], payload["edges"], payload.get("source"))
+
+    def to_payload(self) -> Dict[str, Any]:
+        payload: Dict[str, Any] = {
+            "version": EDGES_VERSION,
+            "types": self.types,
+            "nodes": [[ea, name] for ea, name in zip(self.eas, self.names)],
+            "edges": self.edges,
+        }
+        if self.source is not None:
+            payload["source"] = self.source
+        return payload
+
+    # -- views -------------------------------------------------------------------
+
+    def __len__(self) -> int:
+        return len(self.edges)
+
+    def node_id(self, ea: Optional[str]) -> Optional[int]:
+        return self._ids.get(ea) if ea else None
+
+    def _view(self, edge: List[int]) -> CallEdge:
+        src, dst, type_id, count = edge
+        return CallEdge(
+            from_ea=self.eas[src],
+            to_ea=self.eas[dst],
+            from_name=self.names[src],
+            to_name=self.names[dst],
+            type=self.types[type_id],
+            count=count,
+        )
+
+    def outgoing(self, node: Optional[int], flow_only: bool = True) -> List[CallEdge]:
+        """Edges from `node` (a node_id()); calls and jumps only unless `flow_only` is False."""
+
+        if node is None:
+            return []
+        return [self._view(edge) for edge in self._out.get(node, ()) if not flow_only or self._flow[edge[2]]]
+
+    def incoming(self, node: Optional[int], flow_only: bool = False) -> List[CallEdge]:
+        """Edges into `node`; every reference type unless `flow_only` is set."""
+
+        if node is None:
+            return []
+        return [self._view(edge) for edge in self._in.get(node, ()) if not flow_only or self._flow[edge[2]]]
+
+    def callees(self, ea: Optional[str]) -> List[Dict[str, Any]]:
+        """The ``xrefs_out`` view: one entry per called function and reference type."""
+
+        return [
+            {"ea": edge.to_ea, "name": edge.to_name, "type": edge.type, "count": edge.count}
+            for edge in self.outgoing(self.node_id(ea))
+        ]
+
+    def callers(self, ea: Optional[str]) -> List[str]:
+        """The ``xrefs_in`` view: addresses of functions that reference `ea`."""
+
+        return list(dict.fromkeys(edge.from_ea for edge in self.incoming(self.node_id(ea))))
+
+    def call_sites(self, ea: Optional[str]) -> int:
+        """Call and jump sites in `ea` (what ``len(xrefs_out)`` used to count)."""
+
+        return sum(edge.count for edge in self.outgoing(self.node_id(ea)))
+
+    def call_edges(self) -> Iterable[CallEdge]:
+        """The ``callgraph.jsonl`` view: flow edges in (caller, callee) order."""
+
+        return (self._view(edge) for edge in self.edges if self._flow[edge[2]])
+
+
+def _source_signature(root: Path) -> Dict[str, Any]:
+    """What a derived table was built from: functions.jsonl's size and mtime, shards.json's content."""
+
+    signature: Dict[str, Any] = {}
+    path = root / "functions.jsonl"
+    if path.exists():
+        stat = path.stat()
+        signature["functions.jsonl"] = [stat.st_size, stat.st_mtime_ns]
+    manifest = root / SHARD_MANIFEST
+    if manifest.exists():
+        signature[SHARD_MANIFEST] = hashlib.sha256(manifest.read_bytes()).hexdigest()
+    return signature
+
+
+def write_edge_table(output_dir: Path, table: EdgeTable) -> Path:
+    path = Path(output_dir) / EDGES_FILE
+    # Replaced atomically: tools and the BM25 build may derive the table concurrently.
+    tmp = path.with_name(f".{EDGES_FILE}.{os.getpid()}.{threading.get_ident()}.tmp")
+    try:
+        with tmp.open("w", encoding="utf-8") as f:
+            codec.dump(table.to_payload(), f)
+        os.replace(tmp, path)
+    finally:
+        tmp.unlink(missing_ok=True)
+    return path
+
+
+def load_edge_table(root: Path, manifest: Optional[Dict[str, List[Dict[str, Any]]]] = None) -> EdgeTable:
+    """
+    The snapshot's edge table.
+
+    Reads ``edges.json``; for snapshots that predate it (or whose functions
+    changed since it was derived) the table is built from functions.jsonl and
+    persisted when the archive is writable.
+    """
+
+    root = Path(root)
+    path = root / EDGES_FILE
+    signature: Optional[Dict[str, Any]] = None
+    if path.exists():
+        try:
+            with path.open("r", encoding="utf-8") as f:
+                payload = codec.load(f)
+            if payload.get("version") == EDGES_VERSION:
+                # Tables written by the extractor carry no source signature and are authoritative.
+                if "source" not in payload:
+                    return EdgeTable.from_payload(payload)
+                signature = _source_signature(root)
+                if payload["source"] == signature:
+                    return EdgeTable.from_payload(payload)
+        except (OSError, KeyError, AttributeError, IndexError, TypeError, *codec.DecodeError) as exc:
+            logger.warning("Rebuilding unreadable edge table %s: %s", path, exc)
+
+    fields = ("ea", "name", "xrefs_in", "xrefs_out")
+    table = EdgeTable.from_functions(iter_records(record_paths(root, "functions", manifest), fields=fields))
+    table.source = signature if signature is not None else _source_signature(root)
+    try:
+        write_edge_table(root, table)
+    except OSError as exc:  # read-only archive: keep the in-memory table
+        logger.debug("Could not persist edge table to %s: %s", path, exc)
+    return table
+
+
+__all__ = [
+    "EDGES_FILE",
+    "EdgeTable",
+    "REFERENCE_TYPE",
+    "is_flow_type",
+    "load_edge_table",
+    "write_edge_table",
+]
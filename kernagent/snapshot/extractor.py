@@ -9,8 +9,19 @@ import zipfile
 from pathlib import Path
 from typing import Any, Dict, List
 
-from ..capa_runner import build_capa_summary
+from ..capa_runner import (
+    CAPA_BACKEND_GHIDRA,
+    GhidraCapaContext,
+    build_capa_summary,
+    resolve_capa_backend,
+    resolve_capa_max_functions,
+    select_capa_functions,
+)
 from ..log import get_logger
+from . import codec
+from .edges import EdgeTable, write_edge_table
+from .shards import resolve_shard_records, write_manifest, write_records
+from .tokens import function_token_estimates, tokenizer_spec
 
 logger = get_logger(__name__)
 
@@ -213,6 +224,32 @@ class BinaryArchiveExtractor:
 
         return list(set(xrefs_in))  # Remove duplicates
 
+    def get_references_to_function(self, function, program) -> List[Dict[str, str]]:
+        """Get non-call references TO this function (address taken, callback tables)"""
+        references_in = []
+        entry_point = function.getEntryPoint()
+
+        ref_mgr = program.getReferenceManager()
+        func_mgr = program.getFunctionManager()
+
+        for ref in ref_mgr.getReferencesTo(entry_point):
+            ref_type = ref.getReferenceType()
+            # Calls and jumps are collected from the caller side
+            if ref_type.isCall() or ref_type.isJump():
+                continue
+            # Get the function containing this reference
+            caller = func_mgr.getFunctionContaining(ref.getFromAddress())
+            if caller:
+                references_in.append(
+                    {
+                        "ea": str(caller.getEntryPoint()),
+                        "name": caller.getName(),
+                        "type": str(ref_type),
+                    }
+                )
+
+        return references_in
+
     def get_xrefs_from_function(self, function, program) -> List[Dict[str, str]]:
         """Get all cross-references FROM this function (callees)"""
         xrefs_out = []
@@ -321,8 +358,6 @@ class BinaryArchiveExtractor:
                 [str(addr_range.getMinAddress()), str(addr_range.getMaxAddress())]
                 for addr_range in function.getBody()
             ],
-            "xrefs_in": self.get_xrefs_to_function(function, program),
-            "xrefs_out": self.get_xrefs_from_function(function, program),
         }
 
         # Function signature/prototype
@@ -333,6 +368,11 @@ class BinaryArchiveExtractor:
         # Function metrics
         func_data["metrics"] = self.extract_function_metrics(function, program, monitor)
 
+        # Reserve decomp_path/tokens ahead of the bulky insn/bb lists so field-projected
+        # readers can stop decoding early; filled in after decompilation below.
+        func_data["decomp_path"] = None
+        func_data["tokens"] = None
+
         # Extract instructions
         instructions = []
         listing = program.getListing()
@@ -383,6 +423,12 @@ class BinaryArchiveExtractor:
             func_data["decomp_path"] = None
             func_data["decompiled_code"] = None
 
+        # Token-cost estimates so readers can budget before fetching code
+        func_data["tokens"] = {
+            "tokenizer": tokenizer_spec(),
+            **function_token_estimates(func_data.get("decompiled_code"), instructions),
+        }
+
         return func_data
 
     def extract_strings(self, program) -> List[Dict[str, Any]]:
@@ -479,36 +525,60 @@ class BinaryArchiveExtractor:
 
                     imports.append(import_info)
 
-            # Extract exports (public symbols)
-            symbol_iter = symbol_table.getSymbolIterator()
-            for symbol in symbol_iter:
-                if symbol.isExternal():
+            # Extract exports (external entry points only; the full symbol
+            # table is written separately by extract_symbols)
+            func_mgr = program.getFunctionManager()
+            entry_iter = symbol_table.getExternalEntryPointIterator()
+            while entry_iter.hasNext():
+                addr = entry_iter.next()
+                symbol = symbol_table.getPrimarySymbol(addr)
+                if symbol is None or symbol.isExternal():
                     continue
 
-                # Check if symbol is exported (public/global)
-                if symbol.isGlobal() or symbol.isExternalEntryPoint():
-                    export_info = {
-                        "name": symbol.getName(),
-                        "address": str(symbol.getAddress()),
-                        "type": str(symbol.getSymbolType()),
-                    }
+                export_info = {
+                    "name": symbol.getName(),
+                    "address": str(addr),
+                    "type": str(symbol.getSymbolType()),
+                }
 
-                    # If it's a function, get signature
-                    if symbol.getSymbolType().toString() == "Function":
-                        func_mgr = program.getFunctionManager()
-                        func = func_mgr.getFunctionAt(symbol.getAddress())
-                        if func:
-                            sig = func.getSignature()
-                            if sig:
-                                export_info["signature"] = str(sig.getPrototypeString())
+                func = func_mgr.getFunctionAt(addr)
+                if func:
+                    sig = func.getSignature()
+                    if sig:
+                        export_info["signature"] = str(sig.getPrototypeString())
 
-                    exports.append(export_info)
+                exports.append(export_info)
 
         except Exception as e:
             logger.warning("Error extracting imports/exports: %s", e)
 
         return {"imports": imports, "exports": exports}
 
+    def extract_symbols(self, program) -> List[Dict[str, Any]]:
+        """Extract every global (non-external) symbol for symbols.jsonl"""
+        self.log("Extracting symbols...")
+
+        symbols = []
+
+        try:
+            symbol_table = program.getSymbolTable()
+            for symbol in symbol_table.getSymbolIterator():
+                if symbol.isExternal() or not symbol.isGlobal():
+                    continue
+                symbols.append(
+                    {
+                        "name": symbol.getName(),
+                        "address": str(symbol.getAddress()),
+                        "type": str(symbol.getSymbolType()),
+                        "entry_point": symbol.isExternalEntryPoint(),
+                    }
+                )
+
+        except Exception as e:
+            logger.warning("Error extracting symbols: %s", e)
+
+        return symbols
+
     def extract_memory_sections(self, program) -> List[Dict[str, Any]]:
         """Extract memory section/segment information"""
         self.log("Extracting memory sections...")
@@ -638,47 +708,28 @@ class BinaryArchiveExtractor:
 
         return metrics
 
-    def extract_call_graph(self, program) -> List[Dict[str, str]]:
-        """Extract call graph edges (caller -> callee relationships)"""
+    def extract_edges(self, program, functions) -> EdgeTable:
+        """Extract references between functions as a deduplicated edge table (see edges.py)"""
         self.log("Extracting call graph...")
 
-        edges = []
-        seen_edges = set()
+        raw_edges = []
 
         try:
-            func_manager = program.getFunctionManager()
-            functions = func_manager.getFunctions(True)
-
             for func in functions:
-                caller_addr = str(func.getEntryPoint())
-                caller_name = func.getName()
-
-                # Get all functions this one calls
-                xrefs_out = self.get_xrefs_from_function(func, program)
+                func_addr = str(func.getEntryPoint())
+                func_name = func.getName()
 
-                for xref in xrefs_out:
-                    callee_addr = xref["ea"]
-                    callee_name = xref["name"]
+                # One entry per call/jump site; EdgeTable counts repeats
+                for xref in self.get_xrefs_from_function(func, program):
+                    raw_edges.append((func_addr, func_name, xref["ea"], xref["name"], xref["type"]))
 
-                    # Create unique edge identifier to avoid duplicates
-                    edge_id = f"{caller_addr}->{callee_addr}"
+                for ref in self.get_references_to_function(func, program):
+                    raw_edges.append((ref["ea"], ref["name"], func_addr, func_name, ref["type"]))
 
-                    if edge_id not in seen_edges:
-                        seen_edges.add(edge_id)
-                        edges.append(
-                            {
-                                "from": caller_addr,
-                                "from_name": caller_name,
-                                "to": callee_addr,
-                                "to_name": callee_name,
-                                "type": xref.get("type", "call"),
-                            }
-                        )
-
-        except Exception as e:
-            logger.warning("Error extracting call graph: %s", e)
+        except Exception as e:
+            logger.warning("Error extracting call graph: %s", e)
 
-        return edges
+        return EdgeTable.from_edges(raw_edges)
 
     def extract_equates(self, program) -> List[Dict[str, Any]]:
         """Extract equate (named constant) definitions"""
@@ -787,6 +838,31 @@ class BinaryArchiveExtractor:
 
         return {"by_name": by_name, "by_ea": by_ea}
 
+    def run_capa(
+        self,
+        functions_data: List[Dict[str, Any]],
+        ghidra_context: GhidraCapaContext | None = None,
+        sample_sha256: str | None = None,
+    ) -> Path | None:
+        """Build capa_summary.json, optionally reusing the open Ghidra program"""
+        function_addresses = None
+        max_functions = resolve_capa_max_functions()
+        if max_functions:
+            function_addresses = select_capa_functions(functions_data, max_functions)
+            self.log(f"Restricting capa to {len(function_addresses)} functions")
+
+        try:
+            return build_capa_summary(
+                self.binary_path,
+                self.output_dir,
+                ghidra_context=ghidra_context,
+                function_addresses=function_addresses,
+                sample_sha256=sample_sha256,
+            )
+        except Exception as exc:  # pragma: no cover - runtime specific
+            logger.warning("capa summary generation failed: %s", exc)
+            return None
+
     def extract_all(self) -> Path:
         """Main extraction routine."""
         logger.info("Starting snapshot extraction for %s", self.binary_path)
@@ -799,6 +875,8 @@ class BinaryArchiveExtractor:
         metadata: Dict[str, Any] | None = None
         meta_path = self.output_dir / "meta.json"
         capa_summary_path: Path | None = None
+        capa_ran = False
+        functions_data: List[Dict[str, Any]] = []
 
         try:
             with pyghidra.open_program(self.binary_path, analyze=True) as flat_api:
@@ -819,17 +897,31 @@ class BinaryArchiveExtractor:
 
                 sections = self.extract_memory_sections(program)
                 with open(self.output_dir / "sections.json", "w", encoding="utf-8") as f:
-                    json.dump(sections, f, indent=2)
+                    codec.dump(sections, f)
 
                 imports_exports = self.extract_imports_exports(program)
                 with open(
                     self.output_dir / "imports_exports.json", "w", encoding="utf-8"
                 ) as f:
-                    json.dump(imports_exports, f, indent=2)
+                    codec.dump(imports_exports, f)
+
+                symbols = self.extract_symbols(program)
+                with open(self.output_dir / "symbols.jsonl", "w", encoding="utf-8") as f:
+                    for symbol in symbols:
+                        f.write(codec.dumps(symbol) + "\n")
+
+                symbols_index: Dict[str, Dict[str, List[str]]] = {"by_name": {}}
+                for symbol in symbols:
+                    symbols_index["by_name"].setdefault(symbol["name"], []).append(
+                        symbol["address"]
+                    )
+
+                with open(self.output_dir / "symbols_index.json", "w", encoding="utf-8") as f:
+                    codec.dump(symbols_index, f)
 
                 equates = self.extract_equates(program)
                 with open(self.output_dir / "equates.json", "w", encoding="utf-8") as f:
-                    json.dump(equates, f, indent=2)
+                    codec.dump(equates, f)
 
                 func_manager = program.getFunctionManager()
                 functions = list(func_manager.getFunctions(True))
@@ -852,34 +944,32 @@ class BinaryArchiveExtractor:
 
                     functions_data.append(func_data)
 
-                call_graph = self.extract_call_graph(program)
-                with open(
-                    self.output_dir / "callgraph.jsonl", "w", encoding="utf-8"
-                ) as f:
-                    for edge in call_graph:
-                        f.write(json.dumps(edge) + "\n")
+                edges = self.extract_edges(program, functions)
+                write_edge_table(self.output_dir, edges)
 
                 index = self.create_index(functions_data)
                 with open(self.output_dir / "index.json", "w", encoding="utf-8") as f:
-                    json.dump(index, f, indent=2)
+                    codec.dump(index, f)
 
-                with open(
-                    self.output_dir / "functions.jsonl", "w", encoding="utf-8"
-                ) as f:
-                    for func_data in functions_data:
-                        f.write(json.dumps(func_data) + "\n")
+                shard_records = resolve_shard_records()
+                shard_entries = {
+                    "functions": write_records(
+                        self.output_dir, "functions", functions_data, shard_records
+                    )
+                }
 
                 strings_data = self.extract_strings(program)
-                with open(
-                    self.output_dir / "strings.jsonl", "w", encoding="utf-8"
-                ) as f:
-                    for string_data in strings_data:
-                        f.write(json.dumps(string_data) + "\n")
+                shard_entries["strings"] = write_records(
+                    self.output_dir, "strings", strings_data, shard_records
+                )
 
                 data_sections = self.extract_data_sections(program)
-                with open(self.output_dir / "data.jsonl", "w", encoding="utf-8") as f:
-                    for data_item in data_sections:
-                        f.write(json.dumps(data_item) + "\n")
+                shard_entries["data"] = write_records(
+                    self.output_dir, "data", data_sections, shard_records
+                )
+
+                if write_manifest(self.output_dir, shard_entries):
+                    self.log(f"Sharded snapshot records ({shard_records} per shard)")
 
                 data_index = {"by_name": {}}
                 for data_item in data_sections:
@@ -887,7 +977,7 @@ class BinaryArchiveExtractor:
                         data_index["by_name"][data_item["name"]] = data_item["ea"]
 
                 with open(self.output_dir / "data_index.json", "w", encoding="utf-8") as f:
-                    json.dump(data_index, f, indent=2)
+                    codec.dump(data_index, f)
 
                 summary = {
                     "functions_total": len(functions_data),
@@ -895,11 +985,21 @@ class BinaryArchiveExtractor:
                     "sections": len(sections),
                     "imports": len(imports_exports["imports"]),
                     "exports": len(imports_exports["exports"]),
-                    "call_edges": len(call_graph),
+                    "symbols": len(symbols),
+                    "call_edges": sum(1 for _ in edges.call_edges()),
                     "equates": len(equates),
                     "strings": len(strings_data),
                     "data_items": len(data_sections),
                 }
+
+                if resolve_capa_backend() == CAPA_BACKEND_GHIDRA:
+                    self.log("Running capa against the loaded Ghidra program...")
+                    capa_summary_path = self.run_capa(
+                        functions_data,
+                        GhidraCapaContext(program=program, flat_api=flat_api, monitor=monitor),
+                        sample_sha256=metadata["sha256"],
+                    )
+                    capa_ran = True
         except Exception as exc:  # pragma: no cover - depends on Ghidra runtime
             raise SnapshotError(f"Snapshot extraction failed: {exc}") from exc
         finally:
@@ -907,11 +1007,8 @@ class BinaryArchiveExtractor:
                 self.decompiler.dispose()
 
         if metadata:
-            try:
-                capa_summary_path = build_capa_summary(self.binary_path, self.output_dir)
-            except Exception as exc:  # pragma: no cover - runtime specific
-                logger.warning("capa summary generation failed: %s", exc)
-                capa_summary_path = None
+            if not capa_ran:
+                capa_summary_path = self.run_capa(functions_data, sample_sha256=metadata["sha256"])
 
             if capa_summary_path:
                 metadata.setdefault("artifacts", {})["capa_summary"] = capa_summary_path.name
@@ -932,12 +1029,13 @@ class BinaryArchiveExtractor:
         if summary:
             logger.info(
                 "Functions=%s (decompiled %s) sections=%s imports=%s exports=%s "
-                "call_edges=%s equates=%s strings=%s data_items=%s",
+                "symbols=%s call_edges=%s equates=%s strings=%s data_items=%s",
                 summary["functions_total"],
                 summary["functions_decompiled"],
                 summary["sections"],
                 summary["imports"],
                 summary["exports"],
+                summary["symbols"],
                 summary["call_edges"],
                 summary["equates"],
                 summary["strings"],
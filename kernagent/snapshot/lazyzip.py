@@ -0,0 +1,323 @@
+"""On-demand extraction of zipped snapshots.
+
+A snapshot zip holds every artifact, including one ``decomp/*.c`` file per
+function and the copied binary, but a question usually touches a handful of
+them. ``open_snapshot_zip`` validates the member names, extracts only the small
+JSON/JSONL artifacts into a local cache entry and returns that directory as the
+snapshot root. Other members (decompilation, the binary) are materialized the
+first time ``SnapshotTools``, the BM25 index or the token index read them.
+
+Cache entries live under ``KERNAGENT_SNAPSHOT_CACHE_DIR`` (default
+``~/.cache/kernagent/snapshots``), are keyed by the zip's path, size and mtime,
+and are evicted least recently used first past ``KERNAGENT_SNAPSHOT_CACHE_MAX_MB``.
+"""
+
+from __future__ import annotations
+
+import hashlib
+import json
+import os
+import shutil
+import threading
+import time
+import zipfile
+from fnmatch import fnmatchcase
+from pathlib import Path, PurePosixPath, PureWindowsPath
+from typing import Dict, List, Optional
+
+from ..log import get_logger
+from .extractor import SnapshotError
+
+logger = get_logger(__name__)
+
+LAZY_MARKER = ".kernagent-lazy.json"
+# Extracted up front: small, and read by every tool and by the oneshot pruner.
+EAGER_SUFFIXES = (".json", ".jsonl")
+DEFAULT_CACHE_MAX_BYTES = 1024 * 2**20
+# Entries opened or extended this recently may have a reader in another process.
+EVICT_GRACE_SECONDS = 60
+
+
+def default_cache_dir() -> Path:
+    env_value = os.getenv("KERNAGENT_SNAPSHOT_CACHE_DIR")
+    if env_value:
+        return Path(env_value).expanduser()
+    cache_home = Path(os.environ.get("XDG_CACHE_HOME", Path.home() / ".cache"))
+    return cache_home / "kernagent" / "snapshots"
+
+
+def cache_max_bytes_from_env() -> int:
+    value = os.getenv("KERNAGENT_SNAPSHOT_CACHE_MAX_MB", "").strip()
+    if not value:
+        return DEFAULT_CACHE_MAX_BYTES
+    try:
+        return int(float(value) * 2**20)
+    except ValueError:
+        logger.warning("Ignoring invalid KERNAGENT_SNAPSHOT_CACHE_MAX_MB=%s", value)
+        return DEFAULT_CACHE_MAX_BYTES
+
+
+def lazy_enabled() -> bool:
+    return os.getenv("KERNAGENT_SNAPSHOT_LAZY", "1").lower() not in {"0", "false", "no", "off"}
+
+
+def validate_member_name(member_name: str, dest_root: Path) -> Path:
+    """
+    Return where `member_name` lands under `dest_root`.
+
+    Raises:
+        SnapshotError: if the member is absolute or escapes dest_root.
+    """
+
+    member_path = Path(member_name)
+    if member_path.is_absolute() or member_path.drive:
+        raise SnapshotError(f"Unsafe absolute path in archive entry: {member_name}")
+
+    if PureWindowsPath(member_name).drive:
+        raise SnapshotError(f"Unsafe absolute path in archive entry: {member_name}")
+
+    if any(part == ".." for part in member_path.parts):
+        raise SnapshotError(f"Unsafe relative path in archive entry: {member_name}")
+
+    target_path = (dest_root / member_path).resolve(strict=False)
+    if not str(target_path).startswith(str(dest_root)):
+        raise SnapshotError(f"Archive entry escapes destination: {member_name}")
+    return target_path
+
+
+def _extract_member(zf: zipfile.ZipFile, name: str, target: Path) -> None:
+    # Write next to the target and rename, so a concurrent reader never sees half a file.
+    target.parent.mkdir(parents=True, exist_ok=True)
+    tmp = target.with_name(f".{target.name}.{os.getpid()}.{threading.get_ident()}.tmp")
+    try:
+        with zf.open(name) as src, tmp.open("wb") as dst:
+            shutil.copyfileobj(src, dst)
+        os.replace(tmp, target)
+    finally:
+        tmp.unlink(missing_ok=True)
+
+
+class LazyZip:
+    """Members of a snapshot zip that have not been extracted into `root` yet."""
+
+    _registry: Dict[str, Optional["LazyZip"]] = {}
+    _registry_lock = threading.Lock()
+
+    def __init__(self, root: Path, zip_path: Path, prefix: str):
+        self.root = Path(root)
+        self.zip_path = Path(zip_path)
+        self.prefix = prefix
+        self._zip: Optional[zipfile.ZipFile] = None
+        self._names: Optional[List[str]] = None
+        self._lock = threading.Lock()
+
+    @classmethod
+    def for_root(cls, root: Path) -> Optional["LazyZip"]:
+        """The LazyZip backing `root`, or None for a fully extracted snapshot."""
+
+        key = str(Path(root).resolve())
+        with cls._registry_lock:
+            if key in cls._registry:
+                return cls._registry[key]
+        lazy = None
+        marker = Path(key) / LAZY_MARKER
+        if marker.exists():
+            try:
+                data = json.loads(marker.read_text(encoding="utf-8"))
+                lazy = cls(Path(key), Path(data["zip"]), data["prefix"])
+            except (OSError, ValueError, KeyError) as exc:
+                logger.warning("Ignoring unreadable %s: %s", marker, exc)
+        with cls._registry_lock:
+            return cls._registry.setdefault(key, lazy)
+
+    def _archive(self) -> zipfile.ZipFile:
+        with self._lock:
+            if self._zip is None:
+                self._zip = zipfile.ZipFile(self.zip_path, "r")
+                self._names = [
+                    info.filename[len(self.prefix) :]
+                    for info in self._zip.infolist()
+                    if info.filename.startswith(self.prefix) and not info.is_dir()
+                ]
+            return self._zip
+
+    def names(self, directory: str = "") -> List[str]:
+        """Member paths relative to the snapshot root, optionally under `directory`."""
+
+        self._archive()
+        directory = directory.strip("/")
+        if not directory or directory == ".":
+            return list(self._names or [])
+        prefix = directory + "/"
+        return [name for name in self._names or [] if name.startswith(prefix)]
+
+    def materialize(self, relative: str) -> bool:
+        """Extract one member if it is not on disk yet; False if the zip has no such member."""
+
+        relative = PurePosixPath(relative).as_posix()
+        target = self.root / relative
+        if target.exists():
+            return True
+        zf = self._archive()
+        name = self.prefix + relative
+        try:
+            zf.getinfo(name)
+        except KeyError:
+            return False
+        _extract_member(zf, name, target)
+        try:
+            os.utime(self.root.parent)  # keeps an active entry out of _evict's reach
+        except OSError:
+            pass
+        return True
+
+    def glob(self, directory: str, pattern: str) -> List[str]:
+        """Names `Path(directory).glob(pattern)` would list once everything is extracted."""
+
+        directory = directory.strip("/")
+        base = "" if directory in {"", "."} else directory + "/"
+        pattern_parts = PurePosixPath(pattern).parts
+        matches = []
+        for name in self.names(directory):
+            parts = PurePosixPath(name[len(base) :]).parts
+            if len(parts) == len(pattern_parts) and all(map(fnmatchcase, parts, pattern_parts)):
+                matches.append(name)
+        return matches
+
+    def close(self) -> None:
+        with self._lock:
+            if self._zip is not None:
+                self._zip.close()
+                self._zip = None
+
+
+def lazy_for(root: Path) -> Optional[LazyZip]:
+    return LazyZip.for_root(root)
+
+
+def read_member_text(root: Path, relative: str) -> str:
+    """Read a snapshot member, extracting it first when `root` is lazily unpacked."""
+
+    lazy = lazy_for(root)
+    if lazy is not None:
+        lazy.materialize(relative)
+    return (Path(root) / relative).read_text(encoding="utf-8", errors="replace")
+
+
+def count_members(root: Path, directory: str, pattern: str) -> int:
+    """Files matching `pattern` in `directory`, whether or not they were extracted yet."""
+
+    lazy = lazy_for(root)
+    if lazy is not None:
+        return len(lazy.glob(directory, pattern))
+    path = Path(root) / directory
+    return len(list(path.glob(pattern))) if path.is_dir() else 0
+
+
+def _entry_size(entry: Path) -> int:
+    total = 0
+    for path in entry.rglob("*"):
+        try:
+            if path.is_file():
+                total += path.stat().st_size
+        except OSError:
+            continue
+    return total
+
+
+def _evict(cache_dir: Path, max_bytes: int, keep: Path) -> None:
+    if max_bytes <= 0:
+        return
+    entries = []
+    total = 0
+    recent = time.time() - EVICT_GRACE_SECONDS
+    for entry in cache_dir.iterdir():
+        if not entry.is_dir():
+            continue
+        size = _entry_size(entry)
+        total += size
+        mtime = entry.stat().st_mtime
+        if entry != keep and mtime < recent:
+            entries.append((mtime, size, entry))
+
+    for _mtime, size, entry in sorted(entries):
+        if total <= max_bytes:
+            break
+        shutil.rmtree(entry, ignore_errors=True)
+        with LazyZip._registry_lock:
+            for key in [key for key in LazyZip._registry if key.startswith(str(entry) + os.sep)]:
+                del LazyZip._registry[key]
+        total -= size
+
+
+def open_snapshot_zip(
+    zip_path: Path,
+    cache_dir: Optional[Path] = None,
+    max_bytes: Optional[int] = None,
+) -> Path:
+    """
+    Return a snapshot root for `zip_path` with only its JSON artifacts extracted.
+
+    Raises:
+        SnapshotError: if the zip is unreadable, holds an unsafe member name or
+            no ``<stem>/`` snapshot directory.
+    """
+
+    zip_path = Path(zip_path).resolve()
+    cache_dir = Path(cache_dir or default_cache_dir()).expanduser()
+    max_bytes = cache_max_bytes_from_env() if max_bytes is None else max_bytes
+    stat = zip_path.stat()
+    key = hashlib.sha256(f"{zip_path}\0{stat.st_size}\0{stat.st_mtime_ns}".encode()).hexdigest()[:16]
+    entry = (cache_dir / key).resolve()
+    root = entry / zip_path.stem
+    marker = root / LAZY_MARKER
+
+    if marker.exists():
+        os.utime(entry)
+        logger.info("Reusing lazily extracted snapshot %s", root)
+        return root
+
+    prefix = zip_path.stem + "/"
+    started = time.perf_counter()
+    try:
+        with zipfile.ZipFile(zip_path, "r") as zf:
+            infos = [info for info in zf.infolist() if info.filename]
+            for info in infos:
+                validate_member_name(info.filename, entry)
+            if not any(info.filename.startswith(prefix) for info in infos):
+                raise SnapshotError(f"{zip_path.name} does not contain a {prefix} snapshot directory")
+            eager = [
+                info
+                for info in infos
+                if info.filename.startswith(prefix) and not info.is_dir() and info.filename.endswith(EAGER_SUFFIXES)
+            ]
+            for info in eager:
+                _extract_member(zf, info.filename, entry / info.filename)
+    except (OSError, zipfile.BadZipFile) as exc:
+        raise SnapshotError(f"Cannot read snapshot zip {zip_path}: {exc}") from exc
+
+    root.mkdir(parents=True, exist_ok=True)
+    # Written last: an interrupted extraction is redone instead of reused.
+    marker.write_text(json.dumps({"zip": str(zip_path), "prefix": prefix}), encoding="utf-8")
+    logger.info(
+        "Extracted %d of %d members from %s in %.2fs (rest on demand)",
+        len(eager),
+        len(infos),
+        zip_path.name,
+        time.perf_counter() - started,
+    )
+    _evict(cache_dir, max_bytes, keep=entry)
+    return root
+
+
+__all__ = [
+    "LAZY_MARKER",
+    "LazyZip",
+    "count_members",
+    "default_cache_dir",
+    "lazy_enabled",
+    "lazy_for",
+    "open_snapshot_zip",
+    "read_member_text",
+    "validate_member_name",
+]
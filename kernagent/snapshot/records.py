@@ -0,0 +1,110 @@
+"""Typed, slotted records for snapshot data held in memory in bulk.
+
+Large snapshots keep tens of thousands of function summaries alive while the
+pruner scores them; plain dicts cost several times more memory per record
+than ``__slots__`` instances. The records also support ``record["key"]`` and
+``record.get("key")`` so code written against the JSON dicts keeps working.
+"""
+
+from __future__ import annotations
+
+from dataclasses import dataclass, field, fields
+from typing import Any, Dict, List, Optional
+
+
+class _RecordAccess:
+    """Dict-style access on top of slotted attributes."""
+
+    __slots__ = ()
+
+    def __getitem__(self, key: str) -> Any:
+        try:
+            return getattr(self, key)
+        except AttributeError:
+            raise KeyError(key) from None
+
+    def __setitem__(self, key: str, value: Any) -> None:
+        setattr(self, key, value)
+
+    def __contains__(self, key: str) -> bool:
+        return hasattr(self, key)
+
+    def get(self, key: str, default: Any = None) -> Any:
+        return getattr(self, key, default)
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {item.name: getattr(self, item.name) for item in fields(self)}
+
+
+@dataclass(slots=True)
+class FunctionRecord(_RecordAccess):
+    """Function summary (the functions.jsonl fields used for ranking)."""
+
+    ea: Optional[str]
+    name: Optional[str]
+    metrics: Dict[str, Any] = field(default_factory=dict)
+    xrefs_in: List[str] = field(default_factory=list)
+    xrefs_out: List[Dict[str, Any]] = field(default_factory=list)
+    ranges: List[List[str]] = field(default_factory=list)
+    section_name: Optional[str] = None
+    score: int = 0
+
+    # Fields to decode from a functions.jsonl line (see shards.decode_fields). Callers
+    # and callees come from the edge table (see edges.py), not from these lists.
+    SOURCE_FIELDS = ("ea", "name", "metrics", "ranges")
+
+    @classmethod
+    def from_dict(cls, entry: Dict[str, Any]) -> "FunctionRecord":
+        return cls(
+            ea=entry.get("ea"),
+            name=entry.get("name") or entry.get("ea"),
+            metrics=entry.get("metrics") or {},
+            xrefs_in=entry.get("xrefs_in") or [],
+            xrefs_out=entry.get("xrefs_out") or [],
+            ranges=entry.get("ranges") or [],
+        )
+
+
+@dataclass(slots=True)
+class StringRecord(_RecordAccess):
+    """One strings.jsonl entry."""
+
+    ea: Optional[str]
+    value: Optional[str]
+    length: Optional[int] = None
+    xrefs: List[Dict[str, Any]] = field(default_factory=list)
+
+    @classmethod
+    def from_dict(cls, entry: Dict[str, Any]) -> "StringRecord":
+        return cls(
+            ea=entry.get("ea"),
+            value=entry.get("value"),
+            length=entry.get("length"),
+            xrefs=entry.get("xrefs") or [],
+        )
+
+
+@dataclass(slots=True)
+class CallEdge(_RecordAccess):
+    """One call graph edge (``from``/``to`` are renamed to avoid the keyword); `count` is its number of sites."""
+
+    from_ea: Optional[str]
+    to_ea: Optional[str]
+    from_name: Optional[str] = None
+    to_name: Optional[str] = None
+    type: Optional[str] = None
+    count: int = 1
+
+    @classmethod
+    def from_dict(cls, entry: Dict[str, Any]) -> "CallEdge":
+        return cls(
+            from_ea=entry.get("from"),
+            to_ea=entry.get("to"),
+            from_name=entry.get("from_name"),
+            to_name=entry.get("to_name"),
+            type=entry.get("type"),
+            count=entry.get("count") or 1,
+        )
+
+
+__all__ = ["CallEdge", "FunctionRecord", "StringRecord"]
@@ -0,0 +1,223 @@
+"""Offline BM25 ranking of functions for free-text questions.
+
+Each function becomes one document made of its name, the names of the
+functions/imports it calls, the strings it references and the identifiers in
+its decompilation. The inverted index is built on first use and stored in the
+archive as ``bm25_index.json`` so later sessions load it instead of rescanning.
+"""
+
+from __future__ import annotations
+
+import math
+import re
+from collections import Counter, defaultdict
+from pathlib import Path
+from typing import Any, Dict, List, Optional
+
+from ..log import get_logger
+from . import codec
+from .edges import load_edge_table
+from .lazyzip import count_members, read_member_text
+from .shards import SHARD_MANIFEST, iter_records, record_paths
+
+logger = get_logger(__name__)
+
+BM25_INDEX_FILE = "bm25_index.json"
+BM25_INDEX_VERSION = 1
+BM25_K1 = 1.2
+BM25_B = 0.75
+
+# Field weights: a term in the function or callee names says more about the
+# function than the same term buried in its pseudocode.
+NAME_WEIGHT = 3
+CALLEE_WEIGHT = 2
+STRING_WEIGHT = 2
+DECOMP_WEIGHT = 1
+
+_WORD = re.compile(r"[A-Za-z_][A-Za-z0-9_]*")
+_CAMEL = re.compile(r"[A-Z]+(?=[A-Z][a-z])|[A-Z]?[a-z]+|[A-Z]+|[0-9]+")
+# Ghidra placeholder identifiers and C noise that appear in nearly every function.
+_NOISE = re.compile(
+    r"^(?:[a-z]{0,3}var\d+|local_[0-9a-f]+|param_\d+|in_\w+|extraout_\w+|"
+    r"(?:fun|dat|lab|sub|ptr|unk|switchd|cased)_[0-9a-f_]+|undefined\d*)$"
+)
+_STOPWORDS = frozenset(
+    {
+        "if", "else", "return", "while", "for", "do", "break", "continue", "goto", "switch",
+        "case", "default", "int", "uint", "char", "uchar", "void", "long", "ulong", "short",
+        "ushort", "bool", "true", "false", "null", "sizeof", "const", "unsigned", "signed",
+        "struct", "the", "and", "of", "to", "in", "is", "an", "code", "byte", "word",
+        "dword", "qword", "thunk", "ex",
+    }
+)
+
+
+def tokenize(text: Optional[str]) -> List[str]:
+    """Lower-cased word tokens, with camelCase/snake_case identifiers also split apart."""
+
+    if not text:
+        return []
+    tokens: List[str] = []
+    for word in _WORD.findall(text):
+        lowered = word.lower().strip("_")
+        if not lowered or _NOISE.match(lowered):
+            continue
+        parts = [part.lower() for part in _CAMEL.findall(word)]
+        for token in [lowered] + (parts if len(parts) > 1 else []):
+            if len(token) > 1 and token not in _STOPWORDS and not token.isdigit():
+                tokens.append(token)
+    return tokens
+
+
+def _source_signature(root: Path) -> Dict[str, Any]:
+    """Sizes of the inputs, so a rebuilt snapshot invalidates a stale index."""
+
+    signature: Dict[str, Any] = {}
+    for name in ("functions.jsonl", "strings.jsonl", SHARD_MANIFEST):
+        path = root / name
+        if path.exists():
+            signature[name] = path.stat().st_size
+    signature["decomp_files"] = count_members(root, "decomp", "*.c")
+    return signature
+
+
+class BM25Index:
+    """Inverted index over per-function documents."""
+
+    def __init__(
+        self,
+        docs: List[Dict[str, Any]],
+        postings: Dict[str, List[List[int]]],
+        signature: Optional[Dict[str, Any]] = None,
+    ):
+        self.docs = docs
+        self.postings = postings
+        self.signature = signature or {}
+        total = sum(doc["length"] for doc in docs)
+        self.avgdl = total / len(docs) if docs else 0.0
+
+    # -- construction ------------------------------------------------------------
+
+    @classmethod
+    def build(cls, root: Path) -> "BM25Index":
+        root = Path(root)
+        term_counts: List[Counter] = []
+        docs: List[Dict[str, Any]] = []
+        doc_by_name: Dict[str, int] = {}
+
+        edges = load_edge_table(root)
+        fields = ("ea", "name", "decomp_path")
+        for func in iter_records(record_paths(root, "functions"), fields=fields):
+            counts: Counter = Counter()
+            for token in tokenize(func.get("name")):
+                counts[token] += NAME_WEIGHT
+            for callee in edges.callees(func.get("ea")):
+                for token in tokenize(callee.get("name")):
+                    counts[token] += CALLEE_WEIGHT * callee["count"]
+
+            decomp_path = func.get("decomp_path")
+            if decomp_path:
+                try:
+                    code = read_member_text(root, decomp_path)
+                except OSError:
+                    code = ""
+                for token in tokenize(code):
+                    counts[token] += DECOMP_WEIGHT
+
+            doc_id = len(docs)
+            docs.append({"ea": func.get("ea"), "name": func.get("name"), "decomp_path": decomp_path})
+            term_counts.append(counts)
+            if func.get("name"):
+                doc_by_name[func["name"]] = doc_id
+
+        for entry in iter_records(record_paths(root, "strings"), fields=("value", "xrefs")):
+            tokens = tokenize(entry.get("value"))
+            if not tokens:
+                continue
+            targets = set()
+            for xref in entry.get("xrefs") or []:
+                doc_id = doc_by_name.get(xref.get("function") or "")
+                if doc_id is not None:
+                    targets.add(doc_id)
+            for doc_id in targets:
+                for token in tokens:
+                    term_counts[doc_id][token] += STRING_WEIGHT
+
+        postings: Dict[str, List[List[int]]] = defaultdict(list)
+        for doc_id, counts in enumerate(term_counts):
+            docs[doc_id]["length"] = sum(counts.values())
+            for term, weight in counts.items():
+                postings[term].append([doc_id, weight])
+
+        return cls(docs, dict(postings), _source_signature(root))
+
+    @classmethod
+    def load_or_build(cls, root: Path) -> "BM25Index":
+        """Load the persisted index if it matches the snapshot, else build and persist it."""
+
+        root = Path(root)
+        path = root / BM25_INDEX_FILE
+        signature = _source_signature(root)
+        if path.exists():
+            try:
+                with path.open("r", encoding="utf-8") as f:
+                    payload = codec.load(f)
+                if (
+                    payload.get("version") == BM25_INDEX_VERSION
+                    and payload.get("signature") == signature
+                ):
+                    return cls(payload["docs"], payload["postings"], signature)
+            except (OSError, KeyError, AttributeError, *codec.DecodeError) as exc:
+                logger.warning("Rebuilding unreadable BM25 index %s: %s", path, exc)
+
+        index = cls.build(root)
+        try:
+            with path.open("w", encoding="utf-8") as f:
+                codec.dump(
+                    {
+                        "version": BM25_INDEX_VERSION,
+                        "signature": index.signature,
+                        "docs": index.docs,
+                        "postings": index.postings,
+                    },
+                    f,
+                )
+        except OSError as exc:  # read-only archive: keep the in-memory index
+            logger.debug("Could not persist BM25 index to %s: %s", path, exc)
+        return index
+
+    # -- querying ----------------------------------------------------------------
+
+    def search(self, query: str, k: int = 10) -> List[Dict[str, Any]]:
+        terms = list(dict.fromkeys(tokenize(query)))
+        if not terms or not self.docs:
+            return []
+
+        n_docs = len(self.docs)
+        scores: Dict[int, float] = defaultdict(float)
+        matched: Dict[int, List[str]] = defaultdict(list)
+        for term in terms:
+            posting = self.postings.get(term)
+            if not posting:
+                continue
+            idf = math.log(1 + (n_docs - len(posting) + 0.5) / (len(posting) + 0.5))
+            for doc_id, tf in posting:
+                length = self.docs[doc_id]["length"] or 1
+                norm = tf + BM25_K1 * (1 - BM25_B + BM25_B * length / (self.avgdl or 1))
+                scores[doc_id] += idf * tf * (BM25_K1 + 1) / norm
+                matched[doc_id].append(term)
+
+        ranked = sorted(scores.items(), key=lambda item: (-item[1], item[0]))[:k]
+        return [
+            {
+                "ea": self.docs[doc_id]["ea"],
+                "name": self.docs[doc_id]["name"],
+                "score": round(score, 3),
+                "matched_terms": matched[doc_id],
+                "decomp_path": self.docs[doc_id].get("decomp_path"),
+            }
+            for doc_id, score in ranked
+        ]
+
+
+__all__ = ["BM25Index", "BM25_INDEX_FILE", "tokenize"]
@@ -0,0 +1,309 @@
+"""Address-range sharding for large snapshot record files.
+
+Small snapshots keep a single ``<kind>.jsonl`` per record kind. When
+KERNAGENT_SHARD_RECORDS is set and a kind has more records than that, the
+records are sorted by address and split into ``shards/<kind>/<kind>-NNNNN.jsonl``
+files, and ``shards.json`` records the address range covered by each shard:
+
+    {"version": 1, "kinds": {"functions": [{"path": ..., "start": "10001000",
+     "end": "1000ffff", "count": 20000}, ...]}}
+
+Readers go through record_paths()/iter_records() so both layouts look the same,
+and point lookups only open the shard whose range covers the address.
+"""
+
+from __future__ import annotations
+
+import bisect
+import json
+import os
+import re
+from json.decoder import scanstring
+from pathlib import Path
+from typing import Any, Callable, Dict, Iterable, Iterator, List, Optional, TypeVar
+
+from ..log import get_logger
+from . import codec
+
+logger = get_logger(__name__)
+
+SHARD_MANIFEST = "shards.json"
+SHARD_DIR = "shards"
+SHARD_MANIFEST_VERSION = 1
+SHARDED_KINDS = ("functions", "strings", "data")
+
+T = TypeVar("T")
+
+_DECODER = json.JSONDecoder()
+_WHITESPACE = re.compile(r"[ \t\n\r]*")
+_SCALAR_END = re.compile(r"[,}\]\s]")
+
+
+def resolve_shard_records() -> Optional[int]:
+    """Records per shard (KERNAGENT_SHARD_RECORDS); None keeps the flat layout."""
+
+    value = os.getenv("KERNAGENT_SHARD_RECORDS", "").strip()
+    if not value:
+        return None
+    try:
+        records = int(value)
+    except ValueError:
+        logger.warning("Ignoring invalid KERNAGENT_SHARD_RECORDS=%s", value)
+        return None
+    return records if records > 0 else None
+
+
+def _ea_key(record: Dict[str, Any]) -> Optional[int]:
+    value = record.get("ea")
+    if value is None:
+        return None
+    try:
+        return int(str(value), 16)
+    except ValueError:
+        return None
+
+
+def _write_jsonl(path: Path, records: Iterable[Dict[str, Any]]) -> None:
+    with open(path, "w", encoding="utf-8") as f:
+        for record in records:
+            f.write(codec.dumps(record) + "\n")
+
+
+def write_records(
+    output_dir: Path,
+    kind: str,
+    records: List[Dict[str, Any]],
+    shard_records: Optional[int] = None,
+) -> Optional[List[Dict[str, Any]]]:
+    """
+    Write `records` as ``<kind>.jsonl`` or, if they exceed `shard_records`, as shards.
+
+    Returns:
+        Manifest entries for the written shards, or None for the flat layout.
+    """
+
+    output_dir = Path(output_dir)
+    if not shard_records or len(records) <= shard_records:
+        _write_jsonl(output_dir / f"{kind}.jsonl", records)
+        return None
+
+    # Records without a parsable address sort last so shard ranges stay ordered.
+    ordered = sorted(
+        records,
+        key=lambda record: (_ea_key(record) is None, _ea_key(record) or 0),
+    )
+    shard_dir = output_dir / SHARD_DIR / kind
+    shard_dir.mkdir(parents=True, exist_ok=True)
+
+    chunks = [ordered[i : i + shard_records] for i in range(0, len(ordered), shard_records)]
+    entries: List[Dict[str, Any]] = []
+    for number, chunk in enumerate(chunks):
+        keys = [key for key in (_ea_key(record) for record in chunk) if key is not None]
+        relative = f"{SHARD_DIR}/{kind}/{kind}-{number:05d}.jsonl"
+        entries.append(
+            {
+                "path": relative,
+                "start": f"{min(keys):x}" if keys else None,
+                "end": f"{max(keys):x}" if keys else None,
+                "count": len(chunk),
+            }
+        )
+
+    for entry, chunk in zip(entries, chunks):
+        _write_jsonl(output_dir / entry["path"], chunk)
+
+    return entries
+
+
+def write_manifest(output_dir: Path, kinds: Dict[str, Optional[List[Dict[str, Any]]]]) -> Optional[Path]:
+    """Write shards.json for every kind that was sharded; no-op for flat snapshots."""
+
+    sharded = {kind: entries for kind, entries in kinds.items() if entries}
+    if not sharded:
+        return None
+
+    path = Path(output_dir) / SHARD_MANIFEST
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump({"version": SHARD_MANIFEST_VERSION, "kinds": sharded}, f, indent=2)
+    return path
+
+
+def load_manifest(root: Path) -> Dict[str, List[Dict[str, Any]]]:
+    """Return {kind: [shard entries]} from shards.json, or {} for flat snapshots."""
+
+    path = Path(root) / SHARD_MANIFEST
+    if not path.exists():
+        return {}
+    try:
+        with path.open("r", encoding="utf-8") as f:
+            manifest = json.load(f)
+    except (OSError, ValueError) as exc:
+        logger.warning("Ignoring unreadable shard manifest %s: %s", path, exc)
+        return {}
+    kinds = manifest.get("kinds") if isinstance(manifest, dict) else None
+    return kinds if isinstance(kinds, dict) else {}
+
+
+def _shard_for_ea(entries: List[Dict[str, Any]], ea: int) -> List[Dict[str, Any]]:
+    ranged = [entry for entry in entries if entry.get("start") is not None]
+    starts = [int(entry["start"], 16) for entry in ranged]
+    position = bisect.bisect_right(starts, ea) - 1
+    if position >= 0 and ea <= int(ranged[position]["end"], 16):
+        return [ranged[position]]
+    return []
+
+
+def record_paths(
+    root: Path,
+    kind: str,
+    manifest: Optional[Dict[str, List[Dict[str, Any]]]] = None,
+    ea: Optional[int] = None,
+) -> List[Path]:
+    """
+    Files holding records of `kind`, in address order.
+
+    Args:
+        manifest: Preloaded load_manifest() result (read from disk when omitted).
+        ea: Restrict to the shard whose range covers this address.
+
+    Returns:
+        Shard paths, ``[<kind>.jsonl]`` for flat snapshots, or [] if missing.
+    """
+
+    root = Path(root)
+    if manifest is None:
+        manifest = load_manifest(root)
+
+    entries = manifest.get(kind)
+    if entries:
+        if ea is not None:
+            entries = _shard_for_ea(entries, ea)
+        return [root / entry["path"] for entry in entries]
+
+    flat = root / f"{kind}.jsonl"
+    return [flat] if flat.exists() else []
+
+
+def _skip_value(line: str, pos: int) -> int:
+    char = line[pos]
+    if char == '"':
+        return scanstring(line, pos + 1)[1]
+    if char in "[{":
+        # The C decoder is faster at finding the end of a container than any
+        # pure-Python bracket scan, even though it builds (and drops) the value.
+        return _DECODER.raw_decode(line, pos)[1]
+    match = _SCALAR_END.search(line, pos)
+    return match.start() if match else len(line)
+
+
+def decode_fields(line: str, fields: Iterable[str]) -> Dict[str, Any]:
+    """
+    Decode only `fields` from one JSONL record line.
+
+    Top-level keys are walked in order and scanning stops as soon as every
+    requested field has been seen, so fields written ahead of the bulky
+    ``insn``/``bb`` lists never touch them. If a field only appears in the
+    back half of the line, a full codec.loads is cheaper and is used instead.
+    """
+
+    wanted = set(fields)
+    half = len(line) // 2
+    for field in wanted:
+        position = line.find(f'"{field}":')
+        if position < 0 or position > half:
+            record = codec.loads(line)
+            return {key: record[key] for key in wanted if key in record}
+
+    result: Dict[str, Any] = {}
+    pos = _WHITESPACE.match(line, 0).end()
+    if line[pos] != "{":
+        raise ValueError("record is not a JSON object")
+    pos += 1
+    while wanted:
+        pos = _WHITESPACE.match(line, pos).end()
+        if line[pos] == "}":
+            break
+        key, pos = scanstring(line, pos + 1)
+        pos = _WHITESPACE.match(line, pos).end() + 1  # ':'
+        pos = _WHITESPACE.match(line, pos).end()
+        if key in wanted:
+            result[key], pos = _DECODER.raw_decode(line, pos)
+            wanted.discard(key)
+        else:
+            pos = _skip_value(line, pos)
+        pos = _WHITESPACE.match(line, pos).end()
+        if line[pos] == ",":
+            pos += 1
+    return result
+
+
+def iter_jsonl(
+    path: Path,
+    fields: Optional[Iterable[str]] = None,
+    contains: Optional[str] = None,
+) -> Iterator[Dict[str, Any]]:
+    """
+    Stream records from one JSONL file.
+
+    Args:
+        fields: Decode only these top-level fields (see decode_fields).
+        contains: Skip lines that do not contain this raw substring before
+            decoding anything (a cheap prefilter; callers still check the
+            decoded value).
+    """
+
+    fields = list(fields) if fields is not None else None
+    with path.open("r", encoding="utf-8") as f:
+        for line in f:
+            if not line.strip():
+                continue
+            if contains is not None and contains not in line:
+                continue
+            yield decode_fields(line, fields) if fields is not None else codec.loads(line)
+
+
+def iter_records(
+    paths: Iterable[Path],
+    fields: Optional[Iterable[str]] = None,
+    contains: Optional[str] = None,
+) -> Iterator[Dict[str, Any]]:
+    """Stream records from each path in turn (arguments as for iter_jsonl)."""
+
+    fields = list(fields) if fields is not None else None
+    for path in paths:
+        yield from iter_jsonl(path, fields, contains)
+
+
+def map_records(
+    paths: List[Path],
+    transform: Callable[[Dict[str, Any]], Optional[T]],
+    fields: Optional[Iterable[str]] = None,
+) -> List[T]:
+    """
+    Apply `transform` to every record, shard by shard, preserving order.
+
+    Records for which `transform` returns None are dropped; `fields` limits
+    decoding as for iter_jsonl. Decoding is CPU-bound and holds the GIL, so
+    shards are read one after another rather than on a thread pool.
+    """
+
+    results: List[T] = []
+    for record in iter_records(paths, fields):
+        value = transform(record)
+        if value is not None:
+            results.append(value)
+    return results
+
+
+__all__ = [
+    "SHARD_MANIFEST",
+    "SHARDED_KINDS",
+    "decode_fields",
+    "iter_records",
+    "load_manifest",
+    "map_records",
+    "record_paths",
+    "resolve_shard_records",
+    "write_manifest",
+    "write_records",
+]
@@ -0,0 +1,189 @@
+"""Token-cost estimates for snapshot content.
+
+The estimator is an approximation chosen with KERNAGENT_TOKENIZER:
+
+- ``chars`` (default) or ``chars:<ratio>``: characters / ratio (default 4)
+- ``words``: one token per identifier, number or punctuation run, which
+  tracks BPE tokenizers closely on C code
+- ``tiktoken`` or ``tiktoken:<encoding>``: exact counts when tiktoken is installed
+
+Per-function estimates are written by the extractor (``tokens`` in
+functions.jsonl) and, for older snapshots, computed once and stored in the
+archive as ``token_index.json``.
+"""
+
+from __future__ import annotations
+
+import json
+import os
+import re
+from functools import lru_cache
+from pathlib import Path
+from typing import Any, Callable, Dict, Optional
+
+from ..log import get_logger
+from . import codec
+from .shards import SHARD_MANIFEST, iter_records, record_paths
+
+logger = get_logger(__name__)
+
+TOKEN_INDEX_FILE = "token_index.json"
+TOKEN_INDEX_VERSION = 1
+DEFAULT_CHARS_PER_TOKEN = 4.0
+
+_WORD_PIECES = re.compile(r"[A-Za-z_]\w*|\d+|[^\w\s]+")
+
+
+@lru_cache(maxsize=None)
+def _estimator(spec: str) -> Callable[[str], int]:
+    kind, _, arg = spec.partition(":")
+    if kind == "words":
+        return lambda text: len(_WORD_PIECES.findall(text))
+    if kind == "tiktoken":
+        try:  # pragma: no cover - optional dependency
+            import tiktoken
+
+            encoding = tiktoken.get_encoding(arg or "cl100k_base")
+            return lambda text: len(encoding.encode(text, disallowed_special=()))
+        except Exception as exc:  # pragma: no cover - optional dependency
+            logger.warning("tiktoken unavailable (%s); using character estimate", exc)
+    elif kind != "chars":
+        logger.warning("Unknown KERNAGENT_TOKENIZER=%s; using character estimate", spec)
+
+    try:
+        ratio = float(arg) if kind == "chars" and arg else DEFAULT_CHARS_PER_TOKEN
+    except ValueError:
+        ratio = DEFAULT_CHARS_PER_TOKEN
+    return lambda text: int((len(text) + ratio - 1) // ratio)
+
+
+def tokenizer_spec() -> str:
+    return os.getenv("KERNAGENT_TOKENIZER", "").strip().lower() or "chars"
+
+
+def estimate_tokens(text: Optional[str]) -> int:
+    """Estimated token count of `text` under the configured tokenizer."""
+
+    if not text:
+        return 0
+    return _estimator(tokenizer_spec())(text)
+
+
+def function_token_estimates(decompiled_code: Optional[str], insn: Any) -> Dict[str, int]:
+    """Per-function estimates stored in functions.jsonl and token_index.json."""
+
+    from .decomp_format import normalize_decompilation
+
+    estimates = {"insn": estimate_tokens(json.dumps(insn, separators=(",", ":"))) if insn else 0}
+    if decompiled_code:
+        estimates["decomp"] = estimate_tokens(decompiled_code)
+        estimates["decomp_normalized"] = estimate_tokens(normalize_decompilation(decompiled_code))
+    return estimates
+
+
+def _source_signature(root: Path) -> Dict[str, Any]:
+    from .decomp_format import NORMALIZER_VERSION
+
+    signature: Dict[str, Any] = {"tokenizer": tokenizer_spec(), "normalizer": NORMALIZER_VERSION}
+    for name in ("functions.jsonl", SHARD_MANIFEST):
+        path = root / name
+        if path.exists():
+            signature[name] = path.stat().st_size
+    return signature
+
+
+def _build_index(root: Path) -> Dict[str, Dict[str, int]]:
+    from .lazyzip import read_member_text  # imports the extractor, which imports this module
+
+    estimates: Dict[str, Dict[str, int]] = {}
+    for func in iter_records(record_paths(root, "functions"), fields=("ea", "decomp_path", "tokens", "insn")):
+        ea = func.get("ea")
+        if not ea:
+            continue
+        stored = func.get("tokens")
+        if stored and stored.get("tokenizer", "chars") == tokenizer_spec():
+            estimates[ea] = {key: value for key, value in stored.items() if key != "tokenizer"}
+            continue
+
+        code = None
+        decomp_path = func.get("decomp_path")
+        if decomp_path:
+            try:
+                code = read_member_text(root, decomp_path)
+            except OSError:
+                code = None
+        estimates[ea] = function_token_estimates(code, func.get("insn"))
+    return estimates
+
+
+def load_token_index(root: Path) -> Dict[str, Dict[str, int]]:
+    """EA -> token estimates; built and persisted on first use."""
+
+    root = Path(root)
+    path = root / TOKEN_INDEX_FILE
+    signature = _source_signature(root)
+    if path.exists():
+        try:
+            with path.open("r", encoding="utf-8") as f:
+                payload = codec.load(f)
+            if payload.get("version") == TOKEN_INDEX_VERSION and payload.get("signature") == signature:
+                return payload["functions"]
+        except (OSError, KeyError, AttributeError, *codec.DecodeError) as exc:
+            logger.warning("Rebuilding unreadable token index %s: %s", path, exc)
+
+    estimates = _build_index(root)
+    try:
+        with path.open("w", encoding="utf-8") as f:
+            codec.dump({"version": TOKEN_INDEX_VERSION, "signature": signature, "functions": estimates}, f)
+    except OSError as exc:  # read-only archive: keep the in-memory index
+        logger.debug("Could not persist token index to %s: %s", path, exc)
+    return estimates
+
+
+class TokenBudget:
+    """Tokens of tool output a session may still spend on code reads."""
+
+    def __init__(self, limit: int = 0, per_read: int = 0):
+        self.limit = max(0, limit)  # 0 = unlimited
+        self.per_read = max(0, per_read)  # 0 = only bounded by the session limit
+        self.used = 0
+
+    @classmethod
+    def from_env(cls) -> "TokenBudget":
+        def read(name: str, default: int) -> int:
+            value = os.getenv(name, "").strip()
+            try:
+                return int(value) if value else default
+            except ValueError:
+                logger.warning("Ignoring invalid %s=%s", name, value)
+                return default
+
+        return cls(read("KERNAGENT_TOKEN_BUDGET", 0), read("KERNAGENT_READ_TOKEN_LIMIT", 6000))
+
+    @property
+    def remaining(self) -> Optional[int]:
+        return None if not self.limit else max(0, self.limit - self.used)
+
+    def allowance(self, requested: Optional[int] = None) -> Optional[int]:
+        """Largest read allowed now (None = unbounded)."""
+
+        caps = [cap for cap in (self.per_read, self.remaining, requested) if cap]
+        if self.remaining == 0:
+            return 0
+        return min(caps) if caps else None
+
+    def charge(self, tokens: int) -> None:
+        self.used += tokens
+
+    def status(self) -> Dict[str, Any]:
+        return {"used": self.used, "limit": self.limit or None, "remaining": self.remaining}
+
+
+__all__ = [
+    "TOKEN_INDEX_FILE",
+    "TokenBudget",
+    "estimate_tokens",
+    "function_token_estimates",
+    "load_token_index",
+    "tokenizer_spec",
+]
@@ -2,15 +2,73 @@
 
 from __future__ import annotations
 
+import copy
 import json
+import os
 import re
+import threading
 from pathlib import Path
 from typing import Any, Dict, List, Optional, Tuple
 
+from ..deadline import cancelled
 from ..log import get_logger
+from . import codec
+from .decomp_format import estimate_tokens, normalize_decompilation, rename_map
+from .decomp_slice import outline_decompilation, slice_decompilation
+from .edges import EdgeTable, load_edge_table
+from .lazyzip import LAZY_MARKER, lazy_for
+from .retrieval import BM25Index
+from .shards import iter_records, load_manifest, record_paths
+from .tokens import TokenBudget, load_token_index
 
 logger = get_logger(__name__)
 
+try:  # Python 3.11+
+    from re import _constants as _sre_constants, _parser as _sre_parser
+except ImportError:  # pragma: no cover - Python < 3.11
+    import sre_constants as _sre_constants
+    import sre_parse as _sre_parser
+
+_REPEATS = {_sre_constants.MAX_REPEAT, _sre_constants.MIN_REPEAT}
+
+
+def _has_nested_unbounded_repeat(items: Any, inside: bool = False) -> bool:
+    """True if an unbounded repeat sits inside another one, as in ``(a+)+`` or ``(\\w+\\s?)*``."""
+
+    for op, av in items:
+        if op in _REPEATS:
+            unbounded = av[1] == _sre_constants.MAXREPEAT
+            if unbounded and inside:
+                return True
+            if _has_nested_unbounded_repeat(av[2], inside or unbounded):
+                return True
+        elif op is _sre_constants.SUBPATTERN:
+            if _has_nested_unbounded_repeat(av[-1], inside):
+                return True
+        elif op is _sre_constants.BRANCH:
+            if any(_has_nested_unbounded_repeat(branch, inside) for branch in av[1]):
+                return True
+        elif op in (_sre_constants.ASSERT, _sre_constants.ASSERT_NOT):
+            if _has_nested_unbounded_repeat(av[1], inside):
+                return True
+    return False
+
+
+def compile_search_pattern(pattern: str, flags: int = 0) -> "re.Pattern[str]":
+    """
+    Compile a model-supplied regex, rejecting nested unbounded quantifiers.
+
+    ``re`` holds the GIL for a whole match, so a catastrophically backtracking
+    pattern cannot be interrupted by the tool deadline; it is refused instead.
+
+    Raises:
+        re.error: if the pattern is invalid or could backtrack catastrophically.
+    """
+
+    if _has_nested_unbounded_repeat(_sre_parser.parse(pattern, flags)):
+        raise re.error("nested quantifiers such as (a+)+ can backtrack catastrophically; simplify the pattern")
+    return re.compile(pattern, flags)
+
 
 class SnapshotTools:
     """Read-only helpers for navigating snapshot artifacts."""
@@ -25,7 +83,34 @@ class SnapshotTools:
         self._cache: Dict[str, Any] = {
             "function_lookup": None,
             "decomp_index": None,
+            "shard_manifest": None,
+            "bm25": None,
+            "decomp_normalized": {},
+            "token_index": None,
+            "edges": None,
+            "edge_lookup": None,
         }
+        # Tools may run on prefetch threads (see kernagent/prefetch.py). In-memory
+        # caches tolerate a duplicate build; builds that write sidecars take this lock.
+        self._build_lock = threading.Lock()
+        # Per-session allowance for code returned by the read_decompilation* tools.
+        self.budget = TokenBudget.from_env()
+        # Ghidra C is rewritten into a shorter form unless disabled or requested raw.
+        self.normalize_decomp = os.getenv("KERNAGENT_DECOMP_NORMALIZE", "1").lower() not in {
+            "0",
+            "false",
+            "no",
+            "off",
+        }
+        # Set when the snapshot came from a zip: members are extracted on first access.
+        self._lazy = lazy_for(self.root)
+
+    def fork(self) -> "SnapshotTools":
+        """Tools sharing this instance's caches with a fresh token budget."""
+
+        forked = copy.copy(self)
+        forked.budget = TokenBudget.from_env()
+        return forked
 
     # -- helpers -----------------------------------------------------------------
 
@@ -33,6 +118,8 @@ class SnapshotTools:
         path = (self.root / relative).resolve()
         if not str(path).startswith(str(self.root)):
             raise ValueError("Access outside the snapshot root is not allowed")
+        if self._lazy is not None and path != self.root:
+            self._lazy.materialize(path.relative_to(self.root).as_posix())
         return path
 
     @staticmethod
@@ -70,6 +157,34 @@ class SnapshotTools:
             return len(value) > 0
         return True
 
+    @staticmethod
+    def _projection(fields: Optional[Any], *always: str) -> Optional[List[str]]:
+        """Normalize a `fields` tool argument (list or comma-separated string)."""
+        if fields is None:
+            return None
+        if isinstance(fields, str):
+            fields = fields.split(",")
+        requested = [str(field).strip() for field in fields if str(field).strip()]
+        if not requested:
+            return None
+        return list(dict.fromkeys([*always, *requested]))
+
+    @staticmethod
+    def _partial(result: Dict[str, Any]) -> Dict[str, Any]:
+        """Flag `result` as cut short by the tool-call deadline (see kernagent/deadline.py)."""
+
+        result["truncated"] = True
+        result["timed_out"] = True
+        return result
+
+    @staticmethod
+    def _truncate_insn(func: Dict[str, Any]) -> Dict[str, Any]:
+        if "insn" in func and len(func.get("insn") or []) > 50:
+            func["insn"] = func["insn"][:50] + [
+                {"note": "... truncated, use search_by_instruction for specific instructions"}
+            ]
+        return func
+
     @staticmethod
     def _call_type_label(raw_type: Optional[str]) -> str:
         mapping = {
@@ -85,6 +200,15 @@ class SnapshotTools:
 
     # -- cache helpers -----------------------------------------------------------
 
+    def _record_paths(self, kind: str, ea: Optional[Any] = None) -> List[Path]:
+        """Record files for `kind` (flat or sharded); `ea` narrows to one shard."""
+
+        manifest = self._cache.get("shard_manifest")
+        if manifest is None:
+            manifest = load_manifest(self.root)
+            self._cache["shard_manifest"] = manifest
+        return record_paths(self.root, kind, manifest, ea=self._ea_to_int(ea))
+
     def _function_lookup(self) -> Dict[str, str]:
         cached = self._cache.get("function_lookup")
         if cached is not None:
@@ -107,82 +231,89 @@ class SnapshotTools:
             return cached
 
         index: Dict[str, Dict[str, Optional[str]]] = {}
-        path = self.root / "functions.jsonl"
-        if path.exists():
-            with path.open() as f:
-                for line in f:
-                    if not line.strip():
-                        continue
-                    entry = json.loads(line)
-                    decomp_path = entry.get("decomp_path")
-                    if not decomp_path or not decomp_path.startswith("decomp/"):
-                        continue
-                    index[decomp_path] = {
-                        "function_name": entry.get("name"),
-                        "ea": self._normalize_ea(entry.get("ea")),
-                    }
+        paths = self._record_paths("functions")
+        if paths:
+            for entry in iter_records(paths, fields=("ea", "name", "decomp_path")):
+                decomp_path = entry.get("decomp_path")
+                if not decomp_path or not decomp_path.startswith("decomp/"):
+                    continue
+                index[decomp_path] = {
+                    "function_name": entry.get("name"),
+                    "ea": self._normalize_ea(entry.get("ea")),
+                }
 
         self._cache["decomp_index"] = index
         return index
 
-    def _get_function_entry(self, target_ea: Optional[str]) -> Optional[Dict[str, Any]]:
-        if not target_ea:
-            return None
-        path = self.root / "functions.jsonl"
-        if not path.exists():
-            return None
-
-        normalized = self._normalize_ea(target_ea)
-        if normalized is None:
-            return None
-
-        with path.open() as f:
-            for line in f:
-                if not line.strip():
-                    continue
-                entry = json.loads(line)
-                if self._normalize_ea(entry.get("ea")) == normalized:
-                    return entry
-        return None
+    def _edge_table(self) -> EdgeTable:
+        cached = self._cache.get("edges")
+        if cached is None:
+            with self._build_lock:
+                cached = self._cache.get("edges")
+                if cached is None:
+                    cached = load_edge_table(self.root, self._cache.get("shard_manifest"))
+                    self._cache["edges"] = cached
+        return cached
+
+    def _edge_nodes(self, target_ea: Optional[str], target_name_lower: Optional[str]) -> List[int]:
+        """Edge-table nodes whose normalized address or lowercased name matches the target."""
+
+        table = self._edge_table()
+        lookup = self._cache.get("edge_lookup")
+        if lookup is None:
+            lookup = {}
+            for node, (ea, name) in enumerate(zip(table.eas, table.names)):
+                lookup.setdefault(("ea", self._normalize_ea(ea) or ea), []).append(node)
+                if name:
+                    lookup.setdefault(("name", name.lower()), []).append(node)
+            self._cache["edge_lookup"] = lookup
+        nodes = lookup.get(("ea", target_ea), []) if target_ea else []
+        if target_name_lower:
+            nodes = nodes + [node for node in lookup.get(("name", target_name_lower), []) if node not in nodes]
+        return nodes
+
+    def _attach_edges(self, func: Dict[str, Any], keys: Optional[List[str]] = None) -> Dict[str, Any]:
+        """Fill xrefs_out/xrefs_in (all of them, or those in `keys`) from the edge table."""
+
+        wanted = [key for key in ("xrefs_in", "xrefs_out") if keys is None or key in keys]
+        if wanted and func.get("ea"):
+            table = self._edge_table()
+            if "xrefs_in" in wanted:
+                func["xrefs_in"] = table.callers(func["ea"])
+            if "xrefs_out" in wanted:
+                func["xrefs_out"] = table.callees(func["ea"])
+        return func
 
     def _get_data_entry(self, target_ea: Optional[str]) -> Optional[Dict[str, Any]]:
         if not target_ea:
             return None
-        path = self.root / "data.jsonl"
-        if not path.exists():
-            return None
-
         normalized = self._normalize_ea(target_ea)
         if normalized is None:
             return None
 
-        with path.open() as f:
-            for line in f:
-                if not line.strip():
-                    continue
-                entry = json.loads(line)
-                if self._normalize_ea(entry.get("ea")) == normalized:
-                    return entry
+        paths = self._record_paths("data", normalized)
+        if not paths:
+            return None
+
+        for entry in iter_records(paths):
+            if self._normalize_ea(entry.get("ea")) == normalized:
+                return entry
         return None
 
     def _get_string_entry(self, target_ea: Optional[str]) -> Optional[Dict[str, Any]]:
         if not target_ea:
             return None
-        path = self.root / "strings.jsonl"
-        if not path.exists():
-            return None
-
         normalized = self._normalize_ea(target_ea)
         if normalized is None:
             return None
 
-        with path.open() as f:
-            for line in f:
-                if not line.strip():
-                    continue
-                entry = json.loads(line)
-                if self._normalize_ea(entry.get("ea")) == normalized:
-                    return entry
+        paths = self._record_paths("strings", normalized)
+        if not paths:
+            return None
+
+        for entry in iter_records(paths):
+            if self._normalize_ea(entry.get("ea")) == normalized:
+                return entry
         return None
 
     # -- artifact readers --------------------------------------------------------
@@ -191,10 +322,10 @@ class SnapshotTools:
         try:
             path = self._resolve(filepath)
             with path.open() as f:
-                return json.load(f)
+                return codec.load(f)
         except FileNotFoundError:
             return {"error": f"File not found: {filepath}"}
-        except (json.JSONDecodeError, ValueError) as exc:
+        except codec.DecodeError as exc:
             return {"error": f"Invalid JSON in {filepath}: {exc}"}
         except ValueError as exc:
             return {"error": str(exc)}
@@ -208,15 +339,20 @@ class SnapshotTools:
 
         try:
             with path.open() as f:
-                return json.load(f)
-        except (json.JSONDecodeError, ValueError) as exc:
+                return codec.load(f)
+        except codec.DecodeError as exc:
             return {"error": f"Invalid JSON in capa_summary.json: {exc}"}
 
     def list_files(self, directory: str = ".", pattern: str = "*") -> Dict[str, Any]:
         try:
             root = self._resolve(".")
             path = self._resolve(directory)
-            files = [f for f in path.glob(pattern) if f.is_file()]
+            files = [f for f in path.glob(pattern) if f.is_file() and f.name != LAZY_MARKER]
+            if self._lazy is not None:
+                # Unextracted members are listed too; listing does not extract them.
+                listed = set(files)
+                directory_rel = path.relative_to(root).as_posix()
+                files.extend(root / name for name in self._lazy.glob(directory_rel, pattern) if root / name not in listed)
             return {
                 "files": [str(f.relative_to(root)) for f in files],
                 "count": len(files),
@@ -232,33 +368,29 @@ class SnapshotTools:
             "large_functions": [],
         }
 
-        path = self.root / "functions.jsonl"
-        if not path.exists():
+        paths = self._record_paths("functions")
+        if not paths:
             return {"error": "functions.jsonl not found"}
 
         try:
-            with path.open() as f:
-                for line in f:
-                    if not line.strip():
-                        continue
-                    func = json.loads(line)
-                    stats["total"] += 1
+            for func in iter_records(paths, fields=("ea", "name", "metrics", "decomp_path")):
+                stats["total"] += 1
 
-                    if func.get("decomp_path"):
-                        stats["with_decomp"] += 1
+                if func.get("decomp_path"):
+                    stats["with_decomp"] += 1
 
-                    metrics = func.get("metrics", {})
-                    complexity = metrics.get("cyclomatic_complexity", 0)
-                    if complexity > 20:
-                        stats["high_complexity"].append(
-                            {"name": func["name"], "ea": func["ea"], "complexity": complexity}
-                        )
+                metrics = func.get("metrics", {})
+                complexity = metrics.get("cyclomatic_complexity", 0)
+                if complexity > 20:
+                    stats["high_complexity"].append(
+                        {"name": func["name"], "ea": func["ea"], "complexity": complexity}
+                    )
 
-                    size = metrics.get("size_bytes", 0)
-                    if size > 1000:
-                        stats["large_functions"].append(
-                            {"name": func["name"], "ea": func["ea"], "size": size}
-                        )
+                size = metrics.get("size_bytes", 0)
+                if size > 1000:
+                    stats["large_functions"].append(
+                        {"name": func["name"], "ea": func["ea"], "size": size}
+                    )
 
             stats["high_complexity"] = sorted(
                 stats["high_complexity"], key=lambda x: x["complexity"], reverse=True
@@ -271,7 +403,7 @@ class SnapshotTools:
         except Exception as exc:
             return {"error": str(exc)}
 
-    def get_function(self, identifier: str) -> Dict[str, Any]:
+    def get_function(self, identifier: str, fields: Optional[List[str]] = None) -> Dict[str, Any]:
         index = self.read_json("index.json")
         if "error" in index:
             return index
@@ -283,32 +415,71 @@ class SnapshotTools:
         else:
             return {"error": f"Function '{identifier}' not found in index"}
 
-        path = self.root / "functions.jsonl"
-        if not path.exists():
+        paths = self._record_paths("functions", target_ea)
+        if not paths:
             return {"error": "functions.jsonl not found"}
 
+        projection = self._projection(fields, "ea", "name")
         try:
-            with path.open() as f:
-                for line in f:
-                    if not line.strip():
-                        continue
-                    func = json.loads(line)
-                    if func["ea"] == target_ea:
-                        if "insn" in func and len(func.get("insn", [])) > 50:
-                            func["insn"] = func["insn"][:50] + [
-                                {
-                                    "note": "... truncated, use search_by_instruction for specific instructions"
-                                }
-                            ]
-                        return func
+            for func in iter_records(
+                paths, fields=projection, contains=json.dumps(target_ea)
+            ):
+                if func.get("ea") == target_ea:
+                    if not func.get("tokens") and (projection is None or "tokens" in projection):
+                        func["tokens"] = self._token_estimates().get(target_ea)
+                    return self._truncate_insn(self._attach_edges(func, projection))
 
             return {"error": f"Function at {target_ea} not found in functions.jsonl"}
         except Exception as exc:
             return {"error": str(exc)}
 
-    def read_decompilation(self, decomp_path: str) -> Dict[str, Any]:
+    def read_decompilation(
+        self, decomp_path: str, normalize: Optional[bool] = None, max_tokens: Optional[int] = None
+    ) -> Dict[str, Any]:
+        result = self._load_decompilation(decomp_path, normalize)
+        if "error" in result:
+            return result
+
+        tokens = result.get("tokens") or estimate_tokens(result["code"])
+        allowance = self.budget.allowance(max_tokens)
+        if allowance == 0:
+            return {
+                "error": "Session token budget exhausted; answer from the evidence gathered so far",
+                "budget": self.budget.status(),
+            }
+        if allowance is not None and tokens > allowance:
+            # Too large for this read: return the control-flow skeleton instead.
+            outline = outline_decompilation(result["code"], allowance, estimate_tokens)
+            result.update(
+                code=outline["code"],
+                lines=outline["lines"],
+                mode="outline",
+                tokens=estimate_tokens(outline["code"]),
+                tokens_full=tokens,
+                hint=(
+                    "Function exceeds the read allowance; nested blocks are folded. Use "
+                    "read_decompilation_slice(function, anchor) for the part you need."
+                ),
+            )
+            tokens = result["tokens"]
+
+        self.budget.charge(tokens)
+        if self.budget.limit:
+            result["budget"] = self.budget.status()
+        return result
+
+    def warm_decompilation(self, decomp_path: str, normalize: Optional[bool] = None, **_: Any) -> None:
+        """Load `decomp_path` into the cache without charging the token budget."""
+
+        self._load_decompilation(decomp_path, normalize)
+
+    def _load_decompilation(self, decomp_path: str, normalize: Optional[bool] = None) -> Dict[str, Any]:
         try:
             path = self._resolve(decomp_path)
+            if normalize is None:
+                normalize = self.normalize_decomp
+            if normalize:
+                return {"path": decomp_path, **self._normalized_decompilation(path)}
             with path.open() as f:
                 code = f.read()
             return {"path": decomp_path, "code": code, "lines": len(code.splitlines())}
@@ -319,6 +490,124 @@ class SnapshotTools:
         except Exception as exc:
             return {"error": str(exc)}
 
+    def _token_estimates(self) -> Dict[str, Dict[str, int]]:
+        cached = self._cache.get("token_index")
+        if cached is None:
+            with self._build_lock:
+                cached = self._cache.get("token_index")
+                if cached is None:
+                    cached = load_token_index(self.root)
+                    self._cache["token_index"] = cached
+        return cached
+
+    def _decomp_tokens(self, ea: Optional[str]) -> Optional[int]:
+        """Estimated cost of read_decompilation for the function at `ea`."""
+
+        estimates = self._token_estimates().get(ea) or {}
+        key = "decomp_normalized" if self.normalize_decomp else "decomp"
+        return estimates.get(key, estimates.get("decomp"))
+
+    def _normalized_decompilation(self, path: Path) -> Dict[str, Any]:
+        """Normalized code plus token savings, cached per file until it changes."""
+
+        stat = path.stat()
+        cache = self._cache["decomp_normalized"]
+        key = (stat.st_mtime_ns, stat.st_size)
+        cached = cache.get(path)
+        if cached and cached[0] == key:
+            return dict(cached[1])
+
+        with path.open() as f:
+            raw = f.read()
+        code = normalize_decompilation(raw)
+        result = {
+            "code": code,
+            "lines": len(code.splitlines()),
+            "normalized": True,
+            "tokens": estimate_tokens(code),
+            "tokens_saved": estimate_tokens(raw) - estimate_tokens(code),
+        }
+        cache[path] = (key, result)
+        return dict(result)
+
+    def _find_decomp_path(self, function: str) -> Optional[str]:
+        """decomp_path for a function given by name, EA or decomp path."""
+
+        if function.startswith("decomp/"):
+            return function
+        index = self._decomp_index()
+        target_ea = self._normalize_ea(function)
+        for decomp_path, info in index.items():
+            if info.get("function_name") == function:
+                return decomp_path
+        if target_ea:
+            for decomp_path, info in index.items():
+                if info.get("ea") == target_ea:
+                    return decomp_path
+        return None
+
+    def _anchor_patterns(self, anchor: str) -> List[re.Pattern]:
+        """Regexes locating `anchor` (identifier, address or string text) in C code."""
+
+        patterns: List[re.Pattern] = []
+        if re.fullmatch(r"[A-Za-z_]\w*", anchor):
+            patterns.append(re.compile(rf"\b{re.escape(anchor)}\b"))
+
+        address = self._normalize_ea(anchor) if re.fullmatch(r"(?:0x)?[0-9A-Fa-f]{4,16}", anchor) else None
+        addresses = [address] if address else []
+        if not addresses and not patterns:
+            patterns.append(re.compile(re.escape(anchor)))
+            # String text: also match references to the strings that contain it.
+            for entry in iter_records(
+                self._record_paths("strings"), fields=("ea", "value"), contains=anchor[:32]
+            ):
+                if anchor in (entry.get("value") or ""):
+                    normalized = self._normalize_ea(entry.get("ea"))
+                    if normalized:
+                        addresses.append(normalized)
+        if addresses:
+            alternatives = "|".join(re.escape(ea.lstrip("0") or "0") for ea in addresses[:20])
+            patterns.append(re.compile(rf"(?i)\b(?:0x|\w*_)?0*(?:{alternatives})\b"))
+        return patterns
+
+    def read_decompilation_slice(
+        self, function: str, anchor: str, normalize: Optional[bool] = None
+    ) -> Dict[str, Any]:
+        if not function or not anchor:
+            return {"error": "function and anchor are required"}
+
+        decomp_path = self._find_decomp_path(function)
+        if not decomp_path:
+            return {"error": f"No decompilation found for function: {function}"}
+
+        full = self._load_decompilation(decomp_path, normalize=normalize)
+        if "error" in full:
+            return full
+
+        if full.get("normalized") and re.fullmatch(r"[A-Za-z_]\w*", anchor):
+            # Anchors copied from raw output (e.g. uVar1) are renamed in normalized code.
+            raw = self._load_decompilation(decomp_path, normalize=False)
+            anchor = rename_map(raw.get("code", "")).get(anchor, anchor)
+
+        for pattern in self._anchor_patterns(anchor):
+            sliced = slice_decompilation(full["code"], pattern)
+            if sliced is None:
+                continue
+            result = {
+                "path": decomp_path,
+                "function_name": self._decomp_index().get(decomp_path, {}).get("function_name"),
+                "anchor": anchor,
+                **sliced,
+                "tokens": estimate_tokens(sliced["code"]),
+                "tokens_full": estimate_tokens(full["code"]),
+            }
+            self.budget.charge(result["tokens"])
+            if self.budget.limit:
+                result["budget"] = self.budget.status()
+            return result
+
+        return {"error": f"Anchor {anchor!r} not found in {decomp_path}", "path": decomp_path}
+
     def search_functions(
         self,
         name_pattern: Optional[str] = None,
@@ -328,13 +617,14 @@ class SnapshotTools:
         callers_of: Optional[str] = None,
         callees_of: Optional[str] = None,
         limit: int = 50,
+        fields: Optional[List[str]] = None,
     ) -> Dict[str, Any]:
         index = self.read_json("index.json")
         if "error" in index:
             return index
 
-        path = self.root / "functions.jsonl"
-        if not path.exists():
+        paths = self._record_paths("functions")
+        if not paths:
             return {"error": "functions.jsonl not found"}
 
         def resolve_identifier(identifier: str) -> str:
@@ -347,102 +637,139 @@ class SnapshotTools:
         target_called_ea = resolve_identifier(callers_of) if callers_of else None
         target_caller_ea = resolve_identifier(callees_of) if callees_of else None
 
+        projection = self._projection(fields, "ea", "name")
+        decoded = [
+            key
+            for key in dict.fromkeys(["ea", "name", "prototype", "metrics", "decomp_path"] + (projection or []))
+            if key not in {"xrefs_in", "xrefs_out"}
+        ]
+        edges = self._edge_table()
+        # Functions that call `callers_of`, and functions referenced by `callees_of`.
+        calling_target = None
+        if target_called_ea:
+            calling_target = {e.from_ea for e in edges.incoming(edges.node_id(target_called_ea), flow_only=True)}
+        called_by_target = None
+        if target_caller_ea:
+            called_by_target = {e.to_ea for e in edges.outgoing(edges.node_id(target_caller_ea), flow_only=False)}
+
         results = []
+        timed_out = False
         try:
-            with path.open() as f:
-                for line in f:
-                    if not line.strip():
-                        continue
-                    func = json.loads(line)
+            for func in iter_records(paths, fields=decoded):
+                if cancelled():
+                    timed_out = True
+                    break
+                if name_pattern and name_pattern.lower() not in func["name"].lower():
+                    continue
 
-                    if name_pattern and name_pattern.lower() not in func["name"].lower():
-                        continue
+                metrics = func.get("metrics", {})
+                if min_complexity and metrics.get("cyclomatic_complexity", 0) < min_complexity:
+                    continue
 
-                    metrics = func.get("metrics", {})
-                    if min_complexity and metrics.get("cyclomatic_complexity", 0) < min_complexity:
-                        continue
+                if min_size and metrics.get("size_bytes", 0) < min_size:
+                    continue
 
-                    if min_size and metrics.get("size_bytes", 0) < min_size:
+                if has_decomp is not None:
+                    if has_decomp and not func.get("decomp_path"):
+                        continue
+                    if not has_decomp and func.get("decomp_path"):
                         continue
 
-                    if has_decomp is not None:
-                        if has_decomp and not func.get("decomp_path"):
-                            continue
-                        if not has_decomp and func.get("decomp_path"):
-                            continue
-
-                    if target_called_ea:
-                        callees = [x.get("ea") for x in func.get("xrefs_out", [])]
-                        if target_called_ea not in callees:
-                            continue
+                if calling_target is not None and func["ea"] not in calling_target:
+                    continue
 
-                    if target_caller_ea:
-                        if target_caller_ea not in func.get("xrefs_in", []):
-                            continue
+                if called_by_target is not None and func["ea"] not in called_by_target:
+                    continue
 
+                if projection:
+                    self._attach_edges(func, projection)
                     results.append(
-                        {
-                            "ea": func["ea"],
-                            "name": func["name"],
-                            "prototype": func.get("prototype"),
-                            "metrics": metrics,
-                            "decomp_path": func.get("decomp_path"),
-                            "xrefs_in_count": len(func.get("xrefs_in", [])),
-                            "xrefs_out_count": len(func.get("xrefs_out", [])),
-                        }
+                        self._truncate_insn({key: func[key] for key in projection if key in func})
                     )
-
                     if len(results) >= limit:
                         break
+                    continue
+
+                results.append(
+                    {
+                        "ea": func["ea"],
+                        "name": func["name"],
+                        "prototype": func.get("prototype"),
+                        "metrics": metrics,
+                        "decomp_path": func.get("decomp_path"),
+                        "decomp_tokens": self._decomp_tokens(func["ea"]),
+                        "xrefs_in_count": len(edges.callers(func["ea"])),
+                        "xrefs_out_count": edges.call_sites(func["ea"]),
+                    }
+                )
+
+                if len(results) >= limit:
+                    break
 
-            return {"results": results, "count": len(results), "limited": len(results) >= limit}
+            result = {"results": results, "count": len(results), "limited": len(results) >= limit}
+            return self._partial(result) if timed_out else result
         except Exception as exc:
             return {"error": str(exc)}
 
     def search_strings(
-        self, pattern: str, case_sensitive: bool = False, limit: int = 50
+        self,
+        pattern: str,
+        case_sensitive: bool = False,
+        limit: int = 50,
+        fields: Optional[List[str]] = None,
     ) -> Dict[str, Any]:
-        path = self.root / "strings.jsonl"
-        if not path.exists():
+        paths = self._record_paths("strings")
+        if not paths:
             return {"error": "strings.jsonl not found"}
 
         results = []
         pattern_cmp = pattern if case_sensitive else pattern.lower()
+        projection = self._projection(fields, "ea")
 
-        try:
-            with path.open() as f:
-                for line in f:
-                    if not line.strip():
-                        continue
-                    string_obj = json.loads(line)
-                    value = string_obj.get("value", "")
-                    value_cmp = value if case_sensitive else value.lower()
-
-                    if pattern_cmp in value_cmp:
-                        xrefs = string_obj.get("xrefs", [])
-                        xref_functions = []
-                        for xref in xrefs[:10]:
-                            xref_functions.append(
-                                {
-                                    "from_address": xref.get("from"),
-                                    "function": xref.get("function") or "unknown",
-                                }
-                            )
+        # Printable ASCII without quotes/backslashes is serialized verbatim, so a
+        # matching record must contain the pattern in its raw line.
+        raw_filter = None
+        if case_sensitive and pattern.isascii() and pattern.isprintable():
+            if '"' not in pattern and "\\" not in pattern:
+                raw_filter = pattern
 
-                        results.append(
+        timed_out = False
+        try:
+            for string_obj in iter_records(paths, contains=raw_filter):
+                if cancelled():
+                    timed_out = True
+                    break
+                value = string_obj.get("value", "")
+                value_cmp = value if case_sensitive else value.lower()
+
+                if pattern_cmp in value_cmp and projection:
+                    results.append({key: string_obj[key] for key in projection if key in string_obj})
+                elif pattern_cmp in value_cmp:
+                    xrefs = string_obj.get("xrefs", [])
+                    xref_functions = []
+                    for xref in xrefs[:10]:
+                        xref_functions.append(
                             {
-                                "address": string_obj.get("ea"),
-                                "value": value[:200],
-                                "length": string_obj.get("length"),
-                                "xref_count": len(xrefs),
-                                "xref_functions": xref_functions,
+                                "from_address": xref.get("from"),
+                                "function": xref.get("function") or "unknown",
                             }
                         )
 
-                    if len(results) >= limit:
-                        break
+                    results.append(
+                        {
+                            "address": string_obj.get("ea"),
+                            "value": value[:200],
+                            "length": string_obj.get("length"),
+                            "xref_count": len(xrefs),
+                            "xref_functions": xref_functions,
+                        }
+                    )
+
+                if len(results) >= limit:
+                    break
 
-            return {"results": results, "count": len(results)}
+            result = {"results": results, "count": len(results)}
+            return self._partial(result) if timed_out else result
         except Exception as exc:
             return {"error": str(exc)}
 
@@ -491,18 +818,14 @@ class SnapshotTools:
         if direction not in {"down", "up"}:
             return {"error": "direction must be 'down' or 'up'"}
 
-        path = self.root / "functions.jsonl"
-        if not path.exists():
+        if not self._record_paths("functions"):
             return {"error": "functions.jsonl not found"}
 
+        timed_out = False
+        # Only functions are traced; imports and other references end a branch.
+        function_eas = index.get("by_ea") or None
         try:
-            with path.open() as f:
-                functions = {}
-                for line in f:
-                    if not line.strip():
-                        continue
-                    func = json.loads(line)
-                    functions[func["ea"]] = func
+            edges = self._edge_table()
         except Exception as exc:
             return {"error": str(exc)}
 
@@ -511,7 +834,7 @@ class SnapshotTools:
         truncated = False
 
         def trace_recursive(ea: str, depth: int):
-            nonlocal node_count, truncated
+            nonlocal node_count, truncated, timed_out
 
             if depth > max_depth or ea in visited:
                 return None
@@ -520,21 +843,26 @@ class SnapshotTools:
                 truncated = True
                 return None
 
-            func = functions.get(ea)
-            if not func:
+            if cancelled():
+                timed_out = True
+                return None
+
+            if function_eas is not None and ea not in function_eas:
                 return None
 
             visited.add(ea)
             node_count += 1
 
-            node = {"ea": ea, "name": func.get("name"), "depth": depth}
+            node_id = edges.node_id(ea)
+            name = edges.names[node_id] if node_id is not None else None
+            node = {"ea": ea, "name": name or self._function_lookup().get(self._normalize_ea(ea) or "", ea), "depth": depth}
 
             if direction == "down":
                 child_key = "calls"
-                child_targets = [xref.get("ea") for xref in func.get("xrefs_out", [])[:10]]
+                child_targets = [edge.to_ea for edge in edges.outgoing(node_id)[:10]]
             else:
                 child_key = "called_by"
-                child_targets = func.get("xrefs_in", [])[:10]
+                child_targets = edges.callers(ea)[:10]
 
             children = []
             for child_ea in child_targets:
@@ -554,10 +882,14 @@ class SnapshotTools:
 
         result = trace_recursive(start_ea, 0)
         if not result:
+            if timed_out:
+                return self._partial({"error": "Call trace did not finish before the tool deadline"})
             return {"error": "Could not trace calls"}
 
         if truncated:
             result["truncated"] = True
+        if timed_out:
+            self._partial(result)
 
         return result
 
@@ -658,55 +990,55 @@ class SnapshotTools:
     def search_by_instruction(
         self, mnemonic: str, operand_pattern: Optional[str] = None, limit: int = 20
     ) -> Dict[str, Any]:
-        path = self.root / "functions.jsonl"
-        if not path.exists():
+        paths = self._record_paths("functions")
+        if not paths:
             return {"error": "functions.jsonl not found"}
 
         results = []
         mnemonic_lower = mnemonic.lower()
         operand_lower = operand_pattern.lower() if operand_pattern else None
 
+        timed_out = False
         try:
-            with path.open() as f:
-                for line in f:
-                    if not line.strip():
+            for func in iter_records(paths):
+                if cancelled():
+                    timed_out = True
+                    break
+                matching_insns = []
+                for insn in func.get("insn", []):
+                    if insn.get("mnem", "").lower() != mnemonic_lower:
                         continue
-                    func = json.loads(line)
-
-                    matching_insns = []
-                    for insn in func.get("insn", []):
-                        if insn.get("mnem", "").lower() != mnemonic_lower:
+                    if operand_lower:
+                        opstr = insn.get("opstr", "").lower()
+                        if operand_lower not in opstr:
                             continue
-                        if operand_lower:
-                            opstr = insn.get("opstr", "").lower()
-                            if operand_lower not in opstr:
-                                continue
-                        matching_insns.append(
-                            {
-                                "address": insn.get("ea"),
-                                "mnemonic": insn.get("mnem"),
-                                "operands": insn.get("opstr"),
-                                "bytes": insn.get("bytes"),
-                            }
-                        )
+                    matching_insns.append(
+                        {
+                            "address": insn.get("ea"),
+                            "mnemonic": insn.get("mnem"),
+                            "operands": insn.get("opstr"),
+                            "bytes": insn.get("bytes"),
+                        }
+                    )
 
-                    if matching_insns:
-                        results.append(
-                            {
-                                "function": {
-                                    "name": func["name"],
-                                    "ea": func["ea"],
-                                    "prototype": func.get("prototype"),
-                                },
-                                "instruction_matches": len(matching_insns),
-                                "sample_instructions": matching_insns[:5],
-                            }
-                        )
+                if matching_insns:
+                    results.append(
+                        {
+                            "function": {
+                                "name": func["name"],
+                                "ea": func["ea"],
+                                "prototype": func.get("prototype"),
+                            },
+                            "instruction_matches": len(matching_insns),
+                            "sample_instructions": matching_insns[:5],
+                        }
+                    )
 
-                    if len(results) >= limit:
-                        break
+                if len(results) >= limit:
+                    break
 
-            return {"results": results, "count": len(results), "limited": len(results) >= limit}
+            result = {"results": results, "count": len(results), "limited": len(results) >= limit}
+            return self._partial(result) if timed_out else result
         except Exception as exc:
             return {"error": str(exc)}
 
@@ -720,6 +1052,7 @@ class SnapshotTools:
         has_value: Optional[bool] = None,
         limit: int = 50,
         offset: int = 0,
+        fields: Optional[List[str]] = None,
     ) -> Dict[str, Any]:
         if limit <= 0:
             return {"error": "limit must be greater than 0"}
@@ -739,81 +1072,87 @@ class SnapshotTools:
 
         name_cmp = name_pattern.lower() if name_pattern else None
         type_cmp = type_pattern.lower() if type_pattern else None
+        projection = self._projection(fields, "ea")
 
-        path = self.root / "data.jsonl"
-        if not path.exists():
+        paths = self._record_paths("data")
+        if not paths:
             return {"error": "data.jsonl not found"}
 
         results: List[Dict[str, Any]] = []
         total_matches = 0
 
+        timed_out = False
         try:
-            with path.open() as f:
-                for line in f:
-                    if not line.strip():
-                        continue
-                    entry = json.loads(line)
-
-                    entry_name = entry.get("name") or ""
-                    entry_type = entry.get("type") or ""
-                    entry_ea = self._normalize_ea(entry.get("ea")) or entry.get("ea")
-                    entry_length = entry.get("length")
-                    entry_value = entry.get("value")
-                    entry_has_value = self._has_value_field(entry_value)
+            for entry in iter_records(paths):
+                if cancelled():
+                    timed_out = True
+                    break
+                entry_name = entry.get("name") or ""
+                entry_type = entry.get("type") or ""
+                entry_ea = self._normalize_ea(entry.get("ea")) or entry.get("ea")
+                entry_length = entry.get("length")
+                entry_value = entry.get("value")
+                entry_has_value = self._has_value_field(entry_value)
+
+                if name_cmp and name_cmp not in entry_name.lower():
+                    continue
 
-                    if name_cmp and name_cmp not in entry_name.lower():
-                        continue
+                if type_cmp and type_cmp not in entry_type.lower():
+                    continue
 
-                    if type_cmp and type_cmp not in entry_type.lower():
+                if start_addr is not None:
+                    ea_int = self._ea_to_int(entry_ea)
+                    if ea_int is None or not (start_addr <= ea_int <= end_addr):
                         continue
 
-                    if start_addr is not None:
-                        ea_int = self._ea_to_int(entry_ea)
-                        if ea_int is None or not (start_addr <= ea_int <= end_addr):
-                            continue
+                if (
+                    min_length is not None
+                    and entry_length is not None
+                    and entry_length < min_length
+                ):
+                    continue
 
-                    if (
-                        min_length is not None
-                        and entry_length is not None
-                        and entry_length < min_length
-                    ):
-                        continue
+                if (
+                    max_length is not None
+                    and entry_length is not None
+                    and entry_length > max_length
+                ):
+                    continue
 
-                    if (
-                        max_length is not None
-                        and entry_length is not None
-                        and entry_length > max_length
-                    ):
-                        continue
+                if has_value and not entry_has_value:
+                    continue
 
-                    if has_value and not entry_has_value:
-                        continue
+                total_matches += 1
+                if total_matches <= offset:
+                    continue
 
-                    total_matches += 1
-                    if total_matches <= offset:
-                        continue
+                if projection:
+                    results.append({key: entry[key] for key in projection if key in entry})
+                    if len(results) >= limit:
+                        break
+                    continue
 
-                    summary = {
-                        "ea": entry_ea,
-                        "name": entry_name or None,
-                        "type": entry_type or None,
-                        "length": entry_length,
-                        "section": entry.get("section"),
-                        "has_value": entry_has_value,
-                    }
+                summary = {
+                    "ea": entry_ea,
+                    "name": entry_name or None,
+                    "type": entry_type or None,
+                    "length": entry_length,
+                    "section": entry.get("section"),
+                    "has_value": entry_has_value,
+                }
 
-                    if entry_has_value:
-                        summary["value_preview"] = str(entry_value)[:160]
+                if entry_has_value:
+                    summary["value_preview"] = str(entry_value)[:160]
 
-                    results.append(summary)
+                results.append(summary)
 
-                    if len(results) >= limit:
-                        break
+                if len(results) >= limit:
+                    break
 
             available = max(0, total_matches - offset)
             truncated = available > len(results)
 
-            return {
+            result = {
                 "results": results,
                 "count": len(results),
                 "total_matches": total_matches,
@@ -821,6 +1160,7 @@ class SnapshotTools:
                 "limit": limit,
                 "truncated": truncated,
             }
+            return self._partial(result) if timed_out else result
         except Exception as exc:
             return {"error": str(exc)}
 
@@ -861,19 +1201,15 @@ class SnapshotTools:
             return None
 
         # Functions
-        path = self.root / "functions.jsonl"
-        if path.exists():
+        paths = self._record_paths("functions")
+        if paths:
             try:
-                with path.open() as f:
-                    for line in f:
-                        if not line.strip():
-                            continue
-                        entry = json.loads(line)
-                        name = entry.get("name")
-                        ea = self._normalize_ea(entry.get("ea"))
-                        priority = match_priority(name, ea, 0)
-                        if priority is not None:
-                            add_candidate(priority, "function", name, ea)
+                for entry in iter_records(paths, fields=("ea", "name")):
+                    name = entry.get("name")
+                    ea = self._normalize_ea(entry.get("ea"))
+                    priority = match_priority(name, ea, 0)
+                    if priority is not None:
+                        add_candidate(priority, "function", name, ea)
             except Exception:
                 pass
 
@@ -891,39 +1227,37 @@ class SnapshotTools:
                         add_candidate(priority, kind, name, ea)
 
         # Data
-        path = self.root / "data.jsonl"
-        if path.exists():
+        paths = self._record_paths("data")
+        if paths:
             try:
-                with path.open() as f:
-                    for line in f:
-                        if not line.strip():
-                            continue
-                        entry = json.loads(line)
-                        name = entry.get("name")
-                        ea = self._normalize_ea(entry.get("ea"))
-                        priority = match_priority(name, ea, 20)
-                        if priority is not None:
-                            label = name or (ea and f"DATA_{ea}") or None
-                            add_candidate(priority, "data", label, ea)
+                for entry in iter_records(paths):
+                    name = entry.get("name")
+                    ea = self._normalize_ea(entry.get("ea"))
+                    priority = match_priority(name, ea, 20)
+                    if priority is not None:
+                        label = name or (ea and f"DATA_{ea}") or None
+                        add_candidate(priority, "data", label, ea)
             except Exception:
                 pass
 
+        # Full symbol table (exact name lookup via symbols_index.json)
+        symbols_index = self.read_json("symbols_index.json")
+        if isinstance(symbols_index, dict):
+            for ea in (symbols_index.get("by_name") or {}).get(query, []):
+                add_candidate(25, "symbol", query, ea)
+
         # Strings (match by EA only)
         if normalized_query_ea:
-            path = self.root / "strings.jsonl"
-            if path.exists():
+            paths = self._record_paths("strings", normalized_query_ea)
+            if paths:
                 try:
-                    with path.open() as f:
-                        for line in f:
-                            if not line.strip():
-                                continue
-                            entry = json.loads(line)
-                            ea = self._normalize_ea(entry.get("ea"))
-                            if ea == normalized_query_ea:
-                                value = entry.get("name") or entry.get("value")
-                                label = value[:80] if isinstance(value, str) else value
-                                add_candidate(30, "string", label, ea)
-                                break
+                    for entry in iter_records(paths):
+                        ea = self._normalize_ea(entry.get("ea"))
+                        if ea == normalized_query_ea:
+                            value = entry.get("name") or entry.get("value")
+                            label = value[:80] if isinstance(value, str) else value
+                            add_candidate(30, "string", label, ea)
+                            break
                 except Exception:
                     pass
 
@@ -993,6 +1327,7 @@ class SnapshotTools:
         func_lookup = self._function_lookup()
         target_label = target_name or target_ea
         target_name_lower = target_name.lower() if isinstance(target_name, str) else None
+        timed_out = False
 
         def add_xref(entry: Dict[str, Any]):
             key = (
@@ -1008,140 +1343,94 @@ class SnapshotTools:
             seen.add(key)
             xrefs.append(entry)
 
-        def matches_target(name: Optional[str], ea: Optional[str]) -> bool:
-            norm_ea = self._normalize_ea(ea)
-            if target_ea and norm_ea == target_ea:
-                return True
-            if target_name_lower and name and name.lower() == target_name_lower:
-                return True
-            return False
-
-        # Callgraph edges
+        # Code references between functions (edges.json)
         if need_code and (need_to or need_from):
-            path = self.root / "callgraph.jsonl"
-            if path.exists():
-                try:
-                    with path.open() as f:
-                        for line in f:
-                            if not line.strip():
-                                continue
-                            edge = json.loads(line)
-                            from_ea = self._normalize_ea(edge.get("from"))
-                            to_ea = self._normalize_ea(edge.get("to"))
-                            call_type = self._call_type_label(edge.get("type"))
-
-                            if need_to and matches_target(edge.get("to_name"), to_ea or edge.get("to")):
-                                add_xref(
-                                    {
-                                        "direction": "to",
-                                        "kind": "code",
-                                        "type": call_type,
-                                        "from_ea": from_ea or edge.get("from"),
-                                        "from_function": edge.get("from_name")
-                                        or func_lookup.get(from_ea or "", from_ea),
-                                        "to_ea": target_ea or to_ea or edge.get("to"),
-                                        "to_name": target_name or edge.get("to_name"),
-                                    }
-                                )
-
-                            if need_from and matches_target(edge.get("from_name"), from_ea or edge.get("from")):
-                                add_xref(
-                                    {
-                                        "direction": "from",
-                                        "kind": "code",
-                                        "type": call_type,
-                                        "from_ea": target_ea or from_ea or edge.get("from"),
-                                        "from_function": target_name,
-                                        "to_ea": to_ea or edge.get("to"),
-                                        "to_name": edge.get("to_name"),
-                                    }
-                                )
-                except Exception:
-                    pass
-
-        # Function-local xrefs
-        if target_kind == "function" and need_code:
-            func_entry = self._get_function_entry(target_ea)
-            if func_entry:
-                if need_to:
-                    for caller in func_entry.get("xrefs_in", []):
-                        caller_ea = self._normalize_ea(caller)
-                        add_xref(
-                            {
-                                "direction": "to",
-                                "kind": "code",
-                                "type": "call",
-                                "from_ea": caller_ea or caller,
-                                "from_function": func_lookup.get(caller_ea or "", caller_ea),
-                                "to_ea": target_ea,
-                                "to_name": target_name,
-                            }
-                        )
-                if need_from:
-                    for callee in func_entry.get("xrefs_out", []):
-                        callee_ea = self._normalize_ea(callee.get("ea"))
-                        add_xref(
-                            {
-                                "direction": "from",
-                                "kind": "code",
-                                "type": self._call_type_label(callee.get("type")),
-                                "from_ea": target_ea,
-                                "from_function": target_name,
-                                "to_ea": callee_ea or callee.get("ea"),
-                                "to_name": callee.get("name"),
-                            }
-                        )
+            try:
+                edges = self._edge_table()
+                for node in self._edge_nodes(target_ea, target_name_lower):
+                    if cancelled():
+                        timed_out = True
+                        break
+                    if need_to:
+                        for edge in edges.incoming(node):
+                            from_ea = self._normalize_ea(edge.from_ea)
+                            add_xref(
+                                {
+                                    "direction": "to",
+                                    "kind": "code",
+                                    "type": self._call_type_label(edge.type),
+                                    "from_ea": from_ea or edge.from_ea,
+                                    "from_function": edge.from_name or func_lookup.get(from_ea or "", from_ea),
+                                    "to_ea": target_ea or self._normalize_ea(edge.to_ea) or edge.to_ea,
+                                    "to_name": target_name or edge.to_name,
+                                    "sites": edge.count,
+                                }
+                            )
+                    if need_from:
+                        for edge in edges.outgoing(node, flow_only=False):
+                            to_ea = self._normalize_ea(edge.to_ea)
+                            add_xref(
+                                {
+                                    "direction": "from",
+                                    "kind": "code",
+                                    "type": self._call_type_label(edge.type),
+                                    "from_ea": target_ea or self._normalize_ea(edge.from_ea) or edge.from_ea,
+                                    "from_function": target_name,
+                                    "to_ea": to_ea or edge.to_ea,
+                                    "to_name": edge.to_name,
+                                    "sites": edge.count,
+                                }
+                            )
+            except Exception:
+                pass
 
         # Target function referencing data/strings
-        if target_kind == "function" and need_from and need_data:
-            for filename, entry_kind in (("strings.jsonl", "string"), ("data.jsonl", "data")):
-                path = self.root / filename
-                if not path.exists():
-                    continue
+        if target_kind == "function" and need_from and need_data and not timed_out:
+            for record_kind, entry_kind in (("strings", "string"), ("data", "data")):
+                paths = self._record_paths(record_kind)
                 try:
-                    with path.open() as f:
-                        for line in f:
-                            if not line.strip():
-                                continue
-                            entry = json.loads(line)
-                            xrefs_list = entry.get("xrefs") or []
-                            if not isinstance(xrefs_list, list):
+                    for entry in iter_records(paths):
+                        if cancelled():
+                            timed_out = True
+                            break
+                        xrefs_list = entry.get("xrefs") or []
+                        if not isinstance(xrefs_list, list):
+                            continue
+                        entry_ea = self._normalize_ea(entry.get("ea")) or entry.get("ea")
+                        entry_label = entry.get("name")
+                        if not entry_label:
+                            if entry_kind == "string":
+                                value = entry.get("value")
+                                entry_label = value[:80] if isinstance(value, str) else value
+                            else:
+                                entry_label = entry_ea and f"DATA_{entry_ea}" or "data_item"
+
+                        for xref in xrefs_list:
+                            from_ea = self._normalize_ea(xref.get("from"))
+                            function_name = xref.get("function")
+                            match = False
+                            if target_ea and from_ea == target_ea:
+                                match = True
+                            elif target_name_lower and function_name and function_name.lower() == target_name_lower:
+                                match = True
+                            if not match:
                                 continue
-                            entry_ea = self._normalize_ea(entry.get("ea")) or entry.get("ea")
-                            entry_label = entry.get("name")
-                            if not entry_label:
-                                if entry_kind == "string":
-                                    value = entry.get("value")
-                                    entry_label = value[:80] if isinstance(value, str) else value
-                                else:
-                                    entry_label = entry_ea and f"DATA_{entry_ea}" or "data_item"
-
-                            for xref in xrefs_list:
-                                from_ea = self._normalize_ea(xref.get("from"))
-                                function_name = xref.get("function")
-                                match = False
-                                if target_ea and from_ea == target_ea:
-                                    match = True
-                                elif target_name_lower and function_name and function_name.lower() == target_name_lower:
-                                    match = True
-                                if not match:
-                                    continue
-
-                                entry_type = xref.get("type") or (
-                                    "string_ref" if entry_kind == "string" else "data_ref"
-                                )
-                                add_xref(
-                                    {
-                                        "direction": "from",
-                                        "kind": "data",
-                                        "type": entry_type,
-                                        "from_ea": target_ea or from_ea,
-                                        "from_function": target_label,
-                                        "to_ea": entry_ea,
-                                        "to_name": entry_label,
-                                        "xref_address": from_ea or xref.get("from"),
-                                    }
-                                )
+
+                            entry_type = xref.get("type") or (
+                                "string_ref" if entry_kind == "string" else "data_ref"
+                            )
+                            add_xref(
+                                {
+                                    "direction": "from",
+                                    "kind": "data",
+                                    "type": entry_type,
+                                    "from_ea": target_ea or from_ea,
+                                    "from_function": target_label,
+                                    "to_ea": entry_ea,
+                                    "to_name": entry_label,
+                                    "xref_address": from_ea or xref.get("from"),
+                                }
+                            )
                 except Exception:
                     continue
 
@@ -1184,7 +1473,7 @@ class SnapshotTools:
         result["xrefs"] = paginated
         result["total_matches"] = total
         result["truncated"] = truncated
-        return result
+        return self._partial(result) if timed_out else result
 
     def search_decomp(
         self,
@@ -1205,7 +1494,7 @@ class SnapshotTools:
 
         flags = 0 if case_sensitive else re.IGNORECASE
         try:
-            regex = re.compile(pattern, flags)
+            regex = compile_search_pattern(pattern, flags)
         except re.error as exc:
             return {"error": f"Invalid pattern: {exc}"}
 
@@ -1222,13 +1511,20 @@ class SnapshotTools:
         matches: List[Dict[str, Any]] = []
         total_found = 0
         truncated = False
+        timed_out = False
 
         for decomp_path, info in sorted(index.items()):
+            if cancelled():
+                timed_out = True
+                break
             recorded_for_file = 0
-            file_path = self.root / decomp_path
             try:
+                file_path = self._resolve(decomp_path)
                 with file_path.open() as f:
                     for line_no, line in enumerate(f, start=1):
+                        if cancelled():
+                            timed_out = True
+                            break
                         if regex.search(line):
                             total_found += 1
                             if total_found <= offset:
@@ -1252,21 +1548,53 @@ class SnapshotTools:
                             if len(matches) >= limit:
                                 truncated = True
                                 break
-                if truncated:
+                if truncated or timed_out:
                     break
-            except FileNotFoundError:
+            except (FileNotFoundError, ValueError):
                 continue
 
         available = max(0, total_found - offset)
         truncated = truncated or available > len(matches)
 
-        return {
+        result = {
             "matches": matches,
             "count": len(matches),
             "offset": offset,
             "limit": limit,
             "truncated": truncated,
         }
+        return self._partial(result) if timed_out else result
+
+    def find_relevant(self, query: str, k: int = 10) -> Dict[str, Any]:
+        """Rank functions against a free-text query with BM25 (index built on first use)."""
+
+        query = (query or "").strip()
+        if not query:
+            return {"error": "query is required"}
+        if k <= 0:
+            return {"error": "k must be greater than 0"}
+
+        index = self._cache.get("bm25")
+        if index is None:
+            if not self._record_paths("functions"):
+                return {"error": "functions.jsonl not found"}
+            with self._build_lock:
+                index = self._cache.get("bm25")
+                if index is None:
+                    try:
+                        index = BM25Index.load_or_build(self.root)
+                    except Exception as exc:
+                        return {"error": f"Could not build relevance index: {exc}"}
+                    self._cache["bm25"] = index
+
+        results = index.search(query, min(k, 50))
+        return {"query": query, "results": results, "count": len(results)}
+
+
+def build_prefetch_warmers(snapshot: SnapshotTools) -> Dict[str, Any]:
+    """Cache warmers for tools the agent must not call speculatively."""
+
+    return {"read_decompilation": snapshot.warm_decompilation}
 
 
 def build_tool_map(snapshot: SnapshotTools) -> Dict[str, Any]:
@@ -1279,6 +1607,7 @@ def build_tool_map(snapshot: SnapshotTools) -> Dict[str, Any]:
         "search_functions": snapshot.search_functions,
         "get_function": snapshot.get_function,
         "read_decompilation": snapshot.read_decompilation,
+        "read_decompilation_slice": snapshot.read_decompilation_slice,
         "search_strings": snapshot.search_strings,
         "search_imports_exports": snapshot.search_imports_exports,
         "trace_calls": snapshot.trace_calls,
@@ -1290,4 +1619,5 @@ def build_tool_map(snapshot: SnapshotTools) -> Dict[str, Any]:
         "get_xrefs": snapshot.get_xrefs,
         "search_decomp": snapshot.search_decomp,
         "get_capa_summary": snapshot.get_capa_summary,
+        "find_relevant": snapshot.find_relevant,
     }
@@ -0,0 +1,179 @@
+"""Query-aware tool subsets and compact tool schemas for the agent loop.
+
+Sending every tool schema on every iteration costs thousands of prompt tokens
+that small local models prefill slowly. The agent instead starts from a core
+set plus the tools whose keywords appear in the question, keeps a
+``request_tools`` meta-tool so the model can ask for more, and sends schemas
+with descriptions trimmed to their first sentence.
+"""
+
+from __future__ import annotations
+
+import copy
+import json
+import re
+from typing import Any, Dict, Iterable, List, Optional, Sequence, Set
+
+REQUEST_TOOLS_NAME = "request_tools"
+
+# Always exposed: enough to locate and read code for any question.
+CORE_TOOLS = (
+    "find_relevant",
+    "search_functions",
+    "get_function",
+    "read_decompilation",
+    "search_strings",
+    "search_imports_exports",
+    "get_xrefs",
+)
+
+# Extra tools, exposed when one of their keywords appears in the question.
+TOOL_KEYWORDS: Dict[str, Sequence[str]] = {
+    "get_capa_summary": (
+        "capa", "capabilit", "att&ck", "attack", "mitre", "mbc", "technique", "behavio",
+        "malware", "malicious", "what does", "overview", "summar",
+    ),
+    "get_function_stats": ("overview", "stats", "statistic", "complex", "large", "biggest", "what does", "summar"),
+    "trace_calls": ("call", "flow", "path", "reach", "trace", "entry", "main", "chain"),
+    "search_by_instruction": (
+        "instruction", "opcode", "syscall", "cpuid", "rdtsc", "int 2e", "asm", "assembly",
+        "anti-debug", "anti-vm", "xor",
+    ),
+    "search_data": ("config", "buffer", "table", "global", "data", "resource", "struct", "key", "embedded"),
+    "search_equates": ("constant", "equate", "magic", "enum", "flag"),
+    "get_memory_section": ("section", "segment", "packed", "packer", "entropy", "permission", "rwx", "overlay"),
+    "read_decompilation_slice": (
+        "slice", "where", "how is", "how does", "used", "argument", "parameter", "passed", "call to",
+        "large", "buffer", "key",
+    ),
+    "search_decomp": ("decomp", "pseudocode", "source", "regex", "pattern", "loop"),
+    "read_json": ("meta", "hash", "sha", "md5", "compiler", "arch", "format", "import", "export"),
+    "list_files": ("file", "artifact", "list"),
+    "resolve_symbol": ("address", "0x", "symbol", "label"),
+}
+
+REQUEST_TOOLS_SPEC: Dict[str, Any] = {
+    "type": "function",
+    "function": {
+        "name": REQUEST_TOOLS_NAME,
+        "description": "Enable more analysis tools for this session.",
+        "parameters": {
+            "type": "object",
+            "properties": {
+                "names": {
+                    "type": "array",
+                    "items": {"type": "string"},
+                    "description": "Tool names to enable, or ['all'].",
+                }
+            },
+            "required": ["names"],
+        },
+    },
+}
+
+_SENTENCE_END = re.compile(r"(?<=[.!?])\s")
+
+
+def _first_sentence(text: str, limit: int = 160) -> str:
+    text = " ".join(text.split())
+    sentence = _SENTENCE_END.split(text, maxsplit=1)[0]
+    if len(sentence) > limit:
+        sentence = sentence[: limit - 3].rstrip() + "..."
+    return sentence
+
+
+def compact_tool_schema(tool: Dict[str, Any]) -> Dict[str, Any]:
+    """Copy of an OpenAI tool schema with descriptions cut to their first sentence."""
+
+    compact = copy.deepcopy(tool)
+    function = compact.get("function", {})
+    if isinstance(function.get("description"), str):
+        function["description"] = _first_sentence(function["description"])
+
+    properties = (function.get("parameters") or {}).get("properties") or {}
+    for prop in properties.values():
+        if isinstance(prop.get("description"), str):
+            prop["description"] = _first_sentence(prop["description"], limit=100)
+    return compact
+
+
+def tool_name(tool: Dict[str, Any]) -> Optional[str]:
+    return (tool.get("function") or {}).get("name")
+
+
+def select_tool_names(question: str, available: Iterable[str]) -> Set[str]:
+    """Core tools, keyword-triggered tools and any tool named in the question."""
+
+    available = set(available)
+    lowered = (question or "").lower()
+    selected = {name for name in CORE_TOOLS if name in available}
+    for name, keywords in TOOL_KEYWORDS.items():
+        if name in available and any(keyword in lowered for keyword in keywords):
+            selected.add(name)
+    selected.update(name for name in available if name in lowered)
+    # Tools this module does not know about (custom tool maps) are never hidden.
+    selected.update(name for name in available if name not in CORE_TOOLS and name not in TOOL_KEYWORDS)
+    return selected
+
+
+def estimate_schema_tokens(tools: Sequence[Dict[str, Any]]) -> int:
+    """Rough prompt-token cost of a tool list (~4 characters per token)."""
+
+    return len(json.dumps(list(tools), separators=(",", ":"))) // 4
+
+
+class ToolSelector:
+    """Tracks which tool schemas are exposed to the model during one agent run."""
+
+    def __init__(self, tools_spec: Sequence[Dict[str, Any]], question: str, compact: bool = True):
+        self._specs = {
+            name: compact_tool_schema(tool) if compact else tool
+            for tool in tools_spec
+            if (name := tool_name(tool))
+        }
+        self._order = list(self._specs)
+        self.active = select_tool_names(question, self._order)
+
+    @property
+    def complete(self) -> bool:
+        return self.active >= set(self._order)
+
+    def expand(self, names: Iterable[str]) -> List[str]:
+        """Expose more tools ('all' exposes everything); returns the newly added names."""
+
+        requested = set(names)
+        if "all" in requested:
+            requested = set(self._order)
+        added = [name for name in self._order if name in requested and name not in self.active]
+        self.active.update(added)
+        return added
+
+    def specs(self) -> List[Dict[str, Any]]:
+        exposed = [self._specs[name] for name in self._order if name in self.active]
+        if not self.complete:
+            hidden = ", ".join(name for name in self._order if name not in self.active)
+            request = copy.deepcopy(REQUEST_TOOLS_SPEC)
+            request["function"]["description"] += f" Available: {hidden}."
+            exposed.append(request)
+        return exposed
+
+    def handle_request(self, args: Dict[str, Any]) -> Dict[str, Any]:
+        names = args.get("names") or []
+        if isinstance(names, str):
+            names = [part.strip() for part in names.split(",")]
+        unknown = sorted(set(names) - set(self._order) - {"all"})
+        added = self.expand(names)
+        result: Dict[str, Any] = {"enabled": added, "active": sorted(self.active)}
+        if unknown:
+            result["unknown"] = unknown
+        return result
+
+
+__all__ = [
+    "CORE_TOOLS",
+    "REQUEST_TOOLS_NAME",
+    "ToolSelector",
+    "compact_tool_schema",
+    "estimate_schema_tokens",
+    "select_tool_names",
+]
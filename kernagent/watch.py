@@ -0,0 +1,325 @@
+"""Spool-directory ingestion: watch a directory and report on every new sample.
+
+``kernagent watch <dir>`` replaces a cron loop over a sandbox drop directory.
+New files are noticed through inotify (or a directory poll where inotify is not
+available), held back until their size and mtime stop changing so partially
+written samples are not analyzed, deduplicated by SHA-256 and handed to a
+bounded pool of workers. Each sample gets ``<output>/<sha256>/`` with a copy of
+the sample, its snapshot, the report and a ``status.json`` that downstream
+consumers can poll; a sample whose status is ``done`` is never analyzed twice.
+"""
+
+from __future__ import annotations
+
+import ctypes
+import ctypes.util
+import hashlib
+import json
+import os
+import select
+import shutil
+import struct
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+from typing import Any, Callable, Dict, Iterable, List, Optional, Set, Tuple
+
+from .log import get_logger
+
+logger = get_logger(__name__)
+
+DEFAULT_JOBS = 2
+DEFAULT_SETTLE_SECONDS = 1.0
+DEFAULT_POLL_SECONDS = 2.0
+STATUS_FILE = "status.json"
+
+# Names a sandbox or downloader uses while a file is still being written.
+PARTIAL_SUFFIXES = (".part", ".partial", ".tmp", ".crdownload", ".download")
+
+# inotify(7) event bits
+IN_MODIFY = 0x00000002
+IN_CLOSE_WRITE = 0x00000008
+IN_MOVED_TO = 0x00000080
+IN_CREATE = 0x00000100
+IN_Q_OVERFLOW = 0x00004000
+_EVENT_HEADER = struct.Struct("iIII")
+
+# (sample copy, result directory) -> report files written, relative to the result directory.
+Processor = Callable[[Path, Path], List[str]]
+
+
+def is_candidate(path: Path) -> bool:
+    name = path.name
+    return not name.startswith(".") and not name.lower().endswith(PARTIAL_SUFFIXES)
+
+
+def sha256_file(path: Path, chunk_size: int = 1 << 20) -> str:
+    digest = hashlib.sha256()
+    with path.open("rb") as f:
+        for chunk in iter(lambda: f.read(chunk_size), b""):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+def _write_json_atomic(path: Path, data: Dict[str, Any]) -> None:
+    tmp = path.with_name(path.name + ".tmp")
+    tmp.write_text(json.dumps(data, indent=2), encoding="utf-8")
+    os.replace(tmp, path)
+
+
+class InotifyWatcher:
+    """Names of files created, written or moved into one directory (Linux only)."""
+
+    MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY
+
+    def __init__(self, directory: Path):
+        self.directory = directory
+        libc = ctypes.CDLL(ctypes.util.find_library("c") or "libc.so.6", use_errno=True)
+        if not hasattr(libc, "inotify_init1"):
+            raise OSError("inotify is not available")
+        self._fd = libc.inotify_init1(os.O_NONBLOCK | os.O_CLOEXEC)
+        if self._fd < 0:
+            raise OSError(ctypes.get_errno(), "inotify_init1 failed")
+        if libc.inotify_add_watch(self._fd, os.fsencode(str(directory)), self.MASK) < 0:
+            errno = ctypes.get_errno()
+            os.close(self._fd)
+            raise OSError(errno, f"inotify_add_watch failed for {directory}")
+
+    def poll(self, timeout: float) -> List[Path]:
+        ready, _, _ = select.select([self._fd], [], [], max(0.0, timeout))
+        if not ready:
+            return []
+        try:
+            data = os.read(self._fd, 64 * 1024)
+        except BlockingIOError:
+            return []
+        paths: List[Path] = []
+        offset = 0
+        while offset + _EVENT_HEADER.size <= len(data):
+            _, mask, _, length = _EVENT_HEADER.unpack_from(data, offset)
+            offset += _EVENT_HEADER.size
+            name = data[offset : offset + length].rstrip(b"\0")
+            offset += length
+            if mask & IN_Q_OVERFLOW:
+                # Events were dropped; rescan so nothing that arrived is missed.
+                logger.warning("inotify queue overflowed; rescanning %s", self.directory)
+                paths.extend(entry for entry in self.directory.iterdir())
+            elif name:
+                paths.append(self.directory / os.fsdecode(name))
+        return paths
+
+    def close(self) -> None:
+        os.close(self._fd)
+
+
+class PollingWatcher:
+    """Fallback for platforms or filesystems without inotify: list the directory periodically."""
+
+    def __init__(self, directory: Path, interval: float = DEFAULT_POLL_SECONDS):
+        self.directory = directory
+        self.interval = interval
+        self._seen: Dict[Path, Tuple[int, float]] = {}
+
+    def poll(self, timeout: float) -> List[Path]:
+        time.sleep(max(0.0, min(timeout, self.interval)))
+        changed = []
+        current: Dict[Path, Tuple[int, float]] = {}
+        for entry in self.directory.iterdir():
+            try:
+                stat = entry.stat()
+            except OSError:
+                continue
+            current[entry] = (stat.st_size, stat.st_mtime)
+            if self._seen.get(entry) != current[entry]:
+                changed.append(entry)
+        self._seen = current
+        return changed
+
+    def close(self) -> None:
+        pass
+
+
+def open_watcher(directory: Path) -> Any:
+    try:
+        return InotifyWatcher(directory)
+    except OSError as exc:
+        logger.warning("inotify unavailable (%s); polling %s every %.0fs", exc, directory, DEFAULT_POLL_SECONDS)
+        return PollingWatcher(directory)
+
+
+class Debouncer:
+    """Release a path once its size and mtime have not changed for `settle` seconds."""
+
+    def __init__(self, settle: float = DEFAULT_SETTLE_SECONDS, clock: Callable[[], float] = time.monotonic):
+        self.settle = settle
+        self.clock = clock
+        self._pending: Dict[Path, Tuple[Tuple[int, float], float]] = {}
+
+    def touch(self, path: Path) -> None:
+        try:
+            stat = path.stat()
+        except OSError:
+            self._pending.pop(path, None)
+            return
+        if not path.is_file():
+            return
+        signature = (stat.st_size, stat.st_mtime)
+        previous = self._pending.get(path)
+        if previous is None or previous[0] != signature:
+            self._pending[path] = (signature, self.clock())
+
+    def ready(self) -> List[Path]:
+        now = self.clock()
+        released = []
+        for path, (signature, since) in list(self._pending.items()):
+            try:
+                stat = path.stat()
+            except OSError:
+                del self._pending[path]
+                continue
+            current = (stat.st_size, stat.st_mtime)
+            if current != signature or (now - since >= self.settle and not stat.st_size):
+                # Still changing, or created but not written yet: restart the wait.
+                self._pending[path] = (current, now)
+            elif now - since >= self.settle:
+                released.append(path)
+                del self._pending[path]
+        return released
+
+    def next_deadline(self) -> Optional[float]:
+        """Seconds until the earliest pending path could be released."""
+
+        if not self._pending:
+            return None
+        now = self.clock()
+        return max(0.0, min(since + self.settle - now for _, since in self._pending.values()))
+
+
+class WatchPipeline:
+    """Feed settled, not yet analyzed samples from `directory` to `process` on `jobs` workers."""
+
+    def __init__(
+        self,
+        directory: Path,
+        output_dir: Path,
+        process: Processor,
+        jobs: int = DEFAULT_JOBS,
+        settle: float = DEFAULT_SETTLE_SECONDS,
+    ):
+        self.directory = Path(directory).resolve()
+        self.output_dir = Path(output_dir).resolve()
+        self.process = process
+        self.jobs = max(1, jobs)
+        self.debouncer = Debouncer(settle)
+        self._executor = ThreadPoolExecutor(max_workers=self.jobs, thread_name_prefix="watch")
+        self._in_flight: Set[str] = set()
+        self._lock = threading.Lock()
+        self.stats = {"queued": 0, "duplicates": 0, "done": 0, "failed": 0}
+
+    def status(self, sha256: str) -> Optional[Dict[str, Any]]:
+        try:
+            return json.loads((self.output_dir / sha256 / STATUS_FILE).read_text(encoding="utf-8"))
+        except (OSError, ValueError):
+            return None
+
+    def _ignored(self, path: Path) -> bool:
+        return not is_candidate(path) or self.output_dir in path.resolve().parents
+
+    def notice(self, paths: Iterable[Path]) -> None:
+        for path in paths:
+            if not self._ignored(path):
+                self.debouncer.touch(path)
+
+    def submit(self, path: Path) -> Optional[str]:
+        """Queue one settled sample; returns its SHA-256, or None if it was skipped."""
+
+        try:
+            sha256 = sha256_file(path)
+        except OSError as exc:
+            logger.warning("Could not read %s: %s", path, exc)
+            return None
+        status = self.status(sha256)
+        with self._lock:
+            if sha256 in self._in_flight or (status and status.get("state") == "done"):
+                self.stats["duplicates"] += 1
+                logger.info("Skipping %s: already analyzed as %s", path.name, sha256[:12])
+                return None
+            self._in_flight.add(sha256)
+            self.stats["queued"] += 1
+
+        result_dir = self.output_dir / sha256
+        result_dir.mkdir(parents=True, exist_ok=True)
+        # Work on a copy: the sandbox may delete or reuse the spool file.
+        sample = result_dir / path.name
+        shutil.copy2(path, sample)
+        record = {"sha256": sha256, "name": path.name, "source": str(path), "state": "queued", "queued_at": time.time()}
+        _write_json_atomic(result_dir / STATUS_FILE, record)
+        logger.info("Queued %s (%s)", path.name, sha256[:12])
+        self._executor.submit(self._run, sample, result_dir, record)
+        return sha256
+
+    def _run(self, sample: Path, result_dir: Path, record: Dict[str, Any]) -> None:
+        started = time.time()
+        _write_json_atomic(result_dir / STATUS_FILE, {**record, "state": "running", "started_at": started})
+        try:
+            outputs = self.process(sample, result_dir)
+            final = {**record, "state": "done", "outputs": outputs}
+            logger.info("Finished %s in %.1fs", record["name"], time.time() - started)
+        except Exception as exc:
+            logger.error("Analysis of %s failed: %s", record["name"], exc)
+            final = {**record, "state": "failed", "error": str(exc)}
+        final.update(started_at=started, finished_at=time.time())
+        _write_json_atomic(result_dir / STATUS_FILE, final)
+        with self._lock:
+            self.stats[final["state"]] += 1
+            self._in_flight.discard(record["sha256"])
+
+    def step(self, watcher: Any, timeout: float) -> None:
+        """Wait up to `timeout` for events, then queue every path that has settled."""
+
+        wait = self.debouncer.next_deadline()
+        self.notice(watcher.poll(timeout if wait is None else min(timeout, wait)))
+        for path in self.debouncer.ready():
+            self.submit(path)
+
+    def run(self, stop: Optional[threading.Event] = None, watcher: Any = None) -> None:
+        """Process existing files, then new arrivals until `stop` is set or Ctrl-C."""
+
+        self.output_dir.mkdir(parents=True, exist_ok=True)
+        watcher = watcher or open_watcher(self.directory)
+        stop = stop or threading.Event()
+        logger.info("Watching %s (results in %s, %d workers)", self.directory, self.output_dir, self.jobs)
+        self.notice(self.directory.iterdir())
+        try:
+            while not stop.is_set():
+                self.step(watcher, timeout=1.0)
+        except KeyboardInterrupt:
+            logger.info("Stopping; waiting for running analyses")
+        finally:
+            watcher.close()
+            self.close()
+
+    def close(self, wait: bool = True) -> None:
+        self._executor.shutdown(wait=wait)
+
+
+def jobs_from_env() -> int:
+    value = os.getenv("KERNAGENT_WATCH_JOBS", "").strip()
+    try:
+        return max(1, int(value)) if value else DEFAULT_JOBS
+    except ValueError:
+        logger.warning("Ignoring invalid KERNAGENT_WATCH_JOBS=%s", value)
+        return DEFAULT_JOBS
+
+
+__all__ = [
+    "Debouncer",
+    "InotifyWatcher",
+    "PollingWatcher",
+    "WatchPipeline",
+    "is_candidate",
+    "jobs_from_env",
+    "open_watcher",
+    "sha256_file",
+]
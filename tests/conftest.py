@@ -0,0 +1,60 @@
+"""Shared fixtures and LLM stubs for the test suite."""
+
+import shutil
+from pathlib import Path
+from types import SimpleNamespace
+
+import pytest
+
+FIXTURE_ARCHIVE = Path(__file__).parent / "fixtures" / "bifrose_archive"
+
+
+@pytest.fixture
+def archive(tmp_path):
+    """Writable copy of the fixture archive (derived indexes are written next to it)."""
+    target = tmp_path / "bifrose_archive"
+    shutil.copytree(FIXTURE_ARCHIVE, target)
+    return target
+
+
+def response(content=None, tool_calls=None):
+    """Chat completion shaped like the OpenAI client's response object."""
+    message = SimpleNamespace(role="assistant", content=content, tool_calls=tool_calls or [])
+    return SimpleNamespace(choices=[SimpleNamespace(message=message)])
+
+
+def tool_call(name, arguments="{}", call_id="call_1"):
+    return SimpleNamespace(id=call_id, type="function", function=SimpleNamespace(name=name, arguments=arguments))
+
+
+class ScriptedLLM:
+    """Replays a fixed script, then answers "done".
+
+    Each reply is a response object, an exception to raise, or a
+    ``(name, arguments)`` shorthand for a single tool call.  Every request's
+    messages and exposed tool names are recorded; ``on_chat(turn)`` runs
+    before each reply.
+    """
+
+    def __init__(self, replies, on_chat=None):
+        self.replies = list(replies)
+        self.on_chat = on_chat
+        self.turn = 0
+        self.requests = []
+        self.exposed = []
+
+    def chat(self, verbose=False, **kwargs):
+        self.requests.append(kwargs.get("messages"))
+        self.exposed.append([tool["function"]["name"] for tool in kwargs.get("tools") or []])
+        if self.on_chat:
+            self.on_chat(self.turn)
+        self.turn += 1
+        if not self.replies:
+            return response("done")
+        reply = self.replies.pop(0)
+        if isinstance(reply, Exception):
+            raise reply
+        if isinstance(reply, tuple):
+            name, arguments = reply
+            return response(tool_calls=[tool_call(name, arguments, call_id=f"call_{self.turn}")])
+        return reply
@@ -1,5 +1,7 @@
 from kernagent.agent import ReverseEngineeringAgent
 
+from conftest import ScriptedLLM
+
 
 class DummyToolCallFunction:
     def __init__(self, name: str, arguments: str):
@@ -62,3 +64,73 @@ def test_agent_runs_tool_loop():
 
     answer = agent.run("test question")
     assert answer == "final-answer"
+
+
+def make_tool(name, description="Does a thing. With many more details here."):
+    return {
+        "type": "function",
+        "function": {
+            "name": name,
+            "description": description,
+            "parameters": {"type": "object", "properties": {}},
+        },
+    }
+
+
+def test_agent_exposes_question_specific_tool_subset():
+    from kernagent.prompts import TOOLS
+
+    llm = ScriptedLLM([])
+    agent = ReverseEngineeringAgent(llm=llm, tools_spec=TOOLS, tool_map={})
+
+    agent.run("Show me function FUN_10001020")
+
+    exposed = llm.exposed[0]
+    assert "get_function" in exposed
+    assert "search_equates" not in exposed
+    assert "request_tools" in exposed
+    assert len(exposed) < len(TOOLS)
+
+
+def test_request_tools_enables_hidden_tools():
+    from kernagent.prompts import TOOLS
+
+    llm = ScriptedLLM([("request_tools", '{"names": ["search_equates"]}')])
+    agent = ReverseEngineeringAgent(llm=llm, tools_spec=TOOLS, tool_map={})
+
+    agent.run("Show me function FUN_10001020")
+
+    assert "search_equates" not in llm.exposed[0]
+    assert "search_equates" in llm.exposed[1]
+
+
+def test_hidden_tool_calls_still_run():
+    from kernagent.prompts import TOOLS
+
+    calls = []
+    llm = ScriptedLLM([("search_equates", '{"name_pattern": "KEY"}')])
+    agent = ReverseEngineeringAgent(
+        llm=llm,
+        tools_spec=TOOLS,
+        tool_map={"search_equates": lambda **kwargs: calls.append(kwargs) or {"results": []}},
+    )
+
+    assert agent.run("Show me function FUN_10001020") == "done"
+    assert calls == [{"name_pattern": "KEY"}]
+
+
+def test_compact_schemas_keep_first_sentence():
+    from kernagent.toolsets import compact_tool_schema
+
+    compact = compact_tool_schema(make_tool("x"))
+    assert compact["function"]["description"] == "Does a thing."
+
+
+def test_tool_selection_can_be_disabled():
+    llm = ScriptedLLM([])
+    tools = [make_tool("search_equates"), make_tool("get_function")]
+    agent = ReverseEngineeringAgent(llm=llm, tools_spec=tools, tool_map={}, select_tools=False)
+
+    agent.run("anything")
+
+    assert llm.exposed[0] == ["search_equates", "get_function"]
@@ -0,0 +1,128 @@
+"""Tests for multi-question ask sessions."""
+
+import io
+import threading
+from pathlib import Path
+from unittest import mock
+
+import pytest
+
+from kernagent.cli import build_parser, run_interactive, run_questions_and_print
+from kernagent.config import Settings
+from kernagent.session import AskSession, load_questions
+
+from conftest import FIXTURE_ARCHIVE, response
+
+
+class EchoLLM:
+    """Answers with the question it was asked and records every prompt."""
+
+    def __init__(self, delay=0.0):
+        self.prompts = []
+        self.delay = delay
+        self.active = 0
+        self.max_active = 0
+        self._lock = threading.Lock()
+
+    def chat(self, **kwargs):
+        prompt = kwargs["messages"][1]["content"]
+        with self._lock:
+            self.prompts.append(prompt)
+            self.active += 1
+            self.max_active = max(self.max_active, self.active)
+        threading.Event().wait(self.delay)
+        with self._lock:
+            self.active -= 1
+        return response("answer to " + prompt.rsplit("Question: ", 1)[-1])
+
+
+@pytest.fixture(autouse=True)
+def no_prefetch(monkeypatch):
+    monkeypatch.setenv("KERNAGENT_PREFETCH", "0")
+
+
+class TestLoadQuestions:
+    """Question files."""
+
+    def test_skips_blank_lines_and_comments(self):
+        source = io.StringIO("# triage\nWhat is this?\n\n  Where is the C2?  \n")
+        assert load_questions(source) == ["What is this?", "Where is the C2?"]
+
+
+class TestAskSession:
+    """Shared snapshot state and carried-over findings."""
+
+    def test_follow_up_questions_see_earlier_answers(self):
+        llm = EchoLLM()
+        session = AskSession(FIXTURE_ARCHIVE, llm)
+
+        session.ask("What does it do?")
+        session.ask("Where is the config?")
+
+        assert llm.prompts[0] == "What does it do?"
+        assert "A: answer to What does it do?" in llm.prompts[1]
+        assert llm.prompts[1].endswith("Question: Where is the config?")
+
+    def test_context_keeps_newest_findings_within_budget(self, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_TOKENIZER", "chars")
+        session = AskSession(FIXTURE_ARCHIVE, EchoLLM(), context_tokens=40)
+        for number in range(5):
+            session._record(f"question {number}", "x" * 80)
+
+        context = session.context()
+        assert "question 4" in context
+        assert "question 0" not in context
+
+        session.reset()
+        assert session.context() is None
+
+    def test_failed_answers_are_not_carried_over(self):
+        session = AskSession(FIXTURE_ARCHIVE, EchoLLM())
+        session._record("q", "LLM Error: timeout")
+        assert session.findings == []
+
+    def test_questions_share_caches_with_separate_budgets(self, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_TOKEN_BUDGET", "1000")
+        session = AskSession(FIXTURE_ARCHIVE, EchoLLM())
+        first, second = session.snapshot.fork(), session.snapshot.fork()
+
+        first.budget.charge(900)
+        assert first._cache is second._cache is session.snapshot._cache
+        assert second.budget.remaining == 1000
+
+    def test_concurrent_questions_keep_input_order(self):
+        llm = EchoLLM(delay=0.05)
+        session = AskSession(FIXTURE_ARCHIVE, llm)
+        questions = [f"question {number}" for number in range(4)]
+
+        answers = session.ask_many(questions, jobs=4)
+
+        assert answers == [f"answer to question {number}" for number in range(4)]
+        assert llm.max_active > 1
+        assert [finding.question for finding in session.findings] == questions
+
+
+class TestAskCli:
+    """`ask --questions` and the interactive prompt."""
+
+    def test_question_is_optional_with_questions_file(self):
+        args = build_parser().parse_args(["ask", "/bin/sample", "--questions", "q.txt", "--jobs", "2"])
+        assert args.question is None
+        assert args.questions == Path("q.txt")
+        assert args.jobs == 2
+
+    def test_questions_are_printed_in_order(self, capsys):
+        with mock.patch("kernagent.cli.LLMClient", return_value=EchoLLM()):
+            run_questions_and_print(FIXTURE_ARCHIVE, ["first?", "second?"], Settings(), verbose=False)
+
+        out = capsys.readouterr().out
+        assert out.index("## Q1: first?") < out.index("answer to first?") < out.index("## Q2: second?")
+
+    def test_interactive_prompt_until_exit(self, capsys):
+        llm = EchoLLM()
+        lines = iter(["", "What is this?", ":reset", "And now?", "exit"])
+        with mock.patch("kernagent.cli.LLMClient", return_value=llm):
+            run_interactive(FIXTURE_ARCHIVE, Settings(), verbose=False, input_fn=lambda prompt: next(lines))
+
+        assert "answer to What is this?" in capsys.readouterr().out
+        assert llm.prompts == ["What is this?", "And now?"]
@@ -0,0 +1,258 @@
+"""Tests for archive/installer/directory inputs."""
+
+import gzip
+import io
+import json
+import shutil
+import tarfile
+import threading
+import time
+import zipfile
+from argparse import Namespace
+from unittest import mock
+
+import pytest
+
+from kernagent import bundle as bundle_module
+from kernagent.bundle import BundleLimitError, archive_kind, build_bundle, bundle_dir_for, executable_format, member_snapshots
+from kernagent.cli import build_parser, bundle_member_for_ask, run_bundle
+from kernagent.config import Settings
+from kernagent.snapshot import SnapshotError
+
+from conftest import FIXTURE_ARCHIVE
+
+
+PE_A = b"MZ\x90\x00" + b"A" * 64
+PE_B = b"MZ\x90\x00" + b"B" * 64
+ELF = b"\x7fELF\x02\x01\x01" + b"C" * 64
+
+
+class FakeBuild:
+    """Stands in for build_snapshot: creates <stem>_archive next to the member."""
+
+    def __init__(self, delay=0.0, fail=()):
+        self.calls = []
+        self.delay = delay
+        self.fail = set(fail)
+        self.active = 0
+        self.max_active = 0
+        self._lock = threading.Lock()
+
+    def __call__(self, binary_path, output_dir=None, verbose=False):
+        with self._lock:
+            self.calls.append(binary_path.name)
+            self.active += 1
+            self.max_active = max(self.max_active, self.active)
+        time.sleep(self.delay)
+        with self._lock:
+            self.active -= 1
+        if any(binary_path.name.endswith(name) for name in self.fail):
+            raise SnapshotError("analysis failed")
+        archive = binary_path.parent / f"{binary_path.stem}_archive"
+        archive.mkdir(exist_ok=True)
+        return archive
+
+
+def _zip(path, members):
+    with zipfile.ZipFile(path, "w") as zf:
+        for name, data in members.items():
+            zf.writestr(name, data)
+    return path
+
+
+def _manifest(bundle_dir):
+    return json.loads((bundle_dir / "manifest.json").read_text())
+
+
+class TestDetection:
+    """Input and member classification."""
+
+    def test_archive_kinds(self, tmp_path):
+        sample = tmp_path / "sample.exe"
+        sample.write_bytes(PE_A)
+        with tarfile.open(tmp_path / "drop.tar.gz", "w:gz") as tf:
+            tf.add(sample, arcname="sample.exe")
+
+        assert archive_kind(sample) is None
+        assert archive_kind(tmp_path) == "directory"
+        assert archive_kind(_zip(tmp_path / "a.zip", {"x": b""})) == "zip"
+        assert archive_kind(tmp_path / "drop.tar.gz") == "tar"
+
+    def test_executable_formats(self):
+        assert executable_format(PE_A) == "pe"
+        assert executable_format(ELF) == "elf"
+        assert executable_format(b"\xcf\xfa\xed\xfe") == "macho"
+        assert executable_format(b"#!/bin/sh") is None
+
+
+class TestBuildBundle:
+    """Enumerate, deduplicate, snapshot in parallel, write the manifest."""
+
+    def test_zip_members_are_deduplicated_and_nested_archives_unpacked(self, tmp_path):
+        inner = io.BytesIO()
+        with zipfile.ZipFile(inner, "w") as zf:
+            zf.writestr("plugins/helper.so", ELF)
+            zf.writestr("plugins/copy.dll", PE_A)
+        installer = _zip(
+            tmp_path / "setup.zip",
+            {"bin/app.exe": PE_A, "bin/app_copy.exe": PE_A, "bin/core.dll": PE_B, "readme.txt": b"hi", "extra.zip": inner.getvalue()},
+        )
+        build = FakeBuild(delay=0.05)
+
+        bundle_dir = build_bundle(installer, jobs=4, build=build)
+
+        manifest = _manifest(bundle_dir)
+        members = {entry["path"]: entry for entry in manifest["members"]}
+        assert set(members) == {"bin/app.exe", "bin/core.dll", "extra.zip!plugins/helper.so"}
+        assert sorted(members["bin/app.exe"]["duplicates"]) == ["bin/app_copy.exe", "extra.zip!plugins/copy.dll"]
+        assert members["extra.zip!plugins/helper.so"]["format"] == "elf"
+        assert manifest["skipped"] == 1
+        assert all(entry["state"] == "done" for entry in manifest["members"])
+        assert len(build.calls) == 3 and build.max_active > 1
+        assert [path for path, _ in member_snapshots(bundle_dir)] == sorted(members)
+        assert not list(bundle_dir.glob(".*"))  # no temporary files left behind
+
+    def test_rerun_reuses_snapshots_and_retries_failures(self, tmp_path):
+        installer = _zip(tmp_path / "setup.zip", {"good.exe": PE_A, "bad.dll": PE_B})
+        build_bundle(installer, jobs=2, build=FakeBuild(fail={"bad.dll"}))
+        states = {entry["path"]: entry["state"] for entry in _manifest(bundle_dir_for(installer))["members"]}
+        assert states == {"good.exe": "done", "bad.dll": "failed"}
+
+        retry = FakeBuild()
+        build_bundle(installer, jobs=2, build=retry)
+        assert [name.split("_", 1)[1] for name in retry.calls] == ["bad.dll"]
+
+    def test_directory_input_keeps_snapshots_of_unchanged_members(self, tmp_path):
+        folder = tmp_path / "dlls"
+        (folder / "sub").mkdir(parents=True)
+        (folder / "a.dll").write_bytes(PE_A)
+        (folder / "sub" / "b.dll").write_bytes(PE_B)
+        (folder / "notes.txt").write_text("x")
+
+        bundle_dir = build_bundle(folder, jobs=2, build=FakeBuild())
+        assert bundle_dir == folder / "kernagent_bundle"
+
+        (folder / "c.so").write_bytes(ELF)
+        rebuild = FakeBuild()
+        build_bundle(folder, jobs=2, build=rebuild)
+        assert len(rebuild.calls) == 1 and rebuild.calls[0].endswith("c.so")
+        assert len(_manifest(bundle_dir)["members"]) == 3
+
+    def test_nested_zip_bomb_stops_at_the_size_limit(self, tmp_path, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_BUNDLE_MAX_MB", "1")
+        inner = io.BytesIO()
+        with zipfile.ZipFile(inner, "w", zipfile.ZIP_DEFLATED) as zf:
+            zf.writestr("big.exe", b"MZ" + b"\0" * (2 * 2**20))
+        installer = _zip(tmp_path / "bomb.zip", {"inner.zip": inner.getvalue()})
+
+        with pytest.raises(BundleLimitError, match="KERNAGENT_BUNDLE_MAX_MB"):
+            build_bundle(installer, build=FakeBuild())
+        assert not list((bundle_dir_for(installer) / "members").iterdir())
+
+    def test_stops_at_the_member_limit(self, tmp_path, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_BUNDLE_MAX_MEMBERS", "3")
+        installer = _zip(tmp_path / "many.zip", {f"{number}.txt": b"x" for number in range(5)})
+
+        with pytest.raises(BundleLimitError, match="KERNAGENT_BUNDLE_MAX_MEMBERS"):
+            build_bundle(installer, jobs=1, build=FakeBuild())
+
+    def test_default_jobs_is_conservative(self, monkeypatch):
+        monkeypatch.delenv("KERNAGENT_BUNDLE_JOBS", raising=False)
+        assert bundle_module.jobs_from_env() <= bundle_module.DEFAULT_JOBS
+
+    def test_compressed_single_file_is_one_member(self, tmp_path):
+        sample = tmp_path / "sample.exe.gz"
+        sample.write_bytes(gzip.compress(PE_A))
+        assert archive_kind(sample) == "gz"
+
+        bundle_dir = build_bundle(sample, build=FakeBuild())
+        assert [entry["path"] for entry in _manifest(bundle_dir)["members"]] == ["sample.exe"]
+
+    def test_corrupt_stream_is_a_snapshot_error(self, tmp_path):
+        sample = tmp_path / "sample.exe.gz"
+        sample.write_bytes(gzip.compress(PE_A)[:20])
+        with pytest.raises(SnapshotError, match="Cannot unpack"):
+            build_bundle(sample, build=FakeBuild())
+
+    def test_directory_skips_only_kernagent_outputs(self, tmp_path):
+        folder = tmp_path / "samples"
+        (folder / "apt_archive").mkdir(parents=True)
+        (folder / "apt_archive" / "implant.dll").write_bytes(PE_A)
+        (folder / "tool.exe").write_bytes(PE_B)
+        (folder / "tool_archive").mkdir()
+        (folder / "tool_archive" / "copy.exe").write_bytes(ELF)
+
+        bundle_dir = build_bundle(folder, build=FakeBuild())
+        assert [entry["path"] for entry in _manifest(bundle_dir)["members"]] == ["apt_archive/implant.dll", "tool.exe"]
+
+    def test_installer_formats_need_7zip(self, tmp_path, monkeypatch):
+        msi = tmp_path / "setup.msi"
+        msi.write_bytes(b"\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1" + b"\0" * 64)
+        monkeypatch.setattr(bundle_module.shutil, "which", lambda name: None)
+        with pytest.raises(SnapshotError, match="7-Zip"):
+            build_bundle(msi, build=FakeBuild())
+
+    def test_plain_binary_is_rejected(self, tmp_path):
+        sample = tmp_path / "sample.exe"
+        sample.write_bytes(PE_A)
+        with pytest.raises(SnapshotError):
+            build_bundle(sample, build=FakeBuild())
+
+
+class TestBundleCli:
+    """Archive inputs on the command line."""
+
+    def _copy_fixture(self, binary_path, output_dir=None, verbose=False):
+        archive = binary_path.parent / f"{binary_path.stem}_archive"
+        shutil.copytree(FIXTURE_ARCHIVE, archive)
+        return archive
+
+    def _run(self, tmp_path, argv, members=None):
+        installer = _zip(tmp_path / "setup.zip", members or {"app.exe": PE_A, "same.exe": PE_A})
+        args = build_parser().parse_args([argv[0], str(installer), *argv[1:]])
+        args.verbose = False
+        with mock.patch(
+            "kernagent.cli.build_bundle",
+            lambda path, jobs=None, verbose=False, snapshot=True: build_bundle(
+                path, jobs=jobs, build=self._copy_fixture, snapshot=snapshot
+            ),
+        ):
+            run_bundle(args, Settings(), installer)
+        return installer
+
+    def test_unpack_lists_members(self, tmp_path, capsys):
+        self._run(tmp_path, ["unpack", "--jobs", "2"])
+        out = capsys.readouterr().out
+        assert "done    pe     app.exe (+1 duplicates)" in out
+        assert "1 snapshots, 0 failed" in out
+
+    def test_summary_json_covers_every_member(self, tmp_path, capsys):
+        self._run(tmp_path, ["summary", "--json"])
+        output = json.loads(capsys.readouterr().out)
+        assert list(output["members"]) == ["app.exe"]
+        assert "file" in output["members"]["app.exe"]
+
+    def test_document_without_executables_exits(self, tmp_path):
+        with pytest.raises(SystemExit, match="no executable members in"):
+            self._run(tmp_path, ["summary"], members={"word/document.xml": b"<w:document/>"})
+
+    def _ask(self, tmp_path, members):
+        installer = _zip(tmp_path / "setup.zip", members)
+        build = FakeBuild()
+        with mock.patch(
+            "kernagent.cli.build_bundle",
+            lambda path, jobs=None, verbose=False, snapshot=True: build_bundle(
+                path, jobs=jobs, build=build, snapshot=snapshot
+            ),
+        ):
+            return bundle_member_for_ask(installer, verbose=False), build
+
+    def test_ask_lists_members_without_snapshotting(self, tmp_path):
+        with pytest.raises(SystemExit, match="holds 2 executables; ask about one of them") as excinfo:
+            self._ask(tmp_path, {"app.exe": PE_A, "core.dll": PE_B})
+        assert "members" in str(excinfo.value)
+        assert not list(tmp_path.glob("setup.zip_bundle/members/*_archive"))
+
+    def test_ask_uses_the_only_member(self, tmp_path):
+        archive_dir, build = self._ask(tmp_path, {"app.exe": PE_A, "readme.txt": b"hi"})
+        assert len(build.calls) == 1 and archive_dir.name.endswith("app_archive")
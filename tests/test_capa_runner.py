@@ -0,0 +1,321 @@
+"""Tests for the capa wrapper that do not require flare-capa at runtime."""
+
+import json
+from types import SimpleNamespace
+
+import pytest
+
+from kernagent import capa_runner
+from kernagent.capa_runner import (
+    CAPA_BACKEND_GHIDRA,
+    CAPA_BACKEND_VIV,
+    GhidraCapaContext,
+    _CapaBudget,
+    build_capa_summary,
+    resolve_capa_backend,
+    resolve_capa_time_budget,
+    select_capa_functions,
+)
+
+
+def make_doc(rule_names):
+    """Build a minimal stand-in for capa's ResultDocument."""
+    rules = {}
+    for name in rule_names:
+        meta = SimpleNamespace(
+            namespace="host-interaction/process",
+            scope="function",
+            description=None,
+            attack=[],
+            mbc=[],
+            tags=[],
+        )
+        location = SimpleNamespace(type=SimpleNamespace(value="absolute"), value=0x401000)
+        rules[name] = SimpleNamespace(meta=meta, matches=[(location, None)])
+    sample = SimpleNamespace(sha256="ab" * 32, md5="cd" * 16)
+    return SimpleNamespace(rules=rules, meta=SimpleNamespace(sample=sample))
+
+
+class TestBackendResolution:
+    """Test CAPA_BACKEND handling."""
+
+    def test_defaults_to_vivisect(self, monkeypatch):
+        monkeypatch.delenv("CAPA_BACKEND", raising=False)
+        assert resolve_capa_backend() == CAPA_BACKEND_VIV
+
+    def test_accepts_ghidra(self, monkeypatch):
+        monkeypatch.setenv("CAPA_BACKEND", "Ghidra")
+        assert resolve_capa_backend() == CAPA_BACKEND_GHIDRA
+
+    def test_unknown_value_falls_back(self, monkeypatch):
+        monkeypatch.setenv("CAPA_BACKEND", "binja")
+        assert resolve_capa_backend() == CAPA_BACKEND_VIV
+
+
+class TestBuildCapaSummary:
+    """Test build_capa_summary() with a stubbed capa analysis."""
+
+    @pytest.fixture(autouse=True)
+    def _enable_capa(self, tmp_path, monkeypatch):
+        monkeypatch.delenv("CAPA_DISABLE", raising=False)
+        monkeypatch.delenv("CAPA_RULES_PATH", raising=False)
+        monkeypatch.delenv("CAPA_TIMEOUT", raising=False)
+        monkeypatch.delenv("CAPA_CACHE_DISABLE", raising=False)
+        monkeypatch.setenv("CAPA_CACHE_DIR", str(tmp_path / "capa-cache"))
+
+    def test_records_ghidra_backend(self, tmp_path, monkeypatch):
+        calls = []
+
+        def fake_analyze(binary_path, rules_path, ghidra_context=None, budget=None):
+            calls.append(ghidra_context)
+            return make_doc(["create process"]), ["rule"]
+
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", fake_analyze)
+        context = GhidraCapaContext(program=object(), flat_api=object(), monitor=object())
+
+        path = build_capa_summary(tmp_path / "sample.exe", tmp_path, ghidra_context=context)
+
+        payload = json.loads(path.read_text())
+        assert payload["backend"] == CAPA_BACKEND_GHIDRA
+        assert calls == [context]
+
+    def test_ghidra_failure_falls_back_to_vivisect(self, tmp_path, monkeypatch):
+        calls = []
+
+        def fake_analyze(binary_path, rules_path, ghidra_context=None, budget=None):
+            calls.append(ghidra_context)
+            if ghidra_context is not None:
+                raise RuntimeError("no ghidra extractor")
+            return make_doc(["create process"]), ["rule"]
+
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", fake_analyze)
+        context = GhidraCapaContext(program=object(), flat_api=object(), monitor=object())
+
+        path = build_capa_summary(tmp_path / "sample.exe", tmp_path, ghidra_context=context)
+
+        payload = json.loads(path.read_text())
+        assert payload["backend"] == CAPA_BACKEND_VIV
+        assert calls == [context, None]
+
+    def test_fallback_keeps_deadline_and_drops_ghidra_selection(self, tmp_path, monkeypatch):
+        budgets = []
+
+        def fake_analyze(binary_path, rules_path, ghidra_context=None, budget=None):
+            budgets.append(budget)
+            if ghidra_context is not None:
+                raise RuntimeError("no ghidra extractor")
+            return make_doc(["create process"]), ["rule"]
+
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", fake_analyze)
+        context = GhidraCapaContext(program=object(), flat_api=object(), monitor=object())
+
+        build_capa_summary(
+            tmp_path / "sample.exe", tmp_path, ghidra_context=context, time_budget=60.0, function_addresses={0x1000}
+        )
+
+        ghidra_budget, viv_budget = budgets
+        assert viv_budget.deadline == ghidra_budget.deadline
+        assert ghidra_budget.function_addresses == {0x1000}
+        assert viv_budget.function_addresses is None
+
+    def test_partial_analysis_is_marked(self, tmp_path, monkeypatch):
+        def fake_analyze(binary_path, rules_path, ghidra_context=None, budget=None):
+            budget.timed_out = True
+            budget.skipped = 7
+            return make_doc(["create process"]), ["rule"]
+
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", fake_analyze)
+
+        path = build_capa_summary(tmp_path / "sample.exe", tmp_path, time_budget=1.0)
+
+        analysis = json.loads(path.read_text())["analysis"]
+        assert analysis["partial"] is True
+        assert analysis["timed_out"] is True
+        assert analysis["functions_skipped"] == 7
+        assert analysis["time_budget_s"] == 1.0
+
+
+class TestCapaCache:
+    """Test the corpus-wide capa result cache."""
+
+    @pytest.fixture(autouse=True)
+    def _cache_env(self, tmp_path, monkeypatch):
+        monkeypatch.delenv("CAPA_DISABLE", raising=False)
+        monkeypatch.delenv("CAPA_RULES_PATH", raising=False)
+        monkeypatch.delenv("CAPA_TIMEOUT", raising=False)
+        monkeypatch.delenv("CAPA_CACHE_DISABLE", raising=False)
+        monkeypatch.setenv("CAPA_CACHE_DIR", str(tmp_path / "capa-cache"))
+
+    @pytest.fixture
+    def sample(self, tmp_path):
+        path = tmp_path / "sample.exe"
+        path.write_bytes(b"MZ" + b"\0" * 64)
+        return path
+
+    @staticmethod
+    def counting_analyze(calls, rule_names=("create process",)):
+        def fake_analyze(binary_path, rules_path, ghidra_context=None, budget=None):
+            calls.append(binary_path)
+            return make_doc(list(rule_names)), ["rule"]
+
+        return fake_analyze
+
+    def test_second_run_reuses_cached_result(self, tmp_path, sample, monkeypatch):
+        calls = []
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", self.counting_analyze(calls))
+
+        first = build_capa_summary(sample, tmp_path / "a")
+        second = build_capa_summary(sample, tmp_path / "b")
+
+        assert len(calls) == 1
+        assert json.loads(first.read_text())["rules"] == json.loads(second.read_text())["rules"]
+        assert json.loads(second.read_text())["cached"] is True
+
+    def test_empty_result_is_cached(self, tmp_path, sample, monkeypatch):
+        calls = []
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", self.counting_analyze(calls, ()))
+
+        assert build_capa_summary(sample, tmp_path / "a") is None
+        assert build_capa_summary(sample, tmp_path / "b") is None
+        assert len(calls) == 1
+
+    def test_rule_change_invalidates_cache(self, tmp_path, sample, monkeypatch):
+        calls = []
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", self.counting_analyze(calls))
+        rules = tmp_path / "rules"
+        rules.mkdir()
+        rule_file = rules / "create-process.yml"
+        rule_file.write_text("rule: v1")
+
+        build_capa_summary(sample, tmp_path / "a", rules_path=rules)
+        build_capa_summary(sample, tmp_path / "a", rules_path=rules)
+        rule_file.write_text("rule: v2")
+        build_capa_summary(sample, tmp_path / "a", rules_path=rules)
+
+        assert len(calls) == 2
+
+    def test_backend_is_part_of_the_key(self, tmp_path, sample, monkeypatch):
+        calls = []
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", self.counting_analyze(calls))
+        context = GhidraCapaContext(program=object(), flat_api=object(), monitor=object())
+
+        build_capa_summary(sample, tmp_path / "a")
+        build_capa_summary(sample, tmp_path / "a", ghidra_context=context)
+        build_capa_summary(sample, tmp_path / "a", ghidra_context=context)
+
+        assert len(calls) == 2
+
+    def test_ghidra_fallback_is_cached_as_vivisect(self, tmp_path, sample, monkeypatch):
+        calls = []
+
+        def fake_analyze(binary_path, rules_path, ghidra_context=None, budget=None):
+            calls.append(ghidra_context)
+            if ghidra_context is not None:
+                raise RuntimeError("ghidra backend unavailable")
+            return make_doc(["create process"]), ["rule"]
+
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", fake_analyze)
+        context = GhidraCapaContext(program=object(), flat_api=object(), monitor=object())
+
+        build_capa_summary(sample, tmp_path / "a", ghidra_context=context)
+        build_capa_summary(sample, tmp_path / "a")
+
+        assert calls == [context, None]
+
+    def test_partial_results_are_not_cached(self, tmp_path, sample, monkeypatch):
+        calls = []
+
+        def fake_analyze(binary_path, rules_path, ghidra_context=None, budget=None):
+            calls.append(binary_path)
+            budget.timed_out = True
+            return make_doc(["create process"]), ["rule"]
+
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", fake_analyze)
+
+        build_capa_summary(sample, tmp_path / "a", time_budget=1.0)
+        build_capa_summary(sample, tmp_path / "b", time_budget=1.0)
+
+        assert len(calls) == 2
+
+    def test_cache_can_be_disabled(self, tmp_path, sample, monkeypatch):
+        calls = []
+        monkeypatch.setattr(capa_runner, "_analyze_with_capa", self.counting_analyze(calls))
+        monkeypatch.setenv("CAPA_CACHE_DISABLE", "1")
+
+        build_capa_summary(sample, tmp_path / "a")
+        build_capa_summary(sample, tmp_path / "b")
+
+        assert len(calls) == 2
+        assert not (tmp_path / "capa-cache").exists()
+
+
+class FakeFunctionHandle:
+    def __init__(self, address):
+        self.address = address
+
+
+class FakeExtractor:
+    def __init__(self, addresses):
+        self.addresses = addresses
+
+    def get_functions(self):
+        for address in self.addresses:
+            yield FakeFunctionHandle(address)
+
+    def extract_function_features(self, fh):
+        return iter([("feature", fh.address)])
+
+    def get_basic_blocks(self, fh):
+        return iter(["bb"])
+
+
+class TestCapaBudget:
+    """Test the deadline / function-scope wrapper around capa extractors."""
+
+    def test_function_scope_filters_functions(self):
+        extractor = FakeExtractor([0x1000, 0x2000, 0x3000])
+        budget = _CapaBudget(None, {0x2000})
+        budget.install(extractor)
+
+        assert [fh.address for fh in extractor.get_functions()] == [0x2000]
+        assert budget.describe()["partial"] is True
+
+    def test_expired_deadline_skips_remaining_functions(self):
+        extractor = FakeExtractor([0x1000, 0x2000])
+        budget = _CapaBudget(60.0, None)
+        budget.install(extractor)
+
+        first, second = list(extractor.get_functions())
+        assert list(extractor.extract_function_features(first)) == [("feature", 0x1000)]
+
+        budget.deadline = 0
+        assert list(extractor.extract_function_features(second)) == []
+        assert list(extractor.get_basic_blocks(second)) == []
+
+        described = budget.describe()
+        assert described["timed_out"] is True
+        assert described["functions_analyzed"] == 1
+        assert described["functions_skipped"] == 1
+
+    def test_unbounded_budget_is_not_partial(self):
+        budget = _CapaBudget(None, None)
+        assert budget.describe()["partial"] is False
+
+
+def test_select_capa_functions_prefers_complex_functions():
+    functions = [
+        {"ea": "1000", "metrics": {"cyclomatic_complexity": 2, "size_bytes": 500, "instruction_count": 40}},
+        {"ea": "2000", "metrics": {"cyclomatic_complexity": 30, "size_bytes": 100, "instruction_count": 30}},
+        {"ea": "3000", "metrics": {"cyclomatic_complexity": 2, "size_bytes": 900, "instruction_count": 90}},
+        {"ea": "4000", "metrics": {"cyclomatic_complexity": 50, "size_bytes": 6, "instruction_count": 1}},
+        {"ea": "EXTERNAL:00000001", "metrics": {"cyclomatic_complexity": 99}},
+    ]
+
+    assert select_capa_functions(functions, 2) == {0x2000, 0x3000}
+
+
+def test_time_budget_ignores_invalid_values(monkeypatch):
+    monkeypatch.setenv("CAPA_TIMEOUT", "soon")
+    assert resolve_capa_time_budget() is None
+    monkeypatch.setenv("CAPA_TIMEOUT", "90")
+    assert resolve_capa_time_budget() == 90.0
@@ -40,6 +40,12 @@ class DummyResponse:
         self.choices = [DummyChoice(DummyMessage(content))]
 
 
+@pytest.fixture(autouse=True)
+def isolated_llm_cache(tmp_path, monkeypatch):
+    """Keep LLM response cache entries out of the user's cache directory."""
+    monkeypatch.setenv("KERNAGENT_LLM_CACHE_DIR", str(tmp_path / "llm-cache"))
+
+
 @pytest.fixture
 def mock_settings():
     """Create test settings."""
@@ -51,12 +57,6 @@ def mock_settings():
     )
 
 
-@pytest.fixture
-def fixture_archive():
-    """Path to test fixture archive."""
-    return Path(__file__).parent / "fixtures" / "bifrose_archive"
-
-
 class TestArgumentParsing:
     """Test CLI argument parsing."""
 
@@ -142,10 +142,12 @@ class TestEnsureSnapshot:
         result = ensure_snapshot(binary, verbose=False)
         assert result == archive_dir
 
-    def test_extracts_zip_if_archive_missing(self, tmp_path):
-        """Should extract ZIP if archive directory missing."""
+    def test_extracts_zip_if_archive_missing(self, tmp_path, monkeypatch):
+        """Should extract ZIP if archive directory missing and on-demand extraction is off."""
         import zipfile
 
+        monkeypatch.setenv("KERNAGENT_SNAPSHOT_LAZY", "0")
+
         binary = tmp_path / "test.exe"
         binary.touch()
         zip_path = tmp_path / "test_archive.zip"
@@ -191,9 +193,9 @@ class TestEnsureSnapshot:
 class TestSummaryCommand:
     """Test summary command execution."""
 
-    def test_summary_json_output(self, fixture_archive, mock_settings, capsys):
+    def test_summary_json_output(self, archive, mock_settings, capsys):
         """Summary --json should output pruned JSON without LLM call."""
-        run_summary_and_print(fixture_archive, mock_settings, verbose=False, json_output=True)
+        run_summary_and_print(archive, mock_settings, verbose=False, json_output=True)
 
         captured = capsys.readouterr()
         output = json.loads(captured.out)
@@ -202,14 +204,14 @@ class TestSummaryCommand:
         assert "sections" in output
         assert output["file"]["format"]
 
-    def test_summary_llm_analysis(self, fixture_archive, mock_settings, capsys):
+    def test_summary_llm_analysis(self, archive, mock_settings, capsys):
         """Summary without --json should call LLM and print response."""
         with mock.patch("kernagent.cli.LLMClient") as mock_llm_class:
             mock_llm = mock.Mock()
             mock_llm.chat.return_value = DummyResponse("Executive summary: This is malware.")
             mock_llm_class.return_value = mock_llm
 
-            run_summary_and_print(fixture_archive, mock_settings, verbose=False, json_output=False)
+            run_summary_and_print(archive, mock_settings, verbose=False, json_output=False)
 
             captured = capsys.readouterr()
             assert "Executive summary: This is malware." in captured.out
@@ -225,7 +227,7 @@ class TestSummaryCommand:
             payload = json.loads(messages[1]["content"])
             assert "file" in payload
 
-    def test_summary_llm_failure(self, fixture_archive, mock_settings):
+    def test_summary_llm_failure(self, archive, mock_settings):
         """Summary should raise on LLM failure."""
         with mock.patch("kernagent.cli.LLMClient") as mock_llm_class:
             mock_llm = mock.Mock()
@@ -233,15 +235,32 @@ class TestSummaryCommand:
             mock_llm_class.return_value = mock_llm
 
             with pytest.raises(Exception, match="API Error"):
-                run_summary_and_print(fixture_archive, mock_settings, verbose=False, json_output=False)
+                run_summary_and_print(archive, mock_settings, verbose=False, json_output=False)
+
+
+    def test_summary_rerun_uses_response_cache(self, archive, mock_settings, capsys):
+        """An unchanged summary rerun should not call the LLM again unless --no-cache is set."""
+        with mock.patch("kernagent.cli.LLMClient") as mock_llm_class:
+            mock_llm = mock.Mock()
+            mock_llm.chat.return_value = DummyResponse("Cached summary")
+            mock_llm_class.return_value = mock_llm
+
+            run_summary_and_print(archive, mock_settings, verbose=False)
+            run_summary_and_print(archive, mock_settings, verbose=False)
+            assert mock_llm.chat.call_count == 1
+
+            run_summary_and_print(archive, mock_settings, verbose=False, use_cache=False)
+            assert mock_llm.chat.call_count == 2
+
+        assert capsys.readouterr().out.count("Cached summary") == 3
 
 
 class TestOneshotCommand:
     """Test oneshot command execution."""
 
-    def test_oneshot_json_output(self, fixture_archive, mock_settings, capsys):
+    def test_oneshot_json_output(self, archive, mock_settings, capsys):
         """Oneshot --json should output pruned JSON without LLM call."""
-        run_oneshot_and_print(fixture_archive, mock_settings, verbose=False, json_output=True)
+        run_oneshot_and_print(archive, mock_settings, verbose=False, json_output=True)
 
         captured = capsys.readouterr()
         output = json.loads(captured.out)
@@ -249,14 +268,14 @@ class TestOneshotCommand:
         assert "file" in output
         assert "sections" in output
 
-    def test_oneshot_llm_analysis(self, fixture_archive, mock_settings, capsys):
+    def test_oneshot_llm_analysis(self, archive, mock_settings, capsys):
         """Oneshot without --json should call LLM with ONESHOT_SYSTEM_PROMPT."""
         with mock.patch("kernagent.cli.LLMClient") as mock_llm_class:
             mock_llm = mock.Mock()
             mock_llm.chat.return_value = DummyResponse("Classification: Backdoor trojan")
             mock_llm_class.return_value = mock_llm
 
-            run_oneshot_and_print(fixture_archive, mock_settings, verbose=False, json_output=False)
+            run_oneshot_and_print(archive, mock_settings, verbose=False, json_output=False)
 
             captured = capsys.readouterr()
             assert "Classification: Backdoor trojan" in captured.out
@@ -270,21 +289,21 @@ class TestOneshotCommand:
 class TestAskCommand:
     """Test ask command execution."""
 
-    def test_ask_invokes_agent(self, fixture_archive, mock_settings, capsys):
+    def test_ask_invokes_agent(self, archive, mock_settings, capsys):
         """Ask should invoke agent with question."""
         with mock.patch("kernagent.cli.ReverseEngineeringAgent") as mock_agent_class:
             mock_agent = mock.Mock()
             mock_agent.run.return_value = "The binary is a network backdoor."
             mock_agent_class.return_value = mock_agent
 
-            run_agent_and_print(fixture_archive, "What is this binary?", mock_settings, verbose=True)
+            run_agent_and_print(archive, "What is this binary?", mock_settings, verbose=True)
 
             captured = capsys.readouterr()
             assert "The binary is a network backdoor." in captured.out
 
             mock_agent.run.assert_called_once_with("What is this binary?", verbose=True)
 
-    def test_ask_creates_snapshot_tools(self, fixture_archive, mock_settings):
+    def test_ask_creates_snapshot_tools(self, archive, mock_settings):
         """Ask should create SnapshotTools with archive directory."""
         with mock.patch("kernagent.cli.SnapshotTools") as mock_snapshot_class:
             with mock.patch("kernagent.cli.ReverseEngineeringAgent") as mock_agent_class:
@@ -293,9 +312,9 @@ class TestAskCommand:
                     mock_agent.run.return_value = "Answer"
                     mock_agent_class.return_value = mock_agent
 
-                    run_agent_and_print(fixture_archive, "Test question", mock_settings, verbose=False)
+                    run_agent_and_print(archive, "Test question", mock_settings, verbose=False)
 
-                    mock_snapshot_class.assert_called_once_with(fixture_archive)
+                    mock_snapshot_class.assert_called_once_with(archive)
 
 
 class TestSettingsOverride:
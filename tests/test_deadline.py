@@ -0,0 +1,160 @@
+"""Tests for per-tool deadlines and cooperative cancellation."""
+
+import threading
+import time
+
+import pytest
+
+from kernagent import deadline as deadline_module
+from kernagent.agent import ReverseEngineeringAgent
+from kernagent.deadline import (
+    Deadline,
+    ToolTimeoutError,
+    call_with_deadline,
+    cancelled,
+    deadline_scope,
+    tool_timeout_from_env,
+)
+from kernagent.prefetch import Prefetcher
+from kernagent.snapshot import SnapshotTools
+
+from conftest import ScriptedLLM, response, tool_call
+
+
+@pytest.fixture(autouse=True)
+def no_prefetch(monkeypatch):
+    monkeypatch.setenv("KERNAGENT_PREFETCH", "0")
+
+
+class TestDeadline:
+    """Deadline bookkeeping and the thread-local scope."""
+
+    def test_cancelled_only_inside_an_expired_scope(self):
+        assert not cancelled()
+        expired = Deadline(0.001)
+        time.sleep(0.01)
+        with deadline_scope(expired):
+            assert cancelled()
+            with deadline_scope(Deadline(None)):
+                assert not cancelled()
+        assert not cancelled()
+
+    def test_timeout_from_environment(self, monkeypatch):
+        monkeypatch.delenv("KERNAGENT_TOOL_TIMEOUT", raising=False)
+        assert tool_timeout_from_env() == 30.0
+        monkeypatch.setenv("KERNAGENT_TOOL_TIMEOUT", "0")
+        assert tool_timeout_from_env() == 0.0
+        monkeypatch.setenv("KERNAGENT_TOOL_TIMEOUT", "soon")
+        assert tool_timeout_from_env() == 30.0
+
+
+class TestCallWithDeadline:
+    """Handlers run under a deadline on a worker thread."""
+
+    def test_returns_result_and_propagates_errors(self):
+        assert call_with_deadline(lambda value: value * 2, {"value": 21}, 1.0) == 42
+        with pytest.raises(KeyError):
+            call_with_deadline(lambda: {}["missing"], {}, 1.0)
+
+    def test_cooperative_handler_returns_partial_result(self):
+        def scan():
+            seen = 0
+            while not cancelled():
+                seen += 1
+                time.sleep(0.001)
+            return {"seen": seen, "timed_out": True}
+
+        assert call_with_deadline(scan, {}, 0.05)["timed_out"]
+
+    def test_stuck_handler_is_abandoned(self):
+        release = threading.Event()
+        started = time.monotonic()
+        with pytest.raises(ToolTimeoutError):
+            call_with_deadline(lambda: release.wait(5), {}, 0.05, grace=0.05)
+        assert time.monotonic() - started < 1
+        release.set()
+
+
+class TestSnapshotToolsCancellation:
+    """Long scans stop early and flag the partial result."""
+
+    def test_search_decomp_returns_partial_matches(self, archive, monkeypatch):
+        tools = SnapshotTools(archive)
+        full = tools.search_decomp("return", limit=500)
+        checks = iter([False] * 5)
+        monkeypatch.setattr("kernagent.snapshot.tools.cancelled", lambda: next(checks, True))
+
+        partial = tools.search_decomp("return", limit=500)
+
+        assert partial["timed_out"] and partial["truncated"]
+        assert partial["count"] < full["count"]
+        assert "timed_out" not in full
+
+    def test_search_data_returns_partial_matches(self, archive, monkeypatch):
+        tools = SnapshotTools(archive)
+        full = tools.search_data(limit=500)
+        checks = iter([False] * 5)
+        monkeypatch.setattr("kernagent.snapshot.tools.cancelled", lambda: next(checks, True))
+
+        partial = tools.search_data(limit=500)
+
+        assert partial["timed_out"] and partial["truncated"]
+        assert partial["count"] == 5 < full["count"]
+        assert "timed_out" not in full
+
+    def test_catastrophic_pattern_is_rejected_within_the_deadline(self, archive):
+        tools = SnapshotTools(archive)
+        started = time.monotonic()
+
+        result = call_with_deadline(tools.search_decomp, {"pattern": r"(\w+\s?)*$"}, 1.0, grace=0.5)
+
+        assert "nested quantifiers" in result["error"]
+        assert time.monotonic() - started < 1.5
+        assert tools.search_decomp(r"GetProc\w+")["count"] > 0
+
+    def test_search_functions_under_expired_deadline(self, archive):
+        tools = SnapshotTools(archive)
+        expired = Deadline(0.001)
+        time.sleep(0.01)
+        with deadline_scope(expired):
+            result = tools.search_functions(limit=50)
+        assert result["timed_out"] and result["count"] == 0
+
+
+class TestAgentToolTimeout:
+    """A stuck tool costs one deadline, not the session."""
+
+    def test_timed_out_tool_reports_error_to_model(self, monkeypatch):
+        monkeypatch.setattr(deadline_module, "GRACE_SECONDS", 0.05)
+        release = threading.Event()
+        llm = ScriptedLLM([response(tool_calls=[tool_call("slow")]), response("done")])
+        agent = ReverseEngineeringAgent(
+            llm, [], {"slow": lambda: release.wait(5)}, select_tools=False, tool_timeout=0.05
+        )
+
+        assert agent.run("q") == "done"
+        tool_message = next(message for message in llm.requests[1] if message["role"] == "tool")
+        assert '"timed_out": true' in tool_message["content"]
+        release.set()
+
+    def test_timeout_read_from_environment(self, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_TOOL_TIMEOUT", "7")
+        agent = ReverseEngineeringAgent(ScriptedLLM([]), [], {}, select_tools=False)
+        assert agent.tool_timeout == 7.0
+
+
+class TestPrefetchDeadline:
+    """Prefetches cut short by the deadline are not served."""
+
+    def test_timed_out_prefetch_falls_back_to_real_call(self):
+        def get_xrefs(target, direction="both"):
+            while not cancelled():
+                time.sleep(0.001)
+            return {"xrefs": [], "timed_out": True}
+
+        prefetcher = Prefetcher({"get_xrefs": get_xrefs}, timeout=0.05)
+        try:
+            prefetcher.schedule("search_imports_exports", {}, {"results": [{"name": "CreateFileA"}]})
+            assert prefetcher.take("get_xrefs", {"target": "CreateFileA", "direction": "to"}) is None
+        finally:
+            prefetcher.close()
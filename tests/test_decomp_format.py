@@ -0,0 +1,106 @@
+"""Tests for decompilation normalization."""
+
+
+from kernagent.snapshot import SnapshotTools
+from kernagent.snapshot.decomp_format import estimate_tokens, normalize_decompilation
+
+from conftest import FIXTURE_ARCHIVE
+
+OUTPUT_L = "decomp/10001aa6___output_l.c"
+
+
+SAMPLE = """
+/* WARNING: Removing unreachable block (ram,0x10001234) */
+
+undefined4 FUN_10001000(undefined4 *param_1,int param_2)
+
+{
+  uint uVar1;
+  int iVar2;
+  undefined4 local_10;
+  char local_8 [4];
+
+  uVar1 = (uint)*(byte *)param_1;
+  iVar2 = FUN_10002000((int)(char)uVar1,sizeof(int));
+  if (param_1 == (undefined4 *)0x0) {
+    return DAT_1000c000;
+  }
+  local_8[0] = (char)iVar2 + (char)param_2;
+  return 0;
+}
+"""
+
+
+class TestNormalizeDecompilation:
+    """Rewrite rules on a small hand-written function."""
+
+    def test_strips_warnings_and_keeps_value_casts(self):
+        code = normalize_decompilation(SAMPLE)
+        assert "WARNING" not in code
+        assert "u1 = (uint)*(byte *)a1;" in code  # pointer casts keep the access width
+        assert "l_8[0] = (char)i2 + (char)a2;" in code
+        assert "sizeof(int)" in code
+        assert "a1 == NULL" in code
+
+    def test_shortens_auto_names_and_types(self):
+        code = normalize_decompilation(SAMPLE)
+        assert "u32 FUN_10001000(u32 *a1,int a2)" in code
+        assert "i2 = FUN_10002000((int)(char)u1,sizeof(int));" in code
+        assert "DAT_1000c000" in code
+
+    def test_drops_unused_locals(self):
+        code = normalize_decompilation(SAMPLE)
+        assert "local_10" not in code and "l_10" not in code
+        assert "char l_8 [4];" in code
+
+    def test_strips_only_casts_to_the_declared_type(self):
+        code = normalize_decompilation(
+            "int f(int param_1,uint *param_2)\n\n{\n  int iVar1;\n  uint *puVar2;\n\n"
+            "  puVar2 = (uint *)param_2;\n  iVar1 = (int)((float)param_1 / 2);\n"
+            "  *puVar2 = (uint)param_1;\n  return (int)iVar1;\n}\n"
+        )
+        assert "pu2 = a2;" in code
+        assert "i1 = (int)((float)a1 / 2);" in code
+        assert "*pu2 = (uint)a1;" in code
+        assert "return i1;" in code
+
+    def test_statements_are_not_declarations(self):
+        code = normalize_decompilation("undefined4 FUN_2(void)\n\n{\n  return DAT_10003000;\n}\n")
+        assert "return DAT_10003000;" in code
+        code = normalize_decompilation("void f(void)\n\n{\n  int iVar1;\n\n  g(iVar1);\n  goto LAB_1;\n}\n")
+        assert "goto LAB_1;" in code and "int i1;" in code
+
+    def test_rename_never_collides(self):
+        code = normalize_decompilation("void f(void)\n\n{\n  int u1;\n  int uVar1;\n\n  u1 = uVar1;\n}\n")
+        assert "u1 = uVar1;" in code
+
+    def test_fixture_savings(self):
+        raw = (FIXTURE_ARCHIVE / OUTPUT_L).read_text()
+        assert estimate_tokens(normalize_decompilation(raw)) < estimate_tokens(raw) * 0.9
+
+
+class TestReadDecompilationNormalized:
+    """read_decompilation() normalizes by default and reports the savings."""
+
+    def test_default_is_normalized(self, archive):
+        result = SnapshotTools(archive).read_decompilation(OUTPUT_L)
+        assert result["normalized"] is True
+        assert result["tokens_saved"] > 0
+        assert "uVar" not in result["code"]
+
+    def test_raw_on_request(self, archive):
+        result = SnapshotTools(archive).read_decompilation(OUTPUT_L, normalize=False)
+        assert "normalized" not in result
+        assert result["code"] == (archive / OUTPUT_L).read_text()
+
+    def test_env_disables_default(self, archive, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_DECOMP_NORMALIZE", "0")
+        result = SnapshotTools(archive).read_decompilation(OUTPUT_L)
+        assert "normalized" not in result
+
+    def test_result_is_cached(self, archive):
+        tools = SnapshotTools(archive)
+        first = tools.read_decompilation(OUTPUT_L)
+        first["code"] = "mutated"
+        assert tools.read_decompilation(OUTPUT_L)["code"] != "mutated"
+        assert len(tools._cache["decomp_normalized"]) == 1
@@ -0,0 +1,86 @@
+"""Tests for anchor-based decompilation slicing."""
+
+import re
+
+from kernagent.snapshot import SnapshotTools, build_tool_map
+from kernagent.snapshot.decomp_slice import slice_decompilation
+
+
+SAMPLE = """int FUN_10002000(char *param_1,int param_2)
+
+{
+  int iVar1;
+  int iVar2;
+  HANDLE hFile;
+
+  iVar2 = param_2 * 2;
+  hFile = CreateFileA(param_1,0x40000000,0,0,2,0x80,0);
+  if (hFile == -1) {
+    puts("open failed");
+    return 0;
+  }
+  for (iVar1 = 0; iVar1 < 10; iVar1 = iVar1 + 1) {
+    Sleep(100);
+    Beep(iVar1,iVar2);
+  }
+  WriteFile(hFile,param_1,
+            iVar2,0,0);
+  return 1;
+}
+"""
+
+
+class TestSliceDecompilation:
+    """Slicing rules on a small hand-written function."""
+
+    def test_keeps_anchor_dependencies_and_control(self):
+        result = slice_decompilation(SAMPLE, re.compile(r"\bWriteFile\b"))
+        code = result["code"]
+
+        assert "hFile = CreateFileA(" in code  # backward: defines hFile
+        assert "iVar2 = param_2 * 2;" in code  # backward: defines iVar2
+        assert "            iVar2,0,0);" in code  # whole multi-line statement
+        assert "Sleep(100)" not in code
+        assert "puts, Sleep, Beep" in code  # folded into an outline
+        assert result["anchor_lines"] == [18]
+
+    def test_forward_uses_and_enclosing_blocks(self):
+        code = slice_decompilation(SAMPLE, re.compile(r"\bCreateFileA\b"))["code"]
+
+        assert "if (hFile == -1) {" in code
+        assert "WriteFile(hFile,param_1," in code
+        assert code.count("{") == code.count("}")
+
+    def test_missing_anchor(self):
+        assert slice_decompilation(SAMPLE, re.compile("RegSetValueExA")) is None
+
+
+class TestReadDecompilationSlice:
+    """SnapshotTools.read_decompilation_slice() on the fixture archive."""
+
+    def test_slice_is_much_smaller_than_function(self, archive):
+        result = SnapshotTools(archive).read_decompilation_slice("FUN_10001020", "LoadResource")
+
+        assert result["path"] == "decomp/10001020_FUN_10001020.c"
+        assert "LoadResource(" in result["code"]
+        assert "FindResourceA" in result["code"]
+        assert result["tokens"] < result["tokens_full"] / 2
+
+    def test_resolves_function_by_ea_and_raw_variable_names(self, archive):
+        result = SnapshotTools(archive).read_decompilation_slice("0x10001aa6", "piVar3")
+
+        assert result["function_name"] == "__output_l"
+        assert result["anchor"] == "pi3"
+        assert result["lines"] < result["total_lines"]
+
+    def test_string_text_anchor(self, archive):
+        result = SnapshotTools(archive).read_decompilation_slice("FUN_10001020", "dat")
+        assert "FindResourceA" in result["code"]
+
+    def test_errors(self, archive):
+        tools = SnapshotTools(archive)
+        assert "error" in tools.read_decompilation_slice("no_such_function", "x")
+        assert "not found" in tools.read_decompilation_slice("FUN_10001020", "RegSetValueExA")["error"]
+
+    def test_registered_in_tool_map(self, archive):
+        assert "read_decompilation_slice" in build_tool_map(SnapshotTools(archive))
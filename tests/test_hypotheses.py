@@ -0,0 +1,137 @@
+"""Tests for the parallel hypothesis coordinator."""
+
+import threading
+
+import pytest
+
+from kernagent.hypotheses import HypothesisCoordinator, shared_tool_map
+from kernagent.oneshot import import_capability_buckets
+from kernagent.prompts import HYPOTHESIS_MERGE_SYSTEM_PROMPT
+from kernagent.snapshot import SnapshotTools
+
+from conftest import FIXTURE_ARCHIVE, response, tool_call
+
+
+class HypothesisLLM:
+    """Each sub-agent searches imports once, then reports; the merge call joins reports."""
+
+    def __init__(self, delay=0.02):
+        self.delay = delay
+        self.merge_prompts = []
+        self.active = 0
+        self.max_active = 0
+        self._lock = threading.Lock()
+
+    def chat(self, **kwargs):
+        messages = kwargs["messages"]
+        if messages[0]["content"] == HYPOTHESIS_MERGE_SYSTEM_PROMPT:
+            self.merge_prompts.append(messages[1]["content"])
+            return response("merged")
+
+        with self._lock:
+            self.active += 1
+            self.max_active = max(self.max_active, self.active)
+        threading.Event().wait(self.delay)
+        with self._lock:
+            self.active -= 1
+
+        prompt = messages[1]["content"]
+        capability = prompt.split('the "', 1)[1].split('"', 1)[0]
+        if len(messages) == 2:
+            return response(tool_calls=[tool_call("search_imports_exports", '{"name_pattern": "File"}')])
+        return response(f"Verdict: SUPPORTED ({capability})")
+
+
+@pytest.fixture(autouse=True)
+def no_prefetch(monkeypatch):
+    monkeypatch.setenv("KERNAGENT_PREFETCH", "0")
+
+
+class TestImportBuckets:
+    """Seeds come from the oneshot pruner's import capability buckets."""
+
+    def test_only_detected_capabilities_in_pruner_order(self):
+        buckets = import_capability_buckets(FIXTURE_ARCHIVE)
+        assert list(buckets)[:3] == ["filesystem", "process", "memory_injection"]
+        assert "KERNEL32.DLL!VirtualAlloc" in buckets["memory_injection"]
+        assert all(buckets.values())
+
+    def test_missing_imports_give_no_buckets(self, tmp_path):
+        assert import_capability_buckets(tmp_path) == {}
+
+
+class TestSharedToolMap:
+    """Identical calls from different sub-agents run once."""
+
+    def test_memoizes_except_budgeted_tools(self):
+        calls = []
+        tool_map = {
+            "search_strings": lambda **kwargs: calls.append(("search_strings", kwargs)) or {"results": []},
+            "read_decompilation": lambda **kwargs: calls.append(("read_decompilation", kwargs)) or {"code": ""},
+        }
+        memo, lock = {}, threading.Lock()
+        first = shared_tool_map(tool_map, memo, lock)
+        second = shared_tool_map(tool_map, memo, lock)
+
+        first["search_strings"](pattern="http")
+        second["search_strings"](pattern="http")
+        second["search_strings"](pattern="cmd")
+        first["read_decompilation"](decomp_path="decomp/a.c")
+        second["read_decompilation"](decomp_path="decomp/a.c")
+
+        assert [name for name, _ in calls].count("search_strings") == 2
+        assert [name for name, _ in calls].count("read_decompilation") == 2
+
+    def test_timed_out_results_are_not_memoized(self):
+        replies = [{"results": [], "timed_out": True}, {"results": ["http://c2"]}]
+        tool_map = {"search_strings": lambda **kwargs: replies.pop(0)}
+        memo, lock = {}, threading.Lock()
+        first = shared_tool_map(tool_map, memo, lock)
+        second = shared_tool_map(tool_map, memo, lock)
+
+        assert first["search_strings"](pattern="http")["timed_out"]
+        assert second["search_strings"](pattern="http") == {"results": ["http://c2"]}
+        assert first["search_strings"](pattern="http") == {"results": ["http://c2"]}
+
+
+class TestHypothesisCoordinator:
+    """Fan-out, concurrency and merge."""
+
+    def test_runs_one_sub_agent_per_capability_and_merges_in_order(self):
+        llm = HypothesisLLM()
+        coordinator = HypothesisCoordinator(llm, SnapshotTools(FIXTURE_ARCHIVE), max_hypotheses=3, jobs=3)
+
+        answer = coordinator.run("What does this binary do?")
+
+        assert answer == "merged"
+        merge = llm.merge_prompts[0]
+        assert merge.startswith("Question: What does this binary do?")
+        positions = [merge.index(f"### {cap}") for cap in ("filesystem", "process", "memory_injection")]
+        assert positions == sorted(positions)
+        assert "Verdict: SUPPORTED (process)" in merge
+        assert llm.max_active > 1
+        # Three sub-agents asked the same search; it ran once.
+        assert len(coordinator._memo) == 1
+
+    def test_merge_failure_returns_reports(self):
+        class NoMergeLLM(HypothesisLLM):
+            def chat(self, **kwargs):
+                if kwargs["messages"][0]["content"] == HYPOTHESIS_MERGE_SYSTEM_PROMPT:
+                    raise RuntimeError("endpoint down")
+                return super().chat(**kwargs)
+
+        coordinator = HypothesisCoordinator(NoMergeLLM(delay=0), SnapshotTools(FIXTURE_ARCHIVE), max_hypotheses=2)
+        answer = coordinator.run("What does this binary do?")
+        assert "### filesystem" in answer and "### process" in answer
+
+    def test_falls_back_to_single_agent_without_buckets(self):
+        seen = []
+
+        class SingleLLM:
+            def chat(self, **kwargs):
+                seen.append(kwargs["messages"][1]["content"])
+                return response("single")
+
+        coordinator = HypothesisCoordinator(SingleLLM(), SnapshotTools(FIXTURE_ARCHIVE), max_hypotheses=0)
+        assert coordinator.run("question") == "single"
+        assert seen == ["question"]
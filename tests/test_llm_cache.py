@@ -0,0 +1,133 @@
+"""Tests for the on-disk LLM response cache."""
+
+import os
+import time
+from unittest import mock
+
+import pytest
+
+from kernagent.config import Settings
+from kernagent.llm_cache import ResponseCache, cached_chat_content
+
+
+class DummyResponse:
+    """Minimal chat completion response."""
+
+    def __init__(self, content):
+        self.choices = [mock.Mock(message=mock.Mock(content=content))]
+
+
+@pytest.fixture
+def settings():
+    return Settings(api_key="k", base_url="http://llm/v1", model="model-a", debug=False)
+
+
+@pytest.fixture
+def cache(tmp_path):
+    return ResponseCache(tmp_path / "cache")
+
+
+def messages(system="system prompt", user="payload"):
+    return [{"role": "system", "content": system}, {"role": "user", "content": user}]
+
+
+class TestResponseCacheKey:
+    """Cache keys cover everything that changes the response."""
+
+    def test_key_is_stable(self):
+        assert ResponseCache.make_key("m", "http://x", messages()) == ResponseCache.make_key(
+            "m", "http://x/", messages()
+        )
+
+    @pytest.mark.parametrize(
+        "variant",
+        [
+            ("other-model", "http://x", messages()),
+            ("m", "http://y", messages()),
+            ("m", "http://x", messages(system="other prompt")),
+            ("m", "http://x", messages(user="other payload")),
+        ],
+    )
+    def test_key_changes_with_inputs(self, variant):
+        assert ResponseCache.make_key(*variant) != ResponseCache.make_key("m", "http://x", messages())
+
+
+class TestResponseCacheStorage:
+    """TTL and size limits."""
+
+    def test_roundtrip(self, cache):
+        cache.put("ab" * 32, "hello", "m")
+        assert cache.get("ab" * 32) == "hello"
+        assert cache.get("cd" * 32) is None
+
+    def test_expired_entry_is_dropped(self, tmp_path):
+        cache = ResponseCache(tmp_path, ttl_seconds=10)
+        key = "ab" * 32
+        cache.put(key, "old", "m")
+        with mock.patch("kernagent.llm_cache.time.time", return_value=time.time() + 60):
+            assert cache.get(key) is None
+        assert not cache._path(key).exists()
+
+    def test_eviction_removes_least_recently_used(self, tmp_path):
+        cache = ResponseCache(tmp_path, max_bytes=10**9)
+        keys = [f"{i:02x}" * 32 for i in range(3)]
+        for offset, key in enumerate(keys):
+            cache.put(key, "x" * 200, "m")
+            os.utime(cache._path(key), (1000 + offset, 1000 + offset))
+
+        cache.max_bytes = sum(cache._path(key).stat().st_size for key in keys[1:])
+        cache._evict()
+
+        assert not cache._path(keys[0]).exists()
+        assert cache._path(keys[1]).exists()
+        assert cache._path(keys[2]).exists()
+
+    def test_puts_scan_the_cache_only_past_the_limit(self, tmp_path):
+        cache = ResponseCache(tmp_path, max_bytes=10**9)
+        with mock.patch.object(cache, "_evict", wraps=cache._evict) as evict:
+            for i in range(5):
+                cache.put(f"{i:02x}" * 32, "x" * 200, "m")
+            assert evict.call_count == 1
+
+            cache.max_bytes = cache._path("00" * 32).stat().st_size * 3
+            cache.put("ff" * 32, "x" * 200, "m")
+            assert evict.call_count == 2
+        assert len(list(tmp_path.glob("*/*.json"))) == 3
+
+    def test_from_env_respects_disable(self, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_LLM_CACHE_DISABLE", "1")
+        assert ResponseCache.from_env() is None
+
+
+class TestCachedChatContent:
+    """cached_chat_content() only calls the LLM on a miss."""
+
+    def test_second_call_is_served_from_cache(self, cache, settings):
+        llm = mock.Mock()
+        llm.chat.return_value = DummyResponse("answer")
+
+        first = cached_chat_content(llm, settings, messages(), cache=cache, temperature=0)
+        second = cached_chat_content(llm, settings, messages(), cache=cache, temperature=0)
+
+        assert first == second == "answer"
+        llm.chat.assert_called_once()
+
+    def test_model_change_misses(self, cache, settings):
+        llm = mock.Mock()
+        llm.chat.return_value = DummyResponse("answer")
+
+        cached_chat_content(llm, settings, messages(), cache=cache, temperature=0)
+        settings.model = "model-b"
+        cached_chat_content(llm, settings, messages(), cache=cache, temperature=0)
+
+        assert llm.chat.call_count == 2
+
+    def test_non_deterministic_calls_are_not_cached(self, cache, settings):
+        llm = mock.Mock()
+        llm.chat.return_value = DummyResponse("answer")
+
+        cached_chat_content(llm, settings, messages(), cache=cache, temperature=0.7)
+        cached_chat_content(llm, settings, messages(), cache=cache, temperature=0.7)
+
+        assert llm.chat.call_count == 2
+        assert not list(cache.root.glob("*/*.json"))
@@ -0,0 +1,164 @@
+"""Tests for per-phase model routing and escalation."""
+
+from types import SimpleNamespace
+from unittest import mock
+
+import pytest
+
+from kernagent import llm_client
+from kernagent.agent import ReverseEngineeringAgent
+from kernagent.config import Settings, load_settings
+from kernagent.llm_cache import ResponseCache, cached_chat_content
+
+from conftest import response, tool_call
+
+
+class RoutedLLM:
+    """Records the phase of every request and replies from a per-phase script."""
+
+    def __init__(self, scripts, escalations=None):
+        self.scripts = {phase: list(replies) for phase, replies in scripts.items()}
+        self.escalations = escalations if escalations is not None else {"explore": "synthesis"}
+        self.phases = []
+
+    def escalation(self, phase):
+        return self.escalations.get(phase)
+
+    def chat(self, verbose=False, phase=None, **kwargs):
+        self.phases.append(phase)
+        reply = self.scripts[phase].pop(0)
+        if isinstance(reply, Exception):
+            raise reply
+        return reply
+
+
+@pytest.fixture(autouse=True)
+def no_prefetch(monkeypatch):
+    monkeypatch.setenv("KERNAGENT_PREFETCH", "0")
+
+
+class TestRoutes:
+    """Settings resolve a model and endpoint per phase."""
+
+    def test_phase_overrides_fall_back_to_defaults(self):
+        settings = Settings(model="big", base_url="http://cloud/v1", api_key="k", routes={"explore": {"model": "small"}})
+        assert settings.route("explore").model == "small"
+        assert settings.route("explore").base_url == "http://cloud/v1"
+        assert settings.route("synthesis").model == "big"
+        assert settings.route().model == "big"
+
+    def test_routes_loaded_from_environment(self, monkeypatch):
+        monkeypatch.setenv("OPENAI_MODEL_EXPLORE", "qwen-4b")
+        monkeypatch.setenv("OPENAI_BASE_URL_EXPLORE", "http://localhost:1234/v1")
+        monkeypatch.delenv("OPENAI_MODEL_SYNTHESIS", raising=False)
+        with mock.patch("kernagent.config.load_dotenv", None):
+            settings = load_settings()
+        assert settings.routes["explore"] == {"model": "qwen-4b", "base_url": "http://localhost:1234/v1"}
+        assert "synthesis" not in settings.routes
+
+
+class TestLLMClientRouting:
+    """Requests go to the phase's model and endpoint."""
+
+    def test_chat_uses_phase_route_and_reports_escalation(self):
+        created = []
+
+        class FakeOpenAI:
+            def __init__(self, api_key, base_url):
+                self.base_url = base_url
+                self.chat = SimpleNamespace(
+                    completions=SimpleNamespace(create=lambda **kwargs: created.append((base_url, kwargs["model"])))
+                )
+
+        settings = Settings(
+            model="big",
+            base_url="http://cloud/v1",
+            api_key="k",
+            routes={"explore": {"model": "small", "base_url": "http://local/v1"}},
+        )
+        with mock.patch.object(llm_client, "OpenAI", FakeOpenAI):
+            client = llm_client.LLMClient(settings)
+            client.chat(phase="explore", messages=[])
+            client.chat(phase="synthesis", messages=[])
+            client.chat(messages=[])
+
+        assert created == [("http://local/v1", "small"), ("http://cloud/v1", "big"), ("http://cloud/v1", "big")]
+        assert client.escalation("explore") == "synthesis"
+        assert client.escalation("synthesis") is None
+
+    def test_no_escalation_when_phases_share_a_model(self):
+        with mock.patch.object(llm_client, "OpenAI", lambda **kwargs: None):
+            client = llm_client.LLMClient(Settings(model="only"))
+        assert client.escalation("explore") is None
+        assert client.escalation("oneshot") is None
+
+
+class TestAgentRouting:
+    """Exploration on the cheap model, final answer and failures on the strong one."""
+
+    def test_final_answer_comes_from_synthesis_model(self):
+        llm = RoutedLLM(
+            {
+                "explore": [response(tool_calls=[tool_call("echo")]), response("draft")],
+                "synthesis": [response("final")],
+            }
+        )
+        agent = ReverseEngineeringAgent(llm, [], {"echo": lambda: {"ok": True}}, select_tools=False)
+
+        assert agent.run("q") == "final"
+        assert llm.phases == ["explore", "explore", "synthesis"]
+
+    def test_failure_escalates_for_rest_of_session(self):
+        llm = RoutedLLM(
+            {
+                "explore": [response(tool_calls=[tool_call("no_such_tool")])],
+                "synthesis": [response(tool_calls=[tool_call("echo")]), response("answer")],
+            }
+        )
+        agent = ReverseEngineeringAgent(llm, [], {"echo": lambda: {"ok": True}}, select_tools=False)
+
+        assert agent.run("q") == "answer"
+        assert llm.phases == ["explore", "synthesis", "synthesis"]
+
+    def test_api_error_escalates(self):
+        llm = RoutedLLM({"explore": [RuntimeError("local server down")], "synthesis": [response("answer")]})
+        agent = ReverseEngineeringAgent(llm, [], {}, select_tools=False)
+        assert agent.run("q") == "answer"
+
+    def test_without_routing_behaviour_is_unchanged(self):
+        llm = RoutedLLM({"explore": [RuntimeError("down")]}, escalations={})
+        agent = ReverseEngineeringAgent(llm, [], {}, select_tools=False)
+        assert agent.run("q") == "LLM Error: down"
+        assert llm.phases == ["explore"]
+
+
+class TestOneshotEscalation:
+    """Cached oneshot calls retry on the synthesis model."""
+
+    def test_empty_reply_is_retried_on_escalation_phase(self):
+        llm = RoutedLLM(
+            {"oneshot": [response("")], "synthesis": [response("report")]},
+            escalations={"oneshot": "synthesis"},
+        )
+        settings = Settings(model="m", base_url="http://llm/v1")
+        content = cached_chat_content(llm, settings, [{"role": "user", "content": "x"}], phase="oneshot", temperature=0)
+        assert content == "report"
+        assert llm.phases == ["oneshot", "synthesis"]
+
+    def test_escalated_reply_is_cached_under_the_producing_model(self, tmp_path):
+        cache = ResponseCache(tmp_path)
+        messages = [{"role": "user", "content": "x"}]
+        settings = Settings(model="big", base_url="http://llm/v1", routes={"oneshot": {"model": "small"}})
+        llm = RoutedLLM(
+            {"oneshot": [response("")], "synthesis": [response("big report")]},
+            escalations={"oneshot": "synthesis"},
+        )
+
+        assert cached_chat_content(llm, settings, messages, cache=cache, phase="oneshot", temperature=0) == "big report"
+        assert cache.get(cache.make_key("small", "http://llm/v1", messages, temperature=0)) is None
+        assert cache.get(cache.make_key("big", "http://llm/v1", messages, temperature=0)) == "big report"
+
+        # The small model is asked again; when it fails again the cached escalation is reused.
+        llm.scripts["oneshot"] = [response("")]
+        assert cached_chat_content(llm, settings, messages, cache=cache, phase="oneshot", temperature=0) == "big report"
+        assert llm.phases == ["oneshot", "synthesis", "oneshot"]
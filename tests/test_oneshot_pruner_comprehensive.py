@@ -1,8 +1,5 @@
 """Comprehensive tests for oneshot pruner logic."""
 
-from pathlib import Path
-
-import pytest
 
 from kernagent.oneshot.pruner import (
     MAX_KEY_FUNCTIONS,
@@ -22,12 +19,6 @@ from kernagent.oneshot.pruner import (
 )
 
 
-@pytest.fixture
-def fixture_archive():
-    """Path to test fixture archive."""
-    return Path(__file__).parent / "fixtures" / "bifrose_archive"
-
-
 class TestStringClassification:
     """Test _classify_string() for different string types."""
 
@@ -560,9 +551,9 @@ class TestHelperFunctions:
 class TestBuildOneshotSummary:
     """Test the main build_oneshot_summary() function."""
 
-    def test_builds_summary_from_fixture(self, fixture_archive):
+    def test_builds_summary_from_fixture(self, archive):
         """Should build complete summary from test fixture."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         # Verify top-level structure
         assert "file" in summary
@@ -572,9 +563,9 @@ class TestBuildOneshotSummary:
         assert "key_functions" in summary
         assert "suspicion_signals" in summary
 
-    def test_summary_file_info(self, fixture_archive):
+    def test_summary_file_info(self, archive):
         """File info should include required fields."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         file_info = summary["file"]
         assert "sha256" in file_info
@@ -582,23 +573,23 @@ class TestBuildOneshotSummary:
         assert "arch" in file_info
         assert "size" in file_info
 
-    def test_summary_respects_max_strings(self, fixture_archive):
+    def test_summary_respects_max_strings(self, archive):
         """Summary should respect MAX_STRINGS limit."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         # interesting_strings is a list, not a dict by kind
         total_strings = len(summary["interesting_strings"])
         assert total_strings <= MAX_STRINGS
 
-    def test_summary_respects_max_functions(self, fixture_archive):
+    def test_summary_respects_max_functions(self, archive):
         """Summary should respect MAX_KEY_FUNCTIONS limit."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         assert len(summary["key_functions"]) <= MAX_KEY_FUNCTIONS
 
-    def test_summary_includes_suspicion_signals(self, fixture_archive):
+    def test_summary_includes_suspicion_signals(self, archive):
         """Summary should include suspicion signals."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         signals = summary["suspicion_signals"]
         assert "uses_network" in signals
@@ -606,25 +597,25 @@ class TestBuildOneshotSummary:
         assert "spawns_processes_or_shell" in signals
         assert isinstance(signals["uses_network"], bool)
 
-    def test_summary_imports_by_capability(self, fixture_archive):
+    def test_summary_imports_by_capability(self, archive):
         """Summary should include imports."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         imports = summary["imports"]
         assert isinstance(imports, dict)
         # Should have capability categories
         assert isinstance(imports, dict)
 
-    def test_summary_interesting_strings(self, fixture_archive):
+    def test_summary_interesting_strings(self, archive):
         """Summary should include interesting strings."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         interesting_strings = summary["interesting_strings"]
         assert isinstance(interesting_strings, list)
 
-    def test_summary_key_functions_structure(self, fixture_archive):
+    def test_summary_key_functions_structure(self, archive):
         """Key functions should have expected structure."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
 
         key_functions = summary["key_functions"]
         if key_functions:
@@ -634,17 +625,17 @@ class TestBuildOneshotSummary:
             assert "name" in func
             assert "size_bytes" in func or "cyclomatic_complexity" in func
 
-    def test_summary_includes_capa_when_available(self, fixture_archive):
+    def test_summary_includes_capa_when_available(self, archive):
         """CAPA highlights should be merged when capa_summary.json exists."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
         assert "capa" in summary
         capa = summary["capa"]
         assert capa["top_rules"], "Expected at least one CAPA rule highlight"
         assert capa["counts"]["rules"] >= len(capa["top_rules"])
 
-    def test_summary_capa_highlights_shape(self, fixture_archive):
+    def test_summary_capa_highlights_shape(self, archive):
         """CAPA highlights should expose top tactics and attack IDs."""
-        summary = build_oneshot_summary(fixture_archive)
+        summary = build_oneshot_summary(archive)
         capa = summary.get("capa")
         assert capa is not None
         highlights = capa.get("highlights") or {}
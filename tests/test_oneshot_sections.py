@@ -0,0 +1,131 @@
+"""Tests for sectioned oneshot analysis."""
+
+import threading
+from unittest import mock
+
+from kernagent.cli import build_parser, run_oneshot_and_print
+from kernagent.config import Settings
+from kernagent.llm_cache import ResponseCache
+from kernagent.oneshot import build_oneshot_summary
+from kernagent.oneshot.sections import merge_payload, run_sectioned_oneshot, split_summary
+from kernagent.prompts import ONESHOT_MERGE_SYSTEM_PROMPT
+
+from conftest import response
+
+
+class SectionLLM:
+    """Replies per section, slowest first, and records the merge prompt."""
+
+    DELAYS = {"capabilities": 0.06, "strings": 0.04, "functions": 0.02, "capa": 0.0}
+
+    def __init__(self, fail=()):
+        self.fail = set(fail)
+        self.merge_prompts = []
+        self.section_payloads = {}
+        self.active = 0
+        self.max_active = 0
+        self._lock = threading.Lock()
+
+    def chat(self, **kwargs):
+        system, user = (message["content"] for message in kwargs["messages"])
+        if system == ONESHOT_MERGE_SYSTEM_PROMPT:
+            self.merge_prompts.append(user)
+            if "merge" in self.fail:
+                raise RuntimeError("merge down")
+            return response("## Summary\nmerged")
+
+        section = system.split("Section: ", 1)[1].split("\n", 1)[0]
+        with self._lock:
+            self.section_payloads[section] = user
+            self.active += 1
+            self.max_active = max(self.max_active, self.active)
+        threading.Event().wait(self.DELAYS[section])
+        with self._lock:
+            self.active -= 1
+        if section in self.fail:
+            raise RuntimeError("section down")
+        return response(f"- {section} finding")
+
+
+class TestSplitSummary:
+    """Sections carry their keys plus file metadata, in merge order."""
+
+    def test_fixture_sections(self, archive):
+        summary = build_oneshot_summary(archive)
+        sections = dict(split_summary(summary))
+
+        assert list(sections)[:3] == ["capabilities", "strings", "functions"]
+        assert set(sections["capabilities"]) == {"file", "imports", "sections", "suspicion_signals"}
+        assert set(sections["functions"]) == {"file", "key_functions"}
+
+    def test_empty_sections_are_skipped(self):
+        summary = {
+            "file": {"name": "a.exe"},
+            "imports": {"network": [], "crypto": []},
+            "interesting_strings": [{"value": "http://x"}],
+            "possible_configs": [],
+            "key_functions": [],
+        }
+        assert [name for name, _ in split_summary(summary)] == ["strings"]
+
+
+class TestSectionedOneshot:
+    """Concurrent sections, deterministic merge."""
+
+    def _summary(self):
+        return {
+            "file": {"name": "a.exe"},
+            "imports": {"network": ["WS2_32!connect"]},
+            "suspicion_signals": {"uses_network": True},
+            "interesting_strings": [{"value": "http://x"}],
+            "key_functions": [{"name": "FUN_1"}],
+            "capa": {"rules": ["connect TCP socket"]},
+        }
+
+    def test_sections_run_concurrently_and_merge_in_fixed_order(self):
+        llm = SectionLLM()
+        content = run_sectioned_oneshot(llm, Settings(), self._summary(), jobs=4)
+
+        assert content == "## Summary\nmerged"
+        assert llm.max_active > 1
+        merge = llm.merge_prompts[0]
+        positions = [merge.index(f"### {name}\n- {name} finding") for name in ("capabilities", "strings", "functions", "capa")]
+        assert positions == sorted(positions)
+        assert '"uses_network": true' in merge
+        assert "FUN_1" not in llm.section_payloads["strings"]
+
+    def test_merge_prompt_is_stable_across_completion_order(self):
+        summary = self._summary()
+        reports = [("capabilities", "a"), ("strings", "b")]
+        assert merge_payload(summary, reports) == merge_payload(dict(reversed(list(summary.items()))), reports)
+
+    def test_failures_degrade_to_section_reports(self):
+        llm = SectionLLM(fail={"strings", "merge"})
+        content = run_sectioned_oneshot(llm, Settings(), self._summary(), jobs=2)
+
+        assert "### capabilities\n- capabilities finding" in content
+        assert "### strings\n(section analysis failed: section down)" in content
+
+    def test_sections_are_cached_individually(self, tmp_path):
+        cache = ResponseCache(tmp_path)
+        run_sectioned_oneshot(SectionLLM(), Settings(), self._summary(), cache=cache)
+
+        llm = SectionLLM()
+        summary = self._summary()
+        summary["key_functions"] = [{"name": "FUN_2"}]
+        run_sectioned_oneshot(llm, Settings(), summary, cache=cache)
+
+        assert list(llm.section_payloads) == ["functions"]
+
+
+class TestOneshotCli:
+    """`oneshot --sectioned`."""
+
+    def test_parser_flags(self):
+        args = build_parser().parse_args(["oneshot", "/bin/sample", "--sectioned", "--jobs", "2"])
+        assert args.sectioned and args.jobs == 2
+
+    def test_sectioned_output(self, archive, capsys):
+        with mock.patch("kernagent.cli.LLMClient", return_value=SectionLLM()):
+            run_oneshot_and_print(archive, Settings(), verbose=False, use_cache=False, sectioned=True)
+        assert "merged" in capsys.readouterr().out
@@ -0,0 +1,187 @@
+"""Tests for speculative tool prefetching in the agent loop."""
+
+import threading
+
+from kernagent.agent import ReverseEngineeringAgent
+from kernagent.prefetch import Prefetcher, predict_calls
+from kernagent.snapshot import SnapshotTools, build_prefetch_warmers, build_tool_map
+
+from conftest import ScriptedLLM
+
+
+class TestPredictCalls:
+    """Follow-up calls predicted from tool results."""
+
+    def test_search_hits_predict_decompilation_and_xrefs(self):
+        result = {
+            "results": [
+                {"ea": "0x1", "name": "FUN_1", "decomp_path": "decomp/1.c"},
+                {"ea": "0x2", "name": "FUN_2", "decomp_path": None},
+            ]
+        }
+        calls = predict_calls("search_functions", result, top=2)
+        assert ("read_decompilation", {"decomp_path": "decomp/1.c"}) in calls
+        assert ("get_xrefs", {"target": "FUN_1"}) in calls
+        assert ("get_xrefs", {"target": "FUN_2"}) in calls
+        assert not any(args.get("decomp_path") is None for name, args in calls if name == "read_decompilation")
+
+    def test_top_limits_hits_and_errors_predict_nothing(self):
+        result = {"results": [{"name": f"FUN_{i}"} for i in range(10)]}
+        assert len(predict_calls("find_relevant", result, top=3)) == 3
+        assert predict_calls("search_functions", {"error": "boom"}) == []
+        assert predict_calls("trace_calls", {"results": [{"name": "x"}]}) == []
+
+    def test_string_hits_predict_referencing_functions(self):
+        result = {
+            "results": [
+                {
+                    "address": "0x1000",
+                    "xref_functions": [{"function": "FUN_1"}, {"function": "unknown"}, {"function": "FUN_1"}],
+                }
+            ]
+        }
+        assert predict_calls("search_strings", result) == [
+            ("get_xrefs", {"target": "0x1000"}),
+            ("get_function", {"identifier": "FUN_1"}),
+        ]
+
+
+class TestPrefetcher:
+    """Background execution and hand-off of predicted calls."""
+
+    def test_pure_result_is_served_once_with_defaults_matching(self):
+        calls = []
+
+        def get_xrefs(target, direction="both", limit=100):
+            calls.append(target)
+            return {"target": target}
+
+        prefetcher = Prefetcher({"get_xrefs": get_xrefs})
+        try:
+            assert prefetcher.schedule("find_relevant", {}, {"results": [{"name": "FUN_1"}]}) == 1
+            assert prefetcher.take("get_xrefs", {"target": "FUN_1", "direction": "both"}) == {"target": "FUN_1"}
+            assert prefetcher.take("get_xrefs", {"target": "FUN_1"}) is None
+            assert prefetcher.take("get_xrefs", {"target": "FUN_1", "direction": "to"}) is None
+        finally:
+            prefetcher.close()
+        assert calls == ["FUN_1"]
+        assert prefetcher.stats["hits"] == 1
+
+    def test_warmed_tools_are_never_served(self):
+        warmed = []
+        prefetcher = Prefetcher(
+            {"read_decompilation": lambda decomp_path, max_tokens=None: {"code": "x"}},
+            warmers={"read_decompilation": lambda decomp_path, **_: warmed.append(decomp_path)},
+        )
+        try:
+            prefetcher.schedule("get_function", {}, {"decomp_path": "decomp/1.c"})
+            assert prefetcher.take("read_decompilation", {"decomp_path": "decomp/1.c"}) is None
+        finally:
+            prefetcher.close()
+        assert warmed == ["decomp/1.c"]
+
+    def test_tools_without_warmer_or_purity_are_not_prefetched(self):
+        prefetcher = Prefetcher({"read_decompilation": lambda decomp_path: {"code": "x"}})
+        try:
+            assert prefetcher.schedule("get_function", {}, {"decomp_path": "decomp/1.c"}) == 0
+        finally:
+            prefetcher.close()
+
+    def test_discard_drops_unstarted_predictions(self):
+        gate = threading.Event()
+
+        def get_xrefs(target):
+            gate.wait(5)
+            return {"target": target}
+
+        prefetcher = Prefetcher({"get_xrefs": get_xrefs}, workers=1)
+        try:
+            hits = {"results": [{"name": "FUN_1"}, {"name": "FUN_2"}]}
+            assert prefetcher.schedule("find_relevant", {}, hits) == 2
+            prefetcher.discard_pending()
+            gate.set()
+            assert prefetcher.stats["discarded"] == 1
+            assert prefetcher.take("get_xrefs", {"target": "FUN_1"}) == {"target": "FUN_1"}
+            assert prefetcher.take("get_xrefs", {"target": "FUN_2"}) is None
+        finally:
+            prefetcher.close()
+
+    def test_disabled_by_env(self, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_PREFETCH", "0")
+        assert Prefetcher.from_env({}) is None
+        monkeypatch.setenv("KERNAGENT_PREFETCH", "1")
+        monkeypatch.setenv("KERNAGENT_PREFETCH_WORKERS", "0")
+        assert Prefetcher.from_env({}) is None
+
+
+class TestAgentPrefetch:
+    """The agent overlaps predicted tool calls with model inference."""
+
+    def test_prefetched_result_replaces_tool_call(self, monkeypatch):
+        monkeypatch.delenv("KERNAGENT_PREFETCH", raising=False)
+        xref_calls = []
+        seen_during_inference = []
+
+        def get_xrefs(target, direction="both"):
+            xref_calls.append(target)
+            return {"xrefs": [], "target": target}
+
+        def on_chat(turn):
+            # The second completion starts after search results came back: the
+            # prediction is already running while the model "thinks".
+            if turn == 1:
+                for _ in range(100):
+                    if xref_calls:
+                        break
+                    threading.Event().wait(0.01)
+                seen_during_inference.append(list(xref_calls))
+
+        llm = ScriptedLLM(
+            [("find_relevant", '{"query": "resource"}'), ("get_xrefs", '{"target": "FUN_1"}')],
+            on_chat=on_chat,
+        )
+        tool_map = {
+            "find_relevant": lambda query, k=10: {"results": [{"name": "FUN_1", "ea": "0x1"}]},
+            "get_xrefs": get_xrefs,
+        }
+        agent = ReverseEngineeringAgent(llm=llm, tools_spec=[], tool_map=tool_map, select_tools=False)
+
+        assert agent.run("where are resources loaded?") == "done"
+        assert seen_during_inference == [["FUN_1"]]
+        assert xref_calls == ["FUN_1"]
+
+    def test_prefetch_can_be_turned_off(self, monkeypatch):
+        calls = []
+        llm = ScriptedLLM([("find_relevant", '{"query": "x"}')])
+        tool_map = {
+            "find_relevant": lambda query: {"results": [{"name": "FUN_1"}]},
+            "get_xrefs": lambda target: calls.append(target) or {},
+        }
+        agent = ReverseEngineeringAgent(
+            llm=llm, tools_spec=[], tool_map=tool_map, select_tools=False, prefetch=False
+        )
+        assert agent.run("q") == "done"
+        assert calls == []
+
+    def test_snapshot_reads_match_unprefetched_results(self, archive, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_TOKEN_BUDGET", "100000")
+        snapshot = SnapshotTools(archive)
+        tools = SnapshotTools(archive)
+        tool_map = build_tool_map(tools)
+        search = tool_map["search_functions"](name_pattern="FUN_10001020")
+        hit = search["results"][0]
+
+        prefetcher = Prefetcher(tool_map, build_prefetch_warmers(tools))
+        try:
+            prefetcher.schedule("search_functions", {}, search)
+            xrefs = prefetcher.take("get_xrefs", {"target": hit["name"]})
+            assert prefetcher.take("read_decompilation", {"decomp_path": hit["decomp_path"]}) is None
+        finally:
+            prefetcher.close()
+
+        assert xrefs == snapshot.get_xrefs(hit["name"])
+        # Warming does not spend the session budget; only the real read does.
+        assert tools.budget.used == 0
+        read = tools.read_decompilation(hit["decomp_path"])
+        assert read["code"] == snapshot.read_decompilation(hit["decomp_path"])["code"]
+        assert tools.budget.used == read["tokens"]
@@ -0,0 +1,105 @@
+"""Tests for the record/replay LLM stand-ins and the replay benchmark."""
+
+import json
+import urllib.request
+from pathlib import Path
+from types import SimpleNamespace
+
+import pytest
+
+from kernagent.agent import ReverseEngineeringAgent
+from kernagent.bench import run_benchmark
+from kernagent.replay import RecordingLLM, ReplayExhaustedError, ReplayLLM, load_cassette, serve_replay
+
+FIXTURES = Path(__file__).parent / "fixtures"
+CASSETTE = FIXTURES / "sessions" / "bifrose_resource_loading.jsonl"
+
+ECHO_TOOL = {
+    "type": "function",
+    "function": {"name": "echo_tool", "parameters": {"type": "object", "properties": {}}},
+}
+
+
+class LiveStub:
+    """Stands in for LLMClient: one tool call, then an answer."""
+
+    settings = SimpleNamespace(model="live-model")
+
+    def __init__(self):
+        self.calls = 0
+
+    def chat(self, verbose=False, **kwargs):
+        self.calls += 1
+        if self.calls == 1:
+            call = SimpleNamespace(id="c1", type="function", function=SimpleNamespace(name="echo_tool", arguments="{}"))
+            message = SimpleNamespace(role="assistant", content=None, tool_calls=[call])
+        else:
+            message = SimpleNamespace(role="assistant", content="live answer", tool_calls=None)
+        usage = SimpleNamespace(prompt_tokens=100, completion_tokens=7)
+        return SimpleNamespace(choices=[SimpleNamespace(message=message)], usage=usage)
+
+
+class TestRecordReplay:
+    """A recorded session replays to the same result without the live model."""
+
+    def test_record_then_replay(self, tmp_path):
+        cassette = tmp_path / "session.jsonl"
+        tool_map = {"echo_tool": lambda: {"ok": True}}
+
+        recorder = RecordingLLM(LiveStub(), cassette)
+        live_answer = ReverseEngineeringAgent(recorder, [ECHO_TOOL], tool_map).run("question?")
+
+        data = load_cassette(cassette)
+        assert data["header"]["question"] == "question?"
+        assert data["header"]["model"] == "live-model"
+        assert [turn["response"]["tool_calls"] for turn in data["turns"]][0][0]["name"] == "echo_tool"
+
+        replay = ReplayLLM(cassette)
+        replay_answer = ReverseEngineeringAgent(replay, [ECHO_TOOL], tool_map).run(replay.question)
+
+        assert replay_answer == live_answer == "live answer"
+        assert replay.exhausted
+        assert [request["completion_tokens"] for request in replay.requests] == [7, 7]
+
+    def test_exhausted_cassette_raises(self):
+        replay = ReplayLLM({"header": {}, "turns": []})
+        with pytest.raises(ReplayExhaustedError):
+            replay.chat(messages=[])
+
+
+class TestReplayServer:
+    """The replay server speaks the OpenAI chat completions wire format."""
+
+    def test_serves_recorded_turns(self):
+        server = serve_replay(ReplayLLM(CASSETTE))
+        url = f"http://127.0.0.1:{server.server_address[1]}/v1/chat/completions"
+        try:
+            request = urllib.request.Request(
+                url,
+                data=json.dumps({"model": "m", "messages": [{"role": "user", "content": "q"}]}).encode(),
+                headers={"Content-Type": "application/json"},
+            )
+            with urllib.request.urlopen(request) as response:
+                body = json.loads(response.read())
+            call = body["choices"][0]["message"]["tool_calls"][0]
+            assert call["function"]["name"] == "find_relevant"
+            assert body["usage"]["completion_tokens"] == 24
+        finally:
+            server.shutdown()
+            server.server_close()
+
+
+class TestBenchmark:
+    """The benchmark replays cassettes against real snapshot tools."""
+
+    def test_reports_session_metrics(self, archive):
+        report = run_benchmark(archive, [CASSETTE])
+        session = report["sessions"][0]
+
+        assert session["complete"]
+        assert session["llm_calls"] == 4
+        assert session["tool_calls"] == 3
+        assert set(session["tools"]) == {"find_relevant", "get_function", "search_imports_exports"}
+        assert session["max_prompt_tokens_est"] > 0
+        assert session["prompt_tokens_est"] >= session["max_prompt_tokens_est"]
+        assert report["totals"]["completion_tokens"] == 102
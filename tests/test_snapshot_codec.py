@@ -0,0 +1,77 @@
+"""Tests for the snapshot JSON codec and typed records."""
+
+import json
+import sys
+
+from kernagent.snapshot import codec
+from kernagent.snapshot.records import CallEdge, FunctionRecord, StringRecord
+
+
+class TestCodec:
+    """Test codec round-trips and compact output."""
+
+    def test_round_trip(self):
+        obj = {"ea": "10001000", "name": "main", "metrics": {"size_bytes": 12}, "xrefs": [None, True]}
+        assert codec.loads(codec.dumps(obj)) == obj
+
+    def test_output_is_compact(self):
+        text = codec.dumps({"a": [1, 2], "b": {"c": "d"}})
+        assert " " not in text
+        assert "\n" not in text
+
+    def test_wide_integers_fall_back_to_stdlib(self):
+        value = {"value": 1 << 70}
+        assert codec.loads(codec.dumps(value)) == value
+
+    def test_bytes_input_is_accepted(self):
+        assert codec.loads(b'{"ea": "1000"}') == {"ea": "1000"}
+
+    def test_decode_error_is_reported(self):
+        try:
+            codec.loads("{not json")
+        except codec.DecodeError:
+            pass
+        else:  # pragma: no cover - assertion helper
+            raise AssertionError("expected DecodeError")
+
+    def test_dump_and_load_files(self, tmp_path):
+        path = tmp_path / "index.json"
+        with path.open("w", encoding="utf-8") as f:
+            codec.dump({"by_name": {"main": "1000"}}, f)
+        with path.open(encoding="utf-8") as f:
+            assert codec.load(f) == {"by_name": {"main": "1000"}}
+        assert json.loads(path.read_text()) == {"by_name": {"main": "1000"}}
+
+
+class TestRecords:
+    """Test the slotted record types."""
+
+    def test_function_record_from_dict(self):
+        record = FunctionRecord.from_dict({"ea": "1000", "metrics": None, "insn": [1, 2, 3]})
+
+        assert record.name == "1000"
+        assert record.metrics == {}
+        assert record.xrefs_out == []
+        assert not hasattr(record, "__dict__")
+
+    def test_dict_style_access(self):
+        record = FunctionRecord.from_dict({"ea": "1000", "name": "main"})
+        record["section_name"] = ".text"
+
+        assert record["name"] == "main"
+        assert record.get("section_name") == ".text"
+        assert record.get("missing", 7) == 7
+        assert "ranges" in record
+
+    def test_records_are_smaller_than_dicts(self):
+        entry = {"ea": "1000", "name": "main", "metrics": {}, "xrefs_in": [], "xrefs_out": [], "ranges": []}
+        record = FunctionRecord.from_dict(entry)
+        assert sys.getsizeof(record) < sys.getsizeof(entry)
+
+    def test_string_and_edge_records(self):
+        string = StringRecord.from_dict({"ea": "2000", "value": "cmd.exe", "length": 7})
+        edge = CallEdge.from_dict({"from": "1000", "to": "2000", "type": "UNCONDITIONAL_CALL"})
+
+        assert string.xrefs == []
+        assert (edge.from_ea, edge.to_ea, edge.type) == ("1000", "2000", "UNCONDITIONAL_CALL")
+        assert edge.to_dict()["to_name"] is None
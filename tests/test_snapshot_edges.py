@@ -0,0 +1,143 @@
+"""Tests for the normalized edge table (edges.json)."""
+
+import json
+import os
+import shutil
+import time
+from collections import Counter
+
+from kernagent.oneshot import build_oneshot_summary
+from kernagent.snapshot import SnapshotTools
+from kernagent.snapshot.edges import EDGES_FILE, REFERENCE_TYPE, EdgeTable, load_edge_table, write_edge_table
+
+from conftest import FIXTURE_ARCHIVE
+
+
+def _legacy_functions():
+    with (FIXTURE_ARCHIVE / "functions.jsonl").open() as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+def _legacy_copy(tmp_path):
+    """The fixture as an older snapshot: per-function xrefs, callgraph.jsonl, no edges.json."""
+
+    root = tmp_path / "legacy_archive"
+    shutil.copytree(FIXTURE_ARCHIVE, root)
+    return root
+
+
+def _normalized_copy(tmp_path):
+    """The fixture as the extractor now writes it: xrefs only in edges.json."""
+
+    root = tmp_path / "normalized_archive"
+    shutil.copytree(FIXTURE_ARCHIVE, root)
+    functions = _legacy_functions()
+    write_edge_table(root, EdgeTable.from_functions(functions))
+    with (root / "functions.jsonl").open("w") as f:
+        for record in functions:
+            record.pop("xrefs_in")
+            record.pop("xrefs_out")
+            f.write(json.dumps(record) + "\n")
+    (root / "callgraph.jsonl").unlink()
+    return root
+
+
+class TestEdgeTable:
+    """Deduplication and the derived per-function views."""
+
+    def test_call_sites_are_counted_once_per_callee(self):
+        functions = _legacy_functions()
+        table = EdgeTable.from_functions(functions)
+        record = next(func for func in functions if func["name"] == "FUN_10001020")
+
+        printf_sites = sum(1 for xref in record["xrefs_out"] if xref["name"] == "_printf")
+        callees = [callee for callee in table.callees("10001020") if callee["name"] == "_printf"]
+        assert printf_sites > 1
+        assert callees == [{"ea": "100012f7", "name": "_printf", "type": "UNCONDITIONAL_CALL", "count": printf_sites}]
+        assert table.call_sites("10001020") == len(record["xrefs_out"])
+
+    def test_views_match_the_per_function_lists(self):
+        functions = _legacy_functions()
+        table = EdgeTable.from_functions(functions)
+
+        for record in functions:
+            assert sorted(table.callers(record["ea"])) == sorted(record["xrefs_in"])
+            expected = Counter((x["ea"], x["type"]) for x in record["xrefs_out"])
+            assert {(c["ea"], c["type"]): c["count"] for c in table.callees(record["ea"])} == expected
+
+    def test_address_only_callers_become_plain_references(self):
+        table = EdgeTable.from_functions(
+            [
+                {"ea": "1000", "name": "main", "xrefs_out": [], "xrefs_in": []},
+                {"ea": "2000", "name": "callback", "xrefs_out": [], "xrefs_in": ["1000"]},
+            ]
+        )
+        assert table.callers("2000") == ["1000"]
+        assert table.callees("1000") == []  # not a call or jump
+        assert [edge.type for edge in table.outgoing(table.node_id("1000"), flow_only=False)] == [REFERENCE_TYPE]
+
+    def test_payload_round_trip(self):
+        table = EdgeTable.from_functions(_legacy_functions())
+        restored = EdgeTable.from_payload(json.loads(json.dumps(table.to_payload())))
+        assert restored.callees("10001020") == table.callees("10001020")
+        assert list(restored.call_edges()) == list(table.call_edges())
+
+
+class TestLoadEdgeTable:
+    """edges.json is authoritative when the extractor wrote it, derived otherwise."""
+
+    def test_older_snapshot_gets_a_derived_table(self, tmp_path):
+        root = _legacy_copy(tmp_path)
+        table = load_edge_table(root)
+
+        payload = json.loads((root / EDGES_FILE).read_text())
+        stat = (root / "functions.jsonl").stat()
+        assert payload["source"] == {"functions.jsonl": [stat.st_size, stat.st_mtime_ns]}
+        assert (root / EDGES_FILE).stat().st_size < (root / "callgraph.jsonl").stat().st_size
+        assert table.callers("100012f7")
+
+        # A rebuilt snapshot invalidates the derived table.
+        with (root / "functions.jsonl").open("a") as f:
+            f.write(json.dumps({"ea": "deadbeef", "name": "extra", "xrefs_out": [{"ea": "100012f7", "name": "_printf"}]}) + "\n")
+        assert "deadbeef" in load_edge_table(root).callers("100012f7")
+
+    def test_same_size_rewrite_invalidates_derived_table(self, tmp_path):
+        root = _legacy_copy(tmp_path)
+        assert load_edge_table(root).callers("100012f7")
+
+        functions = root / "functions.jsonl"
+        original = functions.read_text()
+        functions.write_text(original.replace('"100012f7"', '"100012f8"'))
+        assert functions.stat().st_size == len(original.encode())
+        os.utime(functions, ns=(time.time_ns(), time.time_ns() + 1_000_000_000))
+        table = load_edge_table(root)
+        assert not table.callers("100012f7")
+        assert table.callers("100012f8")
+
+    def test_extractor_table_is_used_as_is(self, tmp_path):
+        root = _normalized_copy(tmp_path)
+        assert "source" not in json.loads((root / EDGES_FILE).read_text())
+        assert load_edge_table(root).call_sites("10001020") > 0
+
+
+class TestNormalizedSnapshot:
+    """Tools and the pruner read a snapshot without per-function xrefs the same way."""
+
+    def test_pruner_summary_is_unchanged(self, tmp_path):
+        legacy = build_oneshot_summary(_legacy_copy(tmp_path))
+        assert build_oneshot_summary(_normalized_copy(tmp_path)) == legacy
+
+    def test_tools_derive_xrefs(self, tmp_path):
+        legacy = SnapshotTools(_legacy_copy(tmp_path))
+        tools = SnapshotTools(_normalized_copy(tmp_path))
+
+        func = tools.get_function("FUN_10001020", fields=["xrefs_out", "xrefs_in"])
+        assert any(callee["name"] == "_printf" and callee["count"] > 1 for callee in func["xrefs_out"])
+        assert func["xrefs_in"] == legacy.get_function("FUN_10001020")["xrefs_in"]
+
+        def xref_keys(snapshot):
+            return sorted((x["direction"], x["type"], x["from_ea"], x["to_ea"]) for x in snapshot.get_xrefs("_printf")["xrefs"])
+
+        assert xref_keys(tools) == xref_keys(legacy)
+        assert tools.search_functions(callers_of="_printf", limit=500) == legacy.search_functions(callers_of="_printf", limit=500)
+        assert tools.trace_calls("FUN_10001020", max_depth=2) == legacy.trace_calls("FUN_10001020", max_depth=2)
@@ -0,0 +1,132 @@
+"""Tests for on-demand extraction of zipped snapshots."""
+
+import os
+import shutil
+import zipfile
+
+import pytest
+
+from kernagent.cli import ensure_snapshot
+from kernagent.snapshot import SnapshotError, SnapshotTools
+from kernagent.snapshot.lazyzip import LAZY_MARKER, open_snapshot_zip
+from kernagent.snapshot.retrieval import BM25Index
+
+from conftest import FIXTURE_ARCHIVE
+
+
+def _zip_fixture(tmp_path, stem="sample_archive"):
+    """Zip the fixture the way the extractor does: members under <stem>/, plus the binary."""
+
+    zip_path = tmp_path / f"{stem}.zip"
+    with zipfile.ZipFile(zip_path, "w", zipfile.ZIP_DEFLATED) as zf:
+        for path in sorted(FIXTURE_ARCHIVE.rglob("*")):
+            if path.is_file():
+                zf.write(path, f"{stem}/{path.relative_to(FIXTURE_ARCHIVE).as_posix()}")
+        zf.writestr(f"{stem}/binary/sample", b"MZ" + b"\0" * 4096)
+    return zip_path
+
+
+def _decomp_files(root):
+    return sorted(path.name for path in (root / "decomp").glob("*.c")) if (root / "decomp").exists() else []
+
+
+class TestOpenSnapshotZip:
+    """Only JSON artifacts are extracted up front."""
+
+    def test_cold_open_skips_decomp_and_binary(self, tmp_path):
+        root = open_snapshot_zip(_zip_fixture(tmp_path), cache_dir=tmp_path / "cache")
+
+        assert root.name == "sample_archive"
+        assert (root / "meta.json").exists() and (root / "functions.jsonl").exists()
+        assert _decomp_files(root) == []
+        assert not (root / "binary").exists()
+
+    def test_reuses_entry_until_zip_changes(self, tmp_path):
+        zip_path = _zip_fixture(tmp_path)
+        first = open_snapshot_zip(zip_path, cache_dir=tmp_path / "cache")
+        (first / "meta.json").write_text("{}")
+        assert open_snapshot_zip(zip_path, cache_dir=tmp_path / "cache") == first
+        assert (first / "meta.json").read_text() == "{}"
+
+        stat = zip_path.stat()
+        os.utime(zip_path, ns=(stat.st_atime_ns, stat.st_mtime_ns + 10**9))
+        second = open_snapshot_zip(zip_path, cache_dir=tmp_path / "cache")
+        assert second != first and (second / "meta.json").read_text() != "{}"
+
+    def test_least_recently_used_entries_are_evicted(self, tmp_path):
+        cache = tmp_path / "cache"
+        old = open_snapshot_zip(_zip_fixture(tmp_path, "old_archive"), cache_dir=cache)
+        os.utime(old.parent, (1, 1))
+        new = open_snapshot_zip(_zip_fixture(tmp_path, "new_archive"), cache_dir=cache, max_bytes=1)
+
+        assert new.exists() and not old.exists()
+
+    def test_recently_used_entries_are_not_evicted(self, tmp_path):
+        cache = tmp_path / "cache"
+        busy = open_snapshot_zip(_zip_fixture(tmp_path, "busy_archive"), cache_dir=cache)
+        new = open_snapshot_zip(_zip_fixture(tmp_path, "new_archive"), cache_dir=cache, max_bytes=1)
+
+        assert new.exists() and busy.exists()
+
+    @pytest.mark.parametrize("entry_name", ["../escape.txt", "/abs/path.txt", r"C:\\evil.txt"])
+    def test_unsafe_members_are_rejected(self, tmp_path, entry_name):
+        zip_path = tmp_path / "evil_archive.zip"
+        with zipfile.ZipFile(zip_path, "w") as zf:
+            zf.writestr("evil_archive/meta.json", "{}")
+            zf.writestr(entry_name, "oops")
+        with pytest.raises(SnapshotError):
+            open_snapshot_zip(zip_path, cache_dir=tmp_path / "cache")
+
+
+class TestLazyTools:
+    """SnapshotTools extract exactly the members they read."""
+
+    def _tools(self, tmp_path):
+        return SnapshotTools(open_snapshot_zip(_zip_fixture(tmp_path), cache_dir=tmp_path / "cache"))
+
+    def test_read_decompilation_extracts_one_file(self, tmp_path):
+        tools = self._tools(tmp_path)
+        result = tools.read_decompilation("decomp/10001279__clock.c")
+
+        assert "error" not in result
+        assert _decomp_files(tools.root) == ["10001279__clock.c"]
+        assert "error" in tools.read_decompilation("decomp/missing.c")
+
+    def test_list_files_includes_unextracted_members(self, tmp_path):
+        tools = self._tools(tmp_path)
+        listed = tools.list_files("decomp", "*.c")
+
+        assert listed["count"] == 231
+        assert _decomp_files(tools.root) == []
+        assert LAZY_MARKER not in tools.list_files()["files"]
+
+    def test_search_and_index_match_extracted_snapshot(self, tmp_path):
+        tools = self._tools(tmp_path)
+        extracted = tmp_path / "extracted_archive"
+        shutil.copytree(FIXTURE_ARCHIVE, extracted)
+        eager = SnapshotTools(extracted)
+
+        lazy_hits = tools.search_decomp("GetProcAddress", limit=5)
+        assert lazy_hits["count"] == eager.search_decomp("GetProcAddress", limit=5)["count"]
+        index = BM25Index.build(tools.root)
+        assert index.signature == BM25Index.build(extracted).signature
+
+
+class TestEnsureSnapshot:
+    """A `<stem>_archive.zip` next to the binary is opened lazily."""
+
+    def test_zip_next_to_binary(self, tmp_path, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_SNAPSHOT_CACHE_DIR", str(tmp_path / "cache"))
+        _zip_fixture(tmp_path)
+        root = ensure_snapshot(tmp_path / "sample.exe")
+
+        assert (root / LAZY_MARKER).exists()
+        assert not (tmp_path / "sample_archive").exists()
+
+    def test_lazy_mode_can_be_disabled(self, tmp_path, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_SNAPSHOT_LAZY", "0")
+        _zip_fixture(tmp_path)
+        root = ensure_snapshot(tmp_path / "sample.exe")
+
+        assert root == tmp_path / "sample_archive"
+        assert len(_decomp_files(root)) == 231
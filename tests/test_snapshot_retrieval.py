@@ -0,0 +1,56 @@
+"""Tests for BM25 retrieval over snapshot functions."""
+
+
+from kernagent.snapshot import SnapshotTools
+from kernagent.snapshot.retrieval import BM25_INDEX_FILE, BM25Index, tokenize
+
+
+class TestTokenize:
+    """Test query/document tokenization."""
+
+    def test_splits_identifiers(self):
+        assert tokenize("CreateRemoteThread") == ["createremotethread", "create", "remote", "thread"]
+        assert tokenize("get_proc_address") == ["get_proc_address", "get", "proc", "address"]
+
+    def test_drops_ghidra_placeholders(self):
+        assert tokenize("uVar1 = FUN_10001020(local_10, param_1); DAT_1000c0") == []
+
+    def test_keeps_ordinary_words(self):
+        assert tokenize("read config data") == ["read", "config", "data"]
+
+
+class TestFindRelevant:
+    """Test SnapshotTools.find_relevant()."""
+
+    def test_returns_ranked_functions(self, archive):
+        result = SnapshotTools(archive).find_relevant("file write", k=5)
+
+        assert 0 < result["count"] <= 5
+        scores = [entry["score"] for entry in result["results"]]
+        assert scores == sorted(scores, reverse=True)
+        assert all({"ea", "name", "matched_terms"} <= set(entry) for entry in result["results"])
+
+    def test_index_is_persisted_and_reused(self, archive, monkeypatch):
+        SnapshotTools(archive).find_relevant("file write")
+        assert (archive / BM25_INDEX_FILE).exists()
+
+        def fail_build(cls, root):
+            raise AssertionError("index should have been loaded from disk")
+
+        monkeypatch.setattr(BM25Index, "build", classmethod(fail_build))
+        result = SnapshotTools(archive).find_relevant("file write")
+        assert result["count"] > 0
+
+    def test_stale_index_is_rebuilt(self, archive):
+        (archive / BM25_INDEX_FILE).write_text('{"version": 1, "signature": {}, "docs": [], "postings": {}}')
+
+        result = SnapshotTools(archive).find_relevant("file write")
+
+        assert result["count"] > 0
+
+    def test_unknown_terms_return_no_results(self, archive):
+        result = SnapshotTools(archive).find_relevant("zzqxnonexistent")
+        assert result["results"] == []
+
+    def test_empty_query_is_rejected(self, archive):
+        assert "error" in SnapshotTools(archive).find_relevant("  ")
@@ -0,0 +1,117 @@
+"""Tests for the sharded snapshot layout."""
+
+import json
+import shutil
+
+import pytest
+
+from kernagent.oneshot import build_oneshot_summary
+from kernagent.snapshot import SnapshotTools
+from kernagent.snapshot.shards import (
+    SHARD_MANIFEST,
+    SHARDED_KINDS,
+    decode_fields,
+    load_manifest,
+    record_paths,
+    write_manifest,
+    write_records,
+)
+
+from conftest import FIXTURE_ARCHIVE
+
+
+def read_jsonl(path):
+    with path.open() as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+@pytest.fixture
+def flat_archive(tmp_path):
+    archive = tmp_path / "flat_archive"
+    shutil.copytree(FIXTURE_ARCHIVE, archive)
+    return archive
+
+
+@pytest.fixture
+def sharded_archive(archive):
+    """Copy of the fixture archive rewritten with small shards."""
+
+    entries = {}
+    for kind in SHARDED_KINDS:
+        flat = archive / f"{kind}.jsonl"
+        records = read_jsonl(flat)
+        flat.unlink()
+        entries[kind] = write_records(archive, kind, records, shard_records=25)
+    write_manifest(archive, entries)
+    return archive
+
+
+class TestWriteRecords:
+    """Test shard writing."""
+
+    def test_small_kinds_stay_flat(self, tmp_path):
+        records = [{"ea": "1000"}, {"ea": "2000"}]
+
+        assert write_records(tmp_path, "functions", records, shard_records=10) is None
+        assert read_jsonl(tmp_path / "functions.jsonl") == records
+        assert write_manifest(tmp_path, {"functions": None}) is None
+        assert not (tmp_path / SHARD_MANIFEST).exists()
+
+    def test_records_are_partitioned_by_address(self, tmp_path):
+        records = [{"ea": f"{ea:x}"} for ea in (0x5000, 0x1000, 0x3000, 0x2000, 0x4000)]
+
+        entries = write_records(tmp_path, "functions", records, shard_records=2)
+
+        assert [(e["start"], e["end"], e["count"]) for e in entries] == [
+            ("1000", "2000", 2),
+            ("3000", "4000", 2),
+            ("5000", "5000", 1),
+        ]
+        assert not (tmp_path / "functions.jsonl").exists()
+
+    def test_address_lookup_opens_single_shard(self, sharded_archive):
+        manifest = load_manifest(sharded_archive)
+        entry = manifest["functions"][1]
+
+        paths = record_paths(sharded_archive, "functions", manifest, ea=int(entry["start"], 16))
+
+        assert paths == [sharded_archive / entry["path"]]
+        assert record_paths(sharded_archive, "functions", manifest, ea=0) == []
+
+
+class TestShardedReaders:
+    """Sharded archives must read the same as flat ones."""
+
+    def test_tools_match_flat_layout(self, flat_archive, sharded_archive):
+        flat = SnapshotTools(flat_archive)
+        sharded = SnapshotTools(sharded_archive)
+
+        assert sharded.get_function_stats() == flat.get_function_stats()
+        assert sharded.search_strings("http") == flat.search_strings("http")
+        assert sharded.search_data(limit=200) == flat.search_data(limit=200)
+        assert sharded.resolve_symbol("10001020") == flat.resolve_symbol("10001020")
+        assert sharded.get_function("FUN_10001020") == flat.get_function("FUN_10001020")
+
+    def test_oneshot_summary_matches_flat_layout(self, flat_archive, sharded_archive):
+        flat = build_oneshot_summary(flat_archive)
+        sharded = build_oneshot_summary(sharded_archive)
+
+        assert sharded == flat
+
+
+class TestDecodeFields:
+    """Test partial decoding of record lines."""
+
+    def test_matches_full_decode(self):
+        for line in (FIXTURE_ARCHIVE / "functions.jsonl").read_text().splitlines()[:50]:
+            record = json.loads(line)
+            for fields in (["ea", "name"], ["metrics", "xrefs_out"], ["decomp_path", "bb"]):
+                expected = {key: record[key] for key in fields if key in record}
+                assert decode_fields(line, fields) == expected
+
+    def test_nested_keys_are_not_mistaken_for_top_level(self):
+        line = json.dumps({"ea": "1000", "xrefs_out": [{"name": "inner"}], "name": "outer"})
+        assert decode_fields(line, ["name"]) == {"name": "outer"}
+
+    def test_missing_fields_are_omitted(self):
+        assert decode_fields('{"ea": "1000", "flag": true, "n": -1.5e3}', ["n", "absent"]) == {"n": -1500.0}
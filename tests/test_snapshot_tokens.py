@@ -0,0 +1,102 @@
+"""Tests for token estimates and the per-session token budget."""
+
+import json
+
+from kernagent.snapshot import SnapshotTools
+from kernagent.snapshot.tokens import TOKEN_INDEX_FILE, TokenBudget, estimate_tokens, load_token_index
+
+OUTPUT_L = "decomp/10001aa6___output_l.c"
+
+
+class TestEstimateTokens:
+    """Configurable tokenizer approximations."""
+
+    def test_default_is_four_chars_per_token(self, monkeypatch):
+        monkeypatch.delenv("KERNAGENT_TOKENIZER", raising=False)
+        assert estimate_tokens("a" * 40) == 10
+        assert estimate_tokens("") == 0
+
+    def test_custom_ratio_and_words(self, monkeypatch):
+        monkeypatch.setenv("KERNAGENT_TOKENIZER", "chars:2")
+        assert estimate_tokens("a" * 40) == 20
+        monkeypatch.setenv("KERNAGENT_TOKENIZER", "words")
+        assert estimate_tokens("iVar1 = FUN_1000(param_1);") == 6
+
+
+class TestTokenIndex:
+    """token_index.json is built once and reused."""
+
+    def test_builds_and_persists(self, archive):
+        estimates = load_token_index(archive)
+        entry = estimates["10001aa6"]
+        assert entry["decomp"] > entry["decomp_normalized"] > 0
+        assert entry["insn"] > 0
+
+        payload = json.loads((archive / TOKEN_INDEX_FILE).read_text())
+        assert payload["signature"]["tokenizer"] == "chars"
+
+    def test_tokenizer_change_rebuilds(self, archive, monkeypatch):
+        before = load_token_index(archive)
+        monkeypatch.setenv("KERNAGENT_TOKENIZER", "chars:2")
+        after = load_token_index(archive)
+        ea = next(iter(before))
+        assert after[ea]["insn"] > before[ea]["insn"]
+
+
+class TestTokenBudget:
+    """Allowance arithmetic."""
+
+    def test_allowance(self):
+        budget = TokenBudget(limit=1000, per_read=300)
+        assert budget.allowance() == 300
+        assert budget.allowance(100) == 100
+        budget.charge(900)
+        assert budget.allowance() == 100
+        budget.charge(200)
+        assert budget.allowance() == 0
+
+    def test_unlimited(self):
+        assert TokenBudget().allowance() is None
+
+
+class TestBudgetedReads:
+    """read_decompilation chooses full code or an outline."""
+
+    def test_small_function_is_read_in_full(self, archive):
+        tools = SnapshotTools(archive)
+        tools.budget = TokenBudget(limit=0, per_read=6000)
+        result = tools.read_decompilation("decomp/10001020_FUN_10001020.c")
+        assert "mode" not in result
+        assert tools.budget.used == result["tokens"]
+
+    def test_large_function_falls_back_to_outline(self, archive):
+        tools = SnapshotTools(archive)
+        tools.budget = TokenBudget(limit=0, per_read=1000)
+        result = tools.read_decompilation(OUTPUT_L)
+
+        assert result["mode"] == "outline"
+        assert result["tokens"] <= 1000 < result["tokens_full"]
+        assert "omitted" in result["code"]
+
+    def test_max_tokens_argument(self, archive):
+        tools = SnapshotTools(archive)
+        result = tools.read_decompilation(OUTPUT_L, max_tokens=500)
+        assert result["mode"] == "outline"
+
+    def test_exhausted_budget(self, archive):
+        tools = SnapshotTools(archive)
+        tools.budget = TokenBudget(limit=600, per_read=0)
+        first = tools.read_decompilation(OUTPUT_L)
+        assert first["mode"] == "outline"
+        assert first["budget"]["remaining"] < 600
+
+        tools.budget.charge(tools.budget.remaining)
+        assert "budget exhausted" in tools.read_decompilation(OUTPUT_L)["error"]
+
+    def test_costs_reported_before_reading(self, archive):
+        tools = SnapshotTools(archive)
+        result = tools.search_functions(name_pattern="__output_l", limit=1)["results"][0]
+        assert result["decomp_tokens"] > 1000
+
+        func = tools.get_function("__output_l", fields=["tokens"])
+        assert func["tokens"]["decomp_normalized"] == result["decomp_tokens"]
@@ -1,5 +1,6 @@
 """Comprehensive tests for core SnapshotTools methods."""
 
+import json
 from pathlib import Path
 
 import pytest
@@ -8,9 +9,8 @@ from kernagent.snapshot.tools import SnapshotTools
 
 
 @pytest.fixture
-def snapshot():
-    """Create SnapshotTools instance with test fixture."""
-    archive = Path(__file__).parent / "fixtures" / "bifrose_archive"
+def snapshot(archive):
+    """Create SnapshotTools instance on a copy of the test fixture."""
     return SnapshotTools(archive)
 
 
@@ -398,6 +398,73 @@ class TestGetXrefs:
                 assert result["resolved_target"]["ea"] is not None
 
 
+class TestResolveSymbol:
+    """Test resolve_symbol() against the separate symbol table."""
+
+    def test_resolve_symbol_uses_symbols_index(self, tmp_path):
+        """Labels that are not exports should still resolve via symbols_index.json."""
+        (tmp_path / "symbols_index.json").write_text(
+            json.dumps({"by_name": {"@__security_check_cookie@4": ["1000126a"]}})
+        )
+        tools = SnapshotTools(tmp_path)
+
+        result = tools.resolve_symbol("@__security_check_cookie@4")
+        assert result["candidates"] == [
+            {"kind": "symbol", "name": "@__security_check_cookie@4", "ea": "1000126A"}
+        ]
+
+    def test_resolve_symbol_without_symbols_index(self, snapshot):
+        """Snapshots predating symbols_index.json keep resolving functions."""
+        result = snapshot.resolve_symbol("entry")
+        assert result["candidates"][0]["kind"] == "function"
+
+
+class TestFieldProjection:
+    """Test the `fields` argument on function/string/data tools."""
+
+    def test_get_function_returns_only_requested_fields(self, snapshot):
+        """get_function(fields=...) should return just those fields plus ea/name."""
+        full = snapshot.get_function("FUN_10001020")
+        result = snapshot.get_function("FUN_10001020", fields=["prototype", "xrefs_in"])
+
+        assert set(result) == {"ea", "name", "prototype", "xrefs_in"}
+        assert result["xrefs_in"] == full["xrefs_in"]
+        assert result["prototype"] == full["prototype"]
+
+    def test_get_function_accepts_comma_separated_fields(self, snapshot):
+        """A comma-separated string should be accepted as a field list."""
+        result = snapshot.get_function("FUN_10001020", fields="metrics, decomp_path")
+        assert set(result) == {"ea", "name", "metrics", "decomp_path"}
+
+    def test_search_functions_projection(self, snapshot):
+        """search_functions(fields=...) should project each result."""
+        result = snapshot.search_functions(limit=5, fields=["prototype"])
+        assert result["count"] > 0
+        for func in result["results"]:
+            assert set(func) <= {"ea", "name", "prototype"}
+
+    def test_search_functions_default_summary_unchanged(self, snapshot):
+        """Without fields, results keep the summary shape."""
+        func = snapshot.search_functions(limit=1)["results"][0]
+        assert "xrefs_in_count" in func
+        assert "decomp_path" in func
+
+    def test_search_strings_projection(self, snapshot):
+        """search_strings(fields=...) should return raw record fields."""
+        default = snapshot.search_strings("MZ", case_sensitive=True)
+        result = snapshot.search_strings("MZ", case_sensitive=True, fields=["value"])
+
+        assert result["count"] == default["count"] > 0
+        assert set(result["results"][0]) == {"ea", "value"}
+
+    def test_search_data_projection(self, snapshot):
+        """search_data(fields=...) should return raw record fields."""
+        result = snapshot.search_data(limit=3, fields=["type"])
+        assert result["count"] == 3
+        for entry in result["results"]:
+            assert set(entry) <= {"ea", "type"}
+
+
 class TestErrorHandling:
     """Test error handling in SnapshotTools."""
 
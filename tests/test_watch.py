@@ -0,0 +1,186 @@
+"""Tests for the spool-directory watch pipeline."""
+
+import json
+import threading
+import time
+from pathlib import Path
+
+import pytest
+
+from kernagent.cli import build_parser
+from kernagent.watch import Debouncer, InotifyWatcher, PollingWatcher, WatchPipeline, is_candidate
+
+
+class FakeClock:
+    def __init__(self):
+        self.now = 100.0
+
+    def __call__(self):
+        return self.now
+
+
+class RecordingProcessor:
+    """Writes a report per sample and records what it analyzed."""
+
+    def __init__(self, fail=False, delay=0.0):
+        self.samples = []
+        self.fail = fail
+        self.delay = delay
+        self.active = 0
+        self.max_active = 0
+        self._lock = threading.Lock()
+
+    def __call__(self, sample, result_dir):
+        with self._lock:
+            self.samples.append(sample.name)
+            self.active += 1
+            self.max_active = max(self.max_active, self.active)
+        time.sleep(self.delay)
+        with self._lock:
+            self.active -= 1
+        if self.fail:
+            raise RuntimeError("ghidra crashed")
+        (result_dir / "summary.md").write_text(f"report for {sample.name}")
+        return ["summary.md"]
+
+
+def _status(output, sha256):
+    return json.loads((output / sha256 / "status.json").read_text())
+
+
+class TestDebouncer:
+    """Files are released only after they stop changing."""
+
+    def test_waits_for_size_to_settle(self, tmp_path):
+        clock = FakeClock()
+        debouncer = Debouncer(settle=1.0, clock=clock)
+        sample = tmp_path / "sample.exe"
+        sample.write_bytes(b"MZ")
+
+        debouncer.touch(sample)
+        clock.now += 0.5
+        assert debouncer.ready() == []
+
+        with sample.open("ab") as f:
+            f.write(b"\x90" * 100)
+        clock.now += 0.6
+        assert debouncer.ready() == []  # size changed: wait restarts
+
+        clock.now += 1.0
+        assert debouncer.ready() == [sample]
+        assert debouncer.next_deadline() is None
+
+    def test_empty_and_vanished_files_are_held_back(self, tmp_path):
+        clock = FakeClock()
+        debouncer = Debouncer(settle=0.5, clock=clock)
+        empty, gone = tmp_path / "empty", tmp_path / "gone"
+        empty.touch()
+        gone.write_bytes(b"x")
+        debouncer.touch(empty)
+        debouncer.touch(gone)
+        gone.unlink()
+
+        clock.now += 1.0
+        assert debouncer.ready() == []
+        assert debouncer.next_deadline() == 0.5
+
+    def test_partial_names_are_not_candidates(self):
+        assert is_candidate(Path("sample.exe"))
+        assert not is_candidate(Path("sample.exe.part"))
+        assert not is_candidate(Path(".sample.swp"))
+
+
+class TestWatchers:
+    """Change notification backends."""
+
+    def test_inotify_reports_new_files(self, tmp_path):
+        try:
+            watcher = InotifyWatcher(tmp_path)
+        except OSError as exc:
+            pytest.skip(f"inotify unavailable: {exc}")
+        try:
+            (tmp_path / "dropped.bin").write_bytes(b"MZ")
+            assert tmp_path / "dropped.bin" in watcher.poll(1.0)
+        finally:
+            watcher.close()
+
+    def test_polling_reports_changes_once(self, tmp_path):
+        watcher = PollingWatcher(tmp_path, interval=0)
+        (tmp_path / "a.bin").write_bytes(b"MZ")
+        assert watcher.poll(0) == [tmp_path / "a.bin"]
+        assert watcher.poll(0) == []
+
+
+class TestWatchPipeline:
+    """Dedup, status files and the worker pool."""
+
+    def test_duplicates_are_analyzed_once(self, tmp_path):
+        spool, output = tmp_path / "spool", tmp_path / "out"
+        spool.mkdir()
+        (spool / "first.exe").write_bytes(b"MZ same")
+        (spool / "copy.exe").write_bytes(b"MZ same")
+        processor = RecordingProcessor()
+        pipeline = WatchPipeline(spool, output, processor)
+
+        sha256 = pipeline.submit(spool / "first.exe")
+        assert pipeline.submit(spool / "copy.exe") is None
+        pipeline.close()
+
+        assert processor.samples == ["first.exe"]
+        status = _status(output, sha256)
+        assert status["state"] == "done" and status["outputs"] == ["summary.md"]
+        assert (output / sha256 / "first.exe").read_bytes() == b"MZ same"
+
+        # A restarted watcher still knows the sample.
+        restarted = WatchPipeline(spool, output, processor)
+        assert restarted.submit(spool / "copy.exe") is None
+        restarted.close()
+        assert processor.samples == ["first.exe"]
+
+    def test_failed_samples_are_retried(self, tmp_path):
+        spool, output = tmp_path / "spool", tmp_path / "out"
+        spool.mkdir()
+        (spool / "bad.exe").write_bytes(b"MZ bad")
+
+        pipeline = WatchPipeline(spool, output, RecordingProcessor(fail=True))
+        sha256 = pipeline.submit(spool / "bad.exe")
+        pipeline.close()
+        assert _status(output, sha256)["error"] == "ghidra crashed"
+
+        retry = WatchPipeline(spool, output, RecordingProcessor())
+        assert retry.submit(spool / "bad.exe") == sha256
+        retry.close()
+        assert _status(output, sha256)["state"] == "done"
+
+    def test_run_processes_existing_and_new_files_concurrently(self, tmp_path):
+        spool = tmp_path / "spool"
+        spool.mkdir()
+        (spool / "old.exe").write_bytes(b"MZ old")
+        processor = RecordingProcessor(delay=0.4)
+        pipeline = WatchPipeline(spool, spool / "kernagent", processor, jobs=2, settle=0.05)
+        stop = threading.Event()
+        thread = threading.Thread(target=pipeline.run, kwargs={"stop": stop, "watcher": PollingWatcher(spool, 0.02)})
+        thread.start()
+        try:
+            (spool / "new.exe.part").write_bytes(b"MZ new")
+            (spool / "new.exe.part").rename(spool / "new.exe")
+            deadline = time.monotonic() + 5
+            while len(processor.samples) < 2 and time.monotonic() < deadline:
+                time.sleep(0.02)
+        finally:
+            stop.set()
+            thread.join(5)
+
+        assert sorted(processor.samples) == ["new.exe", "old.exe"]
+        assert processor.max_active == 2
+        assert pipeline.stats["done"] == 2
+
+
+class TestWatchCli:
+    """`kernagent watch` arguments."""
+
+    def test_parser(self):
+        args = build_parser().parse_args(["watch", "/spool", "--output", "/results", "--jobs", "3", "--report", "json"])
+        assert args.directory == Path("/spool")
+        assert args.output == Path("/results")
+        assert args.jobs == 3 and args.report == "json" and args.settle == 1.0